@@ -7,28 +7,38 @@
 #include <stdexcept>
 #include <array>
 #include "Window.h"
-#include "GameObject.h"
+#include "Scene.h"
 #include <glm/gtc/constants.hpp>
 #include "Renderer.h"
 #include "Systems/SimpleRenderSystem.h"
 #include "Systems/PointLightSystem.h"
+#include "Systems/IndirectRenderSystem.h"
+#include "PipelineBuilder.h"
 #include "Camera.h"
 #include <chrono>
 #include "Input.h"
 #include "Buffer.h"
 #include <numeric>
+#include <iostream>
 #include "SceneLoader.h"
+#include <filesystem>
+#include "Benchmark.h"
+#include "Profiler.h"
 
-AppBase::AppBase() :
-    WIDTH{ 800 }, HEIGHT{ 600 }, m_Window{ WIDTH, HEIGHT,
-    std::string{"Vryens Sebastiaan Vulkan"} } 
+AppBase::AppBase( const AppSettings& settings ) :
+    m_Settings{ settings },
+    WIDTH{ static_cast< int >( settings.width ) }, HEIGHT{ static_cast< int >( settings.height ) }, 
+    m_Window{ WIDTH, HEIGHT, std::string{"Vryens Sebastiaan Vulkan"}, settings.headless } 
 {
     m_GlobalDescriptorPool = DescriptorPool::Builder( m_EngineDevice )
         .setMaxSets( SwapChain::MAX_FRAMES_IN_FLIGHT )
         .addPoolSize( VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, SwapChain::MAX_FRAMES_IN_FLIGHT )
         .build();
 
-	LoadGameObjects();
+    PROFILE_THREAD_NAME( "Main" );
+    auto loadStart = std::chrono::high_resolution_clock::now();
+	LoadScene();
+    m_LoadTime = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - loadStart ).count();
 }
 
 AppBase::~AppBase(){}
@@ -62,44 +72,139 @@ void AppBase::Run()
             .build(globalDescriptorSets[i]);
 	}
 
+    //Every system submits its pipelines here, they are built in parallel while the rest is set up
+    auto pipelineStart = std::chrono::high_resolution_clock::now();
+    PipelineBuilder pipelineBuilder{ m_EngineDevice };
+
 	SimpleRenderSystem simpleRenderSystem{ 
 		m_EngineDevice, m_Renderer.GetSwapChainRenderPass(),
-    globalSetLayout->getDescriptorSetLayout()};
+    globalSetLayout->getDescriptorSetLayout(), pipelineBuilder };
+    simpleRenderSystem.SetLodEnabled( m_Settings.lodEnabled );
 
     PointLightSystem pointLightSystem{
     m_EngineDevice, m_Renderer.GetSwapChainRenderPass(),
-    globalSetLayout->getDescriptorSetLayout() };
+    globalSetLayout->getDescriptorSetLayout(), pipelineBuilder };
+
+    std::unique_ptr<IndirectRenderSystem> indirectRenderSystem;
+    if ( m_Settings.gpuCulling )
+    {
+        if ( IndirectRenderSystem::IsSupported( m_EngineDevice ) )
+        {
+            indirectRenderSystem = std::make_unique<IndirectRenderSystem>(
+                m_EngineDevice, m_Renderer.GetSwapChainRenderPass(),
+                globalSetLayout->getDescriptorSetLayout(), pipelineBuilder );
+            indirectRenderSystem->SetConeCullingEnabled( m_Settings.coneCulling );
+            indirectRenderSystem->SetScene( m_Scene );
+            //The physics cube is the only object that moves
+            if ( m_Scene.GetEntityCount() > 1 )
+            {
+                indirectRenderSystem->MarkDynamic( m_Scene, m_Scene.GetEntity( 1 ) );
+            }
+        }
+        else
+        {
+            std::cout << "gpu culling needs drawIndirectFirstInstance, falling back to cpu culling" << std::endl;
+        }
+    }
+
+    pipelineBuilder.WaitIdle();
+    const double pipelineWallTime = std::chrono::duration<double, std::milli>( 
+        std::chrono::high_resolution_clock::now() - pipelineStart ).count();
 
     Camera camera{};
-    auto viewer = GameObject::Create();
-    viewer.m_Transform.translation = { 0.f, -5.f, 0.f };
+    TransformComponent viewer{};
+    viewer.translation = { 0.f, -5.f, 0.f };
 
-    MovementController movementController{m_GameObjects};
+    MovementController movementController{ m_Scene };
     auto currentTime = std::chrono::high_resolution_clock::now();
 
-    MovementController physicsCube{ m_GameObjects};
+    //The second entity of the scene falls and bounces
+    const Entity physicsCubeEntity = m_Scene.GetEntityCount() > 1 ? m_Scene.GetEntity( 1 ) : Entity{};
+    MovementController physicsCube{ m_Scene };
     physicsCube.CanMoveWithInput( false );
     physicsCube.SetBounceStrength( 5.0f );
 
-    while ( !m_Window.ShouldClose() )
+    const bool headless = m_Window.IsHeadless();
+    GLFWwindow* inputWindow = headless ? nullptr : m_Window.GetGLFWwindow();
+    if ( !m_Settings.captureDirectory.empty() )
+    {
+        std::filesystem::create_directories( m_Settings.captureDirectory );
+    }
+
+    //Every pipeline of the run exists at this point, creationTime adds up all worker threads
+    const PipelineCache::Stats pipelineStats = m_EngineDevice.GetPipelineCache().GetStats();
+    std::cout << "pipelines: " << pipelineStats.pipelineCount << " created in " << pipelineWallTime
+        << " ms (" << pipelineStats.creationTime << " ms summed over threads), "
+        << ( pipelineStats.warmStart ? "warm" : "cold" ) << " pipeline cache ("
+        << pipelineStats.loadedBytes << " bytes loaded)" << std::endl;
+
+    std::unique_ptr<Benchmark> benchmark;
+    if ( !m_Settings.benchmarkOutput.empty() )
+    {
+        benchmark = std::make_unique<Benchmark>( m_Settings );
+        benchmark->SetLoadTime( m_LoadTime );
+        benchmark->SetImportStats( m_ImportStats );
+
+        VkDeviceSize vertexBytes = 0;
+        VkDeviceSize fullVertexBytes = 0;
+        VkDeviceSize indexBytes = 0;
+        for ( ModelHandle handle = 0; handle < m_Scene.GetModelCount(); handle++ )
+        {
+            const Model* model = m_Scene.GetModel( handle );
+            vertexBytes += model->GetVertexBufferSize();
+            fullVertexBytes += static_cast< VkDeviceSize >( model->GetVertexCount() ) * sizeof( Model::Vertex );
+            indexBytes += model->GetIndexBufferSize();
+        }
+        benchmark->SetGeometrySize( vertexBytes, fullVertexBytes, indexBytes );
+        benchmark->SetMemoryStats( m_EngineDevice.GetMemoryStats() );
+        benchmark->SetPipelineCreationTime( pipelineWallTime, pipelineStats.warmStart );
+    }
+
+    uint32_t frameNumber = 0;
+    while ( !m_Window.ShouldClose() && 
+        ( m_Settings.frameCount == 0 || frameNumber < m_Settings.frameCount ) )
     {
-        glfwPollEvents();
+        PROFILE_SCOPE( "Frame" );
+        auto frameStart = std::chrono::high_resolution_clock::now();
+        if ( !headless )
+        {
+            PROFILE_SCOPE( "glfwPollEvents" );
+            glfwPollEvents();
+        }
         m_Window.UpdateFPS();
 
         auto newTime = std::chrono::high_resolution_clock::now();
         float frameTime = std::chrono::duration<float, std::chrono::seconds::period>( newTime - currentTime ).count();
         currentTime = newTime;
         frameTime = std::min( frameTime, 0.1f );
+        //Fixed steps so the same headless or benchmark run always renders the same frames
+        if ( headless || benchmark )
+        {
+            frameTime = 1.f / 60.f;
+        }
+
+        if ( m_Scene.IsAlive( physicsCubeEntity ) ) {
+            PROFILE_SCOPE( "PhysicsCube::UpdatePhysics" );
+            physicsCube.UpdatePhysics( inputWindow, frameTime, m_Scene.EditTransform( physicsCubeEntity ) );
+        }
 
-        if ( m_GameObjects.size() > 1 ) {
-            physicsCube.UpdatePhysics( m_Window.GetGLFWwindow(), frameTime, m_GameObjects[ 1 ] );
+        if ( benchmark )
+        {
+            Benchmark::ApplyCameraPath( frameNumber, m_Settings.frameCount, viewer );
+        }
+        camera.SetViewYXZ( viewer.translation, viewer.rotation);
+        if ( !benchmark )
+        {
+            PROFILE_SCOPE( "MovementController::UpdatePhysics" );
+            movementController.UpdatePhysics( inputWindow, frameTime, viewer );
         }
 
-        camera.SetViewYXZ( viewer.m_Transform.translation, viewer.m_Transform.rotation);
-        movementController.UpdatePhysics( m_Window.GetGLFWwindow(), frameTime, viewer );
+        //Only the entities that moved since the last frame are recomputed
+        m_Scene.UpdateTransforms();
 
         float aspect = m_Renderer.GetAspectRatio();
         camera.SetPerspectiveProjection(glm::radians( 45.f ), aspect, 0.1f, 10000.f );
+        simpleRenderSystem.SetViewportHeight( m_Renderer.GetRenderExtent().height );
 
         if ( auto commandBuffer = m_Renderer.BeginFrame() )
         {
@@ -107,6 +212,7 @@ void AppBase::Run()
             FrameInfo frameInfo{
                 frameIndex,  frameTime,
                 commandBuffer, camera, globalDescriptorSets[ frameIndex ] };
+            frameInfo.gpuProfiler = &m_Renderer.GetGpuProfiler();
 
             //update
             GlobalUbo ubo;
@@ -119,34 +225,98 @@ void AppBase::Run()
             globalUboBuffer.flushIndex( frameIndex );
 
             //render
-            m_Renderer.BeginSwapChainRenderPass( commandBuffer );
-            simpleRenderSystem.RenderGameObjects( frameInfo, m_GameObjects );
-            pointLightSystem.Render( frameInfo );
+            {
+                PROFILE_SCOPE( "RecordCommands" );
+                if ( indirectRenderSystem )
+                {
+                    indirectRenderSystem->Cull( frameInfo, m_Scene );
+                }
+
+                if ( m_Settings.parallelRecording )
+                {
+                    m_Renderer.BeginSwapChainRenderPass( commandBuffer, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS );
+                    ParallelRecorder& recorder = m_Renderer.GetParallelRecorder();
+                    if ( indirectRenderSystem )
+                    {
+                        recorder.RecordInline( frameInfo, [ & ]( FrameInfo& info ) { indirectRenderSystem->Render( info ); } );
+                    }
+                    else
+                    {
+                        simpleRenderSystem.RenderScene( frameInfo, m_Scene, recorder );
+                    }
+                    recorder.RecordInline( frameInfo, [ & ]( FrameInfo& info ) { pointLightSystem.Render( info ); } );
+                    recorder.Execute( commandBuffer );
+                }
+                else
+                {
+                    m_Renderer.BeginSwapChainRenderPass( commandBuffer );
+                    if ( indirectRenderSystem )
+                    {
+                        indirectRenderSystem->Render( frameInfo );
+                    }
+                    else
+                    {
+                        simpleRenderSystem.RenderScene( frameInfo, m_Scene );
+                    }
+                    pointLightSystem.Render( frameInfo );
+                }
+
+                m_Renderer.EndSwapChainRenderPass( commandBuffer );
+            }
 
-            m_Renderer.EndSwapChainRenderPass( commandBuffer );
+            if ( !m_Settings.captureDirectory.empty() && frameNumber % m_Settings.captureInterval == 0 )
+            {
+                m_Renderer.CaptureFrame( GetCapturePath( frameNumber ) );
+            }
             m_Renderer.EndFrame();
+            frameNumber++;
+
+            if ( benchmark )
+            {
+                double cpuFrameTime = std::chrono::duration<double, std::milli>( 
+                    std::chrono::high_resolution_clock::now() - frameStart ).count();
+                benchmark->AddFrame( cpuFrameTime, m_Renderer.GetGpuFrameTime(), frameInfo.drawCallCount,
+                    simpleRenderSystem.GetCullingStats().visibleCount );
+            }
         }
     }
 
 	vkDeviceWaitIdle( m_EngineDevice.Device() );
+
+    if ( benchmark )
+    {
+        benchmark->SetGpuScopes( m_Renderer.GetGpuProfiler().GetHistory() );
+        benchmark->WriteReport( m_Settings.benchmarkOutput );
+    }
+    if ( !m_Settings.traceOutput.empty() )
+    {
+        Profiler::Get().WriteChromeTrace( m_Settings.traceOutput );
+    }
 }
 
-void AppBase::LoadGameObjects()
+void AppBase::LoadScene()
 {
-    SceneLoader sceneLoader{};
-    auto gameObjects = sceneLoader.LoadGameObjects( m_EngineDevice, "Models/Scene1.json");
-    m_GameObjects = std::move( gameObjects );
+    PROFILE_FUNCTION();
+    SceneLoader sceneLoader{ m_ModelCache, m_Settings.vertexLayout };
+    sceneLoader.LoadScene( m_EngineDevice, m_Settings.scenePath, m_Scene );
+    m_Scene.UpdateTransforms();
+    m_ImportStats = sceneLoader.GetImportStats();
 
-    //SceneLoader sceneLoader{};
-	//auto gameObjects = sceneLoader.LoadGameObjects( m_EngineDevice, "Models/Scene2.json" );
-	//m_GameObjects = std::move( gameObjects );
+    //SceneLoader sceneLoader{ m_ModelCache };
+	//sceneLoader.LoadScene( m_EngineDevice, "Models/Scene2.json", m_Scene );
 
     //std::shared_ptr<Model> arena =
     //    Model::CreateModelFromFile(
     //        m_EngineDevice, "Models/Arena.obj" );
-    //auto gameObject = GameObject::Create();
-    //gameObject.m_Model = arena;
-    //gameObject.m_Transform.translation = { 0.f, 0.0f, 0.f };
-    //gameObject.m_Transform.scale = glm::vec3( 3.f );
-    //m_GameObjects.emplace_back( std::move( gameObject ) );
+    //TransformComponent transform{};
+    //transform.translation = { 0.f, 0.0f, 0.f };
+    //transform.scale = glm::vec3( 3.f );
+    //m_Scene.CreateEntity( m_Scene.AddModel( arena ), transform );
+}
+
+std::string AppBase::GetCapturePath( uint32_t frameNumber ) const
+{
+    std::string number = std::to_string( frameNumber );
+    number.insert( 0, number.size() < 5 ? 5 - number.size() : 0, '0' );
+    return ( std::filesystem::path( m_Settings.captureDirectory ) / ( "frame_" + number + ".ppm" ) ).string();
 }
\ No newline at end of file
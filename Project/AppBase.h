@@ -5,14 +5,16 @@
 #include "EngineDevice.h"
 #include "SwapChain.h"
 #include "Model.h"
-#include "GameObject.h"
+#include "Scene.h"
 #include "Renderer.h"
 #include "Descriptors.h"
+#include "ModelCache.h"
+#include "AppSettings.h"
 
 class AppBase
 {
 public:
-    AppBase();
+    explicit AppBase( const AppSettings& settings = AppSettings{} );
     ~AppBase();
 
     AppBase( const AppBase& ) = delete;
@@ -22,19 +24,24 @@ public:
 
     void Run();
 
-    std::vector<GameObject>& GetGameObjects() { return m_GameObjects; }
+    Scene& GetScene() { return m_Scene; }
 
 private:
-    void LoadGameObjects();
+    void LoadScene();
+    std::string GetCapturePath( uint32_t frameNumber ) const;
 
+    const AppSettings m_Settings;
+    double m_LoadTime = 0.0;
+    std::vector<Model::ImportStats> m_ImportStats;
     const int WIDTH;
     const int HEIGHT;
 
     Window m_Window;
     EngineDevice m_EngineDevice{ m_Window };
     Renderer m_Renderer{ m_Window, m_EngineDevice };
+    ModelCache m_ModelCache{ m_EngineDevice, m_Settings.splitLargeMeshes };
 
     std::unique_ptr<DescriptorPool> m_GlobalDescriptorPool;
 
-    std::vector<GameObject> m_GameObjects;
+    Scene m_Scene;
 };
\ No newline at end of file
@@ -0,0 +1,89 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+#include "VertexLayout.h"
+
+//Everything main.cpp can change from the command line
+struct AppSettings
+{
+    uint32_t width = 800;
+    uint32_t height = 600;
+    std::string scenePath = "Models/Scene1.json";
+
+    //No window or surface, frames go to an offscreen target
+    bool headless = false;
+    //0 runs until the window is closed, headless runs default to a single frame
+    uint32_t frameCount = 0;
+    //Writes <captureDirectory>/frame_<n>.ppm every captureInterval frames, empty disables it
+    std::string captureDirectory;
+    uint32_t captureInterval = 1;
+    //Flies a scripted camera path and writes a json report here when the run ends, empty disables it
+    std::string benchmarkOutput;
+    //Chrome trace of the cpu profiler scopes, only has events in builds with ENABLE_PROFILER
+    std::string traceOutput;
+    //Culls and builds the draws in a compute shader instead of on the cpu, per meshlet instead of per object
+    bool gpuCulling = false;
+    //Gpu culling also drops meshlets that face away from the camera. The pipelines draw back faces,
+    //so this only stays invisible on closed meshes, which is why it's opt in
+    bool coneCulling = false;
+    //Records the render pass into secondary command buffers on worker threads
+    bool parallelRecording = false;
+    //Vertex layout of every model whose scene entry doesn't pick one with "vertex_layout"
+    VertexLayout vertexLayout = VertexLayout::Full;
+    //Meshes over 65535 vertices become 16 bit indexed submeshes, off keeps them whole with 32 bit indices
+    bool splitLargeMeshes = true;
+    //Distant objects draw a simplified lod, off always draws the full mesh
+    bool lodEnabled = true;
+
+    static AppSettings Parse( int argc, char** argv )
+    {
+        AppSettings settings{};
+
+        auto nextValue = [ & ]( int& i ) -> std::string
+            {
+                if ( i + 1 >= argc )
+                {
+                    throw std::runtime_error( std::string( "Missing value for " ) + argv[ i ] );
+                }
+                return argv[ ++i ];
+            };
+
+        for ( int i = 1; i < argc; i++ )
+        {
+            const std::string argument = argv[ i ];
+
+            if ( argument == "--headless" ) settings.headless = true;
+            else if ( argument == "--scene" ) settings.scenePath = nextValue( i );
+            else if ( argument == "--width" ) settings.width = std::stoul( nextValue( i ) );
+            else if ( argument == "--height" ) settings.height = std::stoul( nextValue( i ) );
+            else if ( argument == "--frames" ) settings.frameCount = std::stoul( nextValue( i ) );
+            else if ( argument == "--capture" ) settings.captureDirectory = nextValue( i );
+            else if ( argument == "--capture-every" ) settings.captureInterval = std::stoul( nextValue( i ) );
+            else if ( argument == "--benchmark" ) settings.benchmarkOutput = nextValue( i );
+            else if ( argument == "--trace" ) settings.traceOutput = nextValue( i );
+            else if ( argument == "--gpu-culling" ) settings.gpuCulling = true;
+            else if ( argument == "--cone-culling" ) settings.coneCulling = true;
+            else if ( argument == "--parallel-recording" ) settings.parallelRecording = true;
+            else if ( argument == "--vertex-layout" ) settings.vertexLayout = ParseVertexLayout( nextValue( i ) );
+            else if ( argument == "--no-mesh-split" ) settings.splitLargeMeshes = false;
+            else if ( argument == "--no-lod" ) settings.lodEnabled = false;
+            else throw std::runtime_error( "Unknown argument: " + argument );
+        }
+
+        if ( !settings.benchmarkOutput.empty() && settings.frameCount == 0 )
+        {
+            settings.frameCount = 600;
+        }
+        if ( settings.headless && settings.frameCount == 0 )
+        {
+            settings.frameCount = 1;
+        }
+        if ( settings.captureInterval == 0 )
+        {
+            settings.captureInterval = 1;
+        }
+        return settings;
+    }
+};
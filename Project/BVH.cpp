@@ -0,0 +1,373 @@
+#include "BVH.h"
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+void BVH::Build( const std::vector<std::vector<glm::vec3>>& triangleSets )
+{
+    Clear();
+
+    std::vector<glm::vec3> vertices;
+    for ( const auto& triangles : triangleSets )
+    {
+        vertices.insert( vertices.end(), triangles.begin(), triangles.end() - triangles.size() % 3 );
+    }
+
+    const uint32_t triangleCount = static_cast< uint32_t >( vertices.size() / 3 );
+    if ( triangleCount == 0 )
+    {
+        return;
+    }
+
+    m_Centroids.resize( triangleCount );
+    m_TriangleIndices.resize( triangleCount );
+    for ( uint32_t i = 0; i < triangleCount; i++ )
+    {
+        m_Centroids[ i ] = ( vertices[ 3 * i ] + vertices[ 3 * i + 1 ] + vertices[ 3 * i + 2 ] ) / 3.0f;
+        m_TriangleIndices[ i ] = i;
+    }
+
+    //Worst case a binary tree has 2N-1 nodes
+    m_Nodes.reserve( 2 * triangleCount - 1 );
+    m_Nodes.push_back( Node{ {}, 0, {}, triangleCount } );
+    UpdateNodeBounds( 0, vertices );
+    Subdivide( vertices );
+
+    //Store the triangles in leaf order, so a leaf reads one contiguous range
+    m_Triangles.resize( triangleCount );
+    for ( uint32_t i = 0; i < triangleCount; i++ )
+    {
+        const uint32_t index = m_TriangleIndices[ i ];
+        const glm::vec3& vertex0 = vertices[ 3 * index ];
+        m_Triangles[ i ] = Triangle{ vertex0, vertices[ 3 * index + 1 ] - vertex0, vertices[ 3 * index + 2 ] - vertex0 };
+    }
+
+    m_Centroids.clear();
+    m_Centroids.shrink_to_fit();
+    m_TriangleIndices.clear();
+    m_TriangleIndices.shrink_to_fit();
+    m_Nodes.shrink_to_fit();
+}
+
+void BVH::Clear()
+{
+    m_Nodes.clear();
+    m_Triangles.clear();
+    m_Centroids.clear();
+    m_TriangleIndices.clear();
+}
+
+bool BVH::Raycast( const glm::vec3& origin, const glm::vec3& direction,
+    float minDistance, float maxDistance, RayHit& hit ) const
+{
+    if ( m_Nodes.empty() )
+    {
+        return false;
+    }
+
+    constexpr float miss = std::numeric_limits<float>::max();
+    const glm::vec3 inverseDirection = 1.0f / direction;
+
+    if ( IntersectAABB( origin, inverseDirection, m_Nodes[ 0 ].boundsMin, m_Nodes[ 0 ].boundsMax, maxDistance ) == miss )
+    {
+        return false;
+    }
+
+    float closestDistance = maxDistance;
+    bool foundHit = false;
+
+    uint32_t stack[ MAX_STACK_DEPTH ];
+    int stackSize = 0;
+    uint32_t nodeIndex = 0;
+
+    while ( true )
+    {
+        const Node& node = m_Nodes[ nodeIndex ];
+
+        if ( node.IsLeaf() )
+        {
+            for ( uint32_t i = node.leftFirst; i < node.leftFirst + node.triangleCount; i++ )
+            {
+                float distance;
+                if ( IntersectTriangle( origin, direction, m_Triangles[ i ], distance ) &&
+                    distance > minDistance && distance < closestDistance )
+                {
+                    closestDistance = distance;
+                    hit.distance = distance;
+                    hit.triangleIndex = i;
+                    foundHit = true;
+                }
+            }
+
+            if ( stackSize == 0 ) { break; }
+            nodeIndex = stack[ --stackSize ];
+            continue;
+        }
+
+        //Visit the nearest child first, so the far one can often be skipped
+        uint32_t nearChild = node.leftFirst;
+        uint32_t farChild = node.leftFirst + 1;
+        float nearDistance = IntersectAABB( origin, inverseDirection,
+            m_Nodes[ nearChild ].boundsMin, m_Nodes[ nearChild ].boundsMax, closestDistance );
+        float farDistance = IntersectAABB( origin, inverseDirection,
+            m_Nodes[ farChild ].boundsMin, m_Nodes[ farChild ].boundsMax, closestDistance );
+
+        if ( nearDistance > farDistance )
+        {
+            std::swap( nearDistance, farDistance );
+            std::swap( nearChild, farChild );
+        }
+
+        if ( nearDistance == miss )
+        {
+            if ( stackSize == 0 ) { break; }
+            nodeIndex = stack[ --stackSize ];
+            continue;
+        }
+
+        nodeIndex = nearChild;
+        if ( farDistance != miss )
+        {
+            assert( stackSize < MAX_STACK_DEPTH && "BVH traversal stack overflow" );
+            stack[ stackSize++ ] = farChild;
+        }
+    }
+
+    return foundHit;
+}
+
+void BVH::UpdateNodeBounds( uint32_t nodeIndex, const std::vector<glm::vec3>& vertices )
+{
+    Node& node = m_Nodes[ nodeIndex ];
+    node.boundsMin = glm::vec3( std::numeric_limits<float>::max() );
+    node.boundsMax = glm::vec3( std::numeric_limits<float>::lowest() );
+
+    for ( uint32_t i = node.leftFirst; i < node.leftFirst + node.triangleCount; i++ )
+    {
+        const uint32_t index = m_TriangleIndices[ i ];
+        for ( uint32_t v = 0; v < 3; v++ )
+        {
+            node.boundsMin = glm::min( node.boundsMin, vertices[ 3 * index + v ] );
+            node.boundsMax = glm::max( node.boundsMax, vertices[ 3 * index + v ] );
+        }
+    }
+}
+
+void BVH::Subdivide( const std::vector<glm::vec3>& vertices )
+{
+    //Iterative, so huge meshes can't blow the call stack. The depth cap keeps traversal inside its fixed stack.
+    struct BuildEntry { uint32_t nodeIndex; int depth; };
+    std::vector<BuildEntry> buildStack{ { 0, 0 } };
+
+    while ( !buildStack.empty() )
+    {
+        const BuildEntry entry = buildStack.back();
+        buildStack.pop_back();
+
+        const Node node = m_Nodes[ entry.nodeIndex ];
+        if ( node.triangleCount <= MAX_LEAF_TRIANGLES || entry.depth >= MAX_STACK_DEPTH - 1 )
+        {
+            continue;
+        }
+
+        const Split split = FindBestSplit( node, vertices );
+        const float leafCost = node.triangleCount * SurfaceArea( node.boundsMin, node.boundsMax );
+        if ( split.axis < 0 || split.cost >= leafCost )
+        {
+            continue;
+        }
+
+        //Partition the triangle indices in place
+        uint32_t left = node.leftFirst;
+        uint32_t right = node.leftFirst + node.triangleCount;
+        while ( left < right )
+        {
+            if ( GetBin( split, m_TriangleIndices[ left ] ) <= split.bin )
+            {
+                left++;
+            }
+            else
+            {
+                std::swap( m_TriangleIndices[ left ], m_TriangleIndices[ --right ] );
+            }
+        }
+
+        const uint32_t leftCount = left - node.leftFirst;
+        if ( leftCount == 0 || leftCount == node.triangleCount )
+        {
+            continue;
+        }
+
+        const uint32_t leftChild = static_cast< uint32_t >( m_Nodes.size() );
+        m_Nodes.push_back( Node{ {}, node.leftFirst, {}, leftCount } );
+        m_Nodes.push_back( Node{ {}, left, {}, node.triangleCount - leftCount } );
+        UpdateNodeBounds( leftChild, vertices );
+        UpdateNodeBounds( leftChild + 1, vertices );
+
+        m_Nodes[ entry.nodeIndex ].leftFirst = leftChild;
+        m_Nodes[ entry.nodeIndex ].triangleCount = 0;
+
+        buildStack.push_back( { leftChild, entry.depth + 1 } );
+        buildStack.push_back( { leftChild + 1, entry.depth + 1 } );
+    }
+}
+
+BVH::Split BVH::FindBestSplit( const Node& node, const std::vector<glm::vec3>& vertices ) const
+{
+    Split bestSplit{};
+    bestSplit.cost = std::numeric_limits<float>::max();
+
+    glm::vec3 centroidMin{ std::numeric_limits<float>::max() };
+    glm::vec3 centroidMax{ std::numeric_limits<float>::lowest() };
+    for ( uint32_t i = node.leftFirst; i < node.leftFirst + node.triangleCount; i++ )
+    {
+        centroidMin = glm::min( centroidMin, m_Centroids[ m_TriangleIndices[ i ] ] );
+        centroidMax = glm::max( centroidMax, m_Centroids[ m_TriangleIndices[ i ] ] );
+    }
+
+    for ( int axis = 0; axis < 3; axis++ )
+    {
+        const float extent = centroidMax[ axis ] - centroidMin[ axis ];
+        if ( extent <= 0.0f )
+        {
+            continue;
+        }
+
+        Split candidate{};
+        candidate.axis = axis;
+        candidate.centroidMin = centroidMin[ axis ];
+        candidate.binScale = BIN_COUNT / extent;
+
+        glm::vec3 binMin[ BIN_COUNT ];
+        glm::vec3 binMax[ BIN_COUNT ];
+        uint32_t binCount[ BIN_COUNT ]{};
+        for ( int b = 0; b < BIN_COUNT; b++ )
+        {
+            binMin[ b ] = glm::vec3( std::numeric_limits<float>::max() );
+            binMax[ b ] = glm::vec3( std::numeric_limits<float>::lowest() );
+        }
+
+        for ( uint32_t i = node.leftFirst; i < node.leftFirst + node.triangleCount; i++ )
+        {
+            const uint32_t index = m_TriangleIndices[ i ];
+            const int bin = GetBin( candidate, index );
+            binCount[ bin ]++;
+            for ( uint32_t v = 0; v < 3; v++ )
+            {
+                binMin[ bin ] = glm::min( binMin[ bin ], vertices[ 3 * index + v ] );
+                binMax[ bin ] = glm::max( binMax[ bin ], vertices[ 3 * index + v ] );
+            }
+        }
+
+        //Sweep from both sides to get the cost of every plane between two bins
+        float leftArea[ BIN_COUNT - 1 ];
+        float rightArea[ BIN_COUNT - 1 ];
+        uint32_t leftCount[ BIN_COUNT - 1 ];
+        uint32_t rightCount[ BIN_COUNT - 1 ];
+
+        glm::vec3 leftMin{ std::numeric_limits<float>::max() };
+        glm::vec3 leftMax{ std::numeric_limits<float>::lowest() };
+        glm::vec3 rightMin{ std::numeric_limits<float>::max() };
+        glm::vec3 rightMax{ std::numeric_limits<float>::lowest() };
+        uint32_t leftSum = 0;
+        uint32_t rightSum = 0;
+
+        for ( int b = 0; b < BIN_COUNT - 1; b++ )
+        {
+            leftSum += binCount[ b ];
+            leftCount[ b ] = leftSum;
+            if ( binCount[ b ] > 0 )
+            {
+                leftMin = glm::min( leftMin, binMin[ b ] );
+                leftMax = glm::max( leftMax, binMax[ b ] );
+            }
+            leftArea[ b ] = leftSum > 0 ? SurfaceArea( leftMin, leftMax ) : 0.0f;
+
+            const int mirrored = BIN_COUNT - 1 - b;
+            rightSum += binCount[ mirrored ];
+            rightCount[ mirrored - 1 ] = rightSum;
+            if ( binCount[ mirrored ] > 0 )
+            {
+                rightMin = glm::min( rightMin, binMin[ mirrored ] );
+                rightMax = glm::max( rightMax, binMax[ mirrored ] );
+            }
+            rightArea[ mirrored - 1 ] = rightSum > 0 ? SurfaceArea( rightMin, rightMax ) : 0.0f;
+        }
+
+        for ( int b = 0; b < BIN_COUNT - 1; b++ )
+        {
+            const float cost = leftCount[ b ] * leftArea[ b ] + rightCount[ b ] * rightArea[ b ];
+            if ( cost < bestSplit.cost )
+            {
+                bestSplit = candidate;
+                bestSplit.bin = b;
+                bestSplit.cost = cost;
+            }
+        }
+    }
+
+    return bestSplit;
+}
+
+int BVH::GetBin( const Split& split, uint32_t triangleIndex ) const
+{
+    const int bin = static_cast< int >( ( m_Centroids[ triangleIndex ][ split.axis ] - split.centroidMin ) * split.binScale );
+    return std::min( std::max( bin, 0 ), BIN_COUNT - 1 );
+}
+
+float BVH::SurfaceArea( const glm::vec3& boundsMin, const glm::vec3& boundsMax )
+{
+    const glm::vec3 extent = boundsMax - boundsMin;
+    return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+}
+
+float BVH::IntersectAABB( const glm::vec3& origin, const glm::vec3& inverseDirection,
+    const glm::vec3& boundsMin, const glm::vec3& boundsMax, float maxDistance )
+{
+    //Slab test
+    const glm::vec3 t0 = ( boundsMin - origin ) * inverseDirection;
+    const glm::vec3 t1 = ( boundsMax - origin ) * inverseDirection;
+    const glm::vec3 tNear = glm::min( t0, t1 );
+    const glm::vec3 tFar = glm::max( t0, t1 );
+
+    const float entry = std::max( std::max( tNear.x, tNear.y ), tNear.z );
+    const float exit = std::min( std::min( tFar.x, tFar.y ), tFar.z );
+
+    if ( exit >= entry && entry < maxDistance && exit > 0.0f )
+    {
+        return entry;
+    }
+    return std::numeric_limits<float>::max();
+}
+
+bool BVH::IntersectTriangle( const glm::vec3& origin, const glm::vec3& direction,
+    const Triangle& triangle, float& distance )
+{
+    //Möller-Trumbore, two sided. Only reject (nearly) parallel rays, world space triangles can be tiny.
+    constexpr float parallelEpsilon = 1e-12f;
+
+    const glm::vec3 p = glm::cross( direction, triangle.edge2 );
+    const float determinant = glm::dot( triangle.edge1, p );
+    if ( std::abs( determinant ) < parallelEpsilon )
+    {
+        return false;
+    }
+
+    const float inverseDeterminant = 1.0f / determinant;
+    const glm::vec3 s = origin - triangle.vertex0;
+    const float u = glm::dot( s, p ) * inverseDeterminant;
+    if ( u < 0.0f || u > 1.0f )
+    {
+        return false;
+    }
+
+    const glm::vec3 q = glm::cross( s, triangle.edge1 );
+    const float v = glm::dot( direction, q ) * inverseDeterminant;
+    if ( v < 0.0f || u + v > 1.0f )
+    {
+        return false;
+    }
+
+    distance = glm::dot( triangle.edge2, q ) * inverseDeterminant;
+    return true;
+}
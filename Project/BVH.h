@@ -0,0 +1,83 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+//Bounding volume hierarchy over world space triangles, built with a binned SAH.
+//Build it once from your transformed triangles, then raycast against it every frame.
+class BVH
+{
+public:
+    struct RayHit
+    {
+        float distance = 0.0f;
+        uint32_t triangleIndex = 0;
+    };
+
+    BVH() = default;
+
+    //Every vector holds a triangle list (3 vertices per triangle), like MovementController::m_TransformedTriangles
+    void Build( const std::vector<std::vector<glm::vec3>>& triangleSets );
+    void Clear();
+
+    //Closest hit in ]minDistance, maxDistance[
+    bool Raycast( const glm::vec3& origin, const glm::vec3& direction,
+        float minDistance, float maxDistance, RayHit& hit ) const;
+
+    bool IsEmpty() const { return m_Nodes.empty(); }
+    size_t GetTriangleCount() const { return m_Triangles.size(); }
+    size_t GetNodeCount() const { return m_Nodes.size(); }
+
+private:
+    //32 bytes, leftFirst is the first child for inner nodes and the first triangle for leaves
+    struct Node
+    {
+        glm::vec3 boundsMin;
+        uint32_t leftFirst;
+        glm::vec3 boundsMax;
+        uint32_t triangleCount;
+
+        bool IsLeaf() const { return triangleCount > 0; }
+    };
+
+    //Stored as vertex + edges so the intersection test doesn't have to recompute them
+    struct Triangle
+    {
+        glm::vec3 vertex0;
+        glm::vec3 edge1;
+        glm::vec3 edge2;
+    };
+
+    //A split puts every triangle whose centroid lands in bins [0, bin] on the left
+    struct Split
+    {
+        int axis = -1;
+        int bin = 0;
+        float centroidMin = 0.0f;
+        float binScale = 0.0f;
+        float cost = 0.0f;
+    };
+
+    void UpdateNodeBounds( uint32_t nodeIndex, const std::vector<glm::vec3>& vertices );
+    void Subdivide( const std::vector<glm::vec3>& vertices );
+    Split FindBestSplit( const Node& node, const std::vector<glm::vec3>& vertices ) const;
+    int GetBin( const Split& split, uint32_t triangleIndex ) const;
+
+    static float SurfaceArea( const glm::vec3& boundsMin, const glm::vec3& boundsMax );
+    static float IntersectAABB( const glm::vec3& origin, const glm::vec3& inverseDirection,
+        const glm::vec3& boundsMin, const glm::vec3& boundsMax, float maxDistance );
+    static bool IntersectTriangle( const glm::vec3& origin, const glm::vec3& direction,
+        const Triangle& triangle, float& distance );
+
+    static constexpr int BIN_COUNT = 12;
+    static constexpr uint32_t MAX_LEAF_TRIANGLES = 2;
+    static constexpr int MAX_STACK_DEPTH = 64;
+
+    std::vector<Node> m_Nodes{};
+    std::vector<Triangle> m_Triangles{};
+    std::vector<glm::vec3> m_Centroids{};
+    std::vector<uint32_t> m_TriangleIndices{};
+};
@@ -0,0 +1,143 @@
+#include "Benchmark.h"
+#include "json.hpp"
+#include <glm/gtc/constants.hpp>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <cmath>
+#include <stdexcept>
+
+using json = nlohmann::json;
+
+Benchmark::Benchmark( const AppSettings& settings )
+    : m_Settings{ settings }
+{
+    m_CpuFrameTimes.reserve( settings.frameCount );
+    m_GpuFrameTimes.reserve( settings.frameCount );
+    m_DrawCalls.reserve( settings.frameCount );
+    m_VisibleObjects.reserve( settings.frameCount );
+}
+
+void Benchmark::ApplyCameraPath( uint32_t frameNumber, uint32_t frameCount, TransformComponent& transform )
+{
+    //One orbit around the scene origin over the whole run, bobbing up and down twice
+    const float progress = frameCount > 0 ? static_cast< float >( frameNumber ) / static_cast< float >( frameCount ) : 0.f;
+    const float angle = progress * glm::two_pi<float>();
+    const float radius = 25.f;
+
+    transform.translation = { radius * std::sin( angle ), -5.f - 3.f * std::sin( 2.f * angle ), radius * std::cos( angle ) };
+
+    //Same yaw convention as MovementController, forward is { sin( yaw ), 0, cos( yaw ) }, so this looks at the origin
+    transform.rotation = { -0.15f + 0.1f * std::cos( 2.f * angle ), angle + glm::pi<float>(), 0.f };
+}
+
+void Benchmark::AddFrame( double cpuMilliseconds, float gpuMilliseconds, uint32_t drawCalls, uint32_t visibleObjects )
+{
+    if ( m_FrameCount++ < WARMUP_FRAMES )
+    {
+        return;
+    }
+
+    m_CpuFrameTimes.push_back( cpuMilliseconds );
+    if ( gpuMilliseconds > 0.f )
+    {
+        m_GpuFrameTimes.push_back( gpuMilliseconds );
+    }
+    m_DrawCalls.push_back( static_cast< double >( drawCalls ) );
+    m_VisibleObjects.push_back( static_cast< double >( visibleObjects ) );
+}
+
+Benchmark::Statistics Benchmark::ComputeStatistics( std::vector<double> samples )
+{
+    Statistics statistics{};
+    if ( samples.empty() )
+    {
+        return statistics;
+    }
+
+    std::sort( samples.begin(), samples.end() );
+
+    //Nearest rank, so every reported value is a frame that actually happened
+    auto percentile = [ &samples ]( double fraction )
+        {
+            const size_t rank = static_cast< size_t >( std::ceil( fraction * samples.size() ) );
+            return samples[ std::clamp<size_t>( rank, 1, samples.size() ) - 1 ];
+        };
+
+    statistics.mean = std::accumulate( samples.begin(), samples.end(), 0.0 ) / samples.size();
+    statistics.p50 = percentile( 0.50 );
+    statistics.p95 = percentile( 0.95 );
+    statistics.p99 = percentile( 0.99 );
+    statistics.max = samples.back();
+    return statistics;
+}
+
+void Benchmark::WriteReport( const std::string& file ) const
+{
+    auto toJson = []( const Statistics& statistics )
+        {
+            return json{
+                { "mean", statistics.mean },
+                { "p50", statistics.p50 },
+                { "p95", statistics.p95 },
+                { "p99", statistics.p99 },
+                { "max", statistics.max } };
+        };
+
+    json report;
+    report[ "scene" ] = m_Settings.scenePath;
+    report[ "width" ] = m_Settings.width;
+    report[ "height" ] = m_Settings.height;
+    report[ "headless" ] = m_Settings.headless;
+    report[ "frames" ] = m_FrameCount;
+    report[ "measuredFrames" ] = m_CpuFrameTimes.size();
+    report[ "warmupFrames" ] = std::min( m_FrameCount, WARMUP_FRAMES );
+    report[ "loadTimeMs" ] = m_LoadTime;
+    report[ "vertexBytes" ] = m_VertexBytes;
+    report[ "fullVertexBytes" ] = m_FullVertexBytes;
+    report[ "indexBytes" ] = m_IndexBytes;
+    report[ "gpuMemory" ] = json{
+        { "allocations", m_MemoryStats.allocationCount },
+        { "deviceAllocations", m_MemoryStats.GetDeviceAllocationCount() },
+        { "usedBytes", m_MemoryStats.usedBytes },
+        { "reservedBytes", m_MemoryStats.reservedBytes } };
+    report[ "pipelineCreationMs" ] = m_PipelineCreationTime;
+    report[ "pipelineCacheWarm" ] = m_WarmPipelineCache;
+    report[ "cpuFrameTimeMs" ] = toJson( ComputeStatistics( m_CpuFrameTimes ) );
+    report[ "gpuFrameTimeMs" ] = toJson( ComputeStatistics( m_GpuFrameTimes ) );
+    report[ "drawCalls" ] = toJson( ComputeStatistics( m_DrawCalls ) );
+    report[ "visibleObjects" ] = toJson( ComputeStatistics( m_VisibleObjects ) );
+
+    report[ "gpuScopesMs" ] = json::array();
+    for ( const GpuProfiler::ScopeHistory& scope : m_GpuScopes )
+    {
+        report[ "gpuScopesMs" ].push_back( json{
+            { "name", scope.name },
+            { "mean", scope.GetAverage() },
+            { "max", scope.GetMax() },
+            { "samples", scope.sampleCount } } );
+    }
+
+    report[ "importedMeshes" ] = json::array();
+    for ( const Model::ImportStats& importStats : m_ImportStats )
+    {
+        report[ "importedMeshes" ].push_back( json{
+            { "file", importStats.filename },
+            { "acmrBefore", importStats.before.acmr },
+            { "acmrAfter", importStats.after.acmr },
+            { "atvrBefore", importStats.before.atvr },
+            { "atvrAfter", importStats.after.atvr } } );
+    }
+
+    std::ofstream output{ file };
+    if ( !output.is_open() )
+    {
+        throw std::runtime_error( "Failed to write benchmark report: " + file );
+    }
+    output << report.dump( 4 ) << std::endl;
+
+    std::cout << "benchmark: " << m_CpuFrameTimes.size() << " frames, cpu p50 "
+        << report[ "cpuFrameTimeMs" ][ "p50" ] << " ms, p99 " << report[ "cpuFrameTimeMs" ][ "p99" ]
+        << " ms, report written to " << file << std::endl;
+}
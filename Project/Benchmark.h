@@ -0,0 +1,76 @@
+#pragma once
+#include "AppSettings.h"
+#include "FrameInfo.h"
+#include "GpuProfiler.h"
+#include "MemoryAllocator.h"
+#include "Model.h"
+#include <string>
+#include <vector>
+
+//Scripted run to catch performance regressions between builds.
+//Flies the viewer along a fixed path and writes frame time percentiles, gpu time per scope, draw calls and load time as json,
+//plus the scene's geometry size, gpu memory use and the vertex cache stats of every mesh imported during the load.
+class Benchmark
+{
+public:
+    //Frames at the start that only warm up caches and pipelines, left out of the statistics
+    static constexpr uint32_t WARMUP_FRAMES = 10;
+
+    explicit Benchmark( const AppSettings& settings );
+
+    //The same frame always gets the same transform, no matter how long the previous frames took
+    static void ApplyCameraPath( uint32_t frameNumber, uint32_t frameCount, TransformComponent& transform );
+
+    void SetLoadTime( double milliseconds ) { m_LoadTime = milliseconds; }
+    //Meshes that came from source files instead of the mesh cache
+    void SetImportStats( const std::vector<Model::ImportStats>& importStats ) { m_ImportStats = importStats; }
+    //Vertex and index buffer bytes of every model in the scene, fullVertexBytes is the vertices as fp32
+    void SetGeometrySize( VkDeviceSize vertexBytes, VkDeviceSize fullVertexBytes, VkDeviceSize indexBytes )
+    {
+        m_VertexBytes = vertexBytes;
+        m_FullVertexBytes = fullVertexBytes;
+        m_IndexBytes = indexBytes;
+    }
+    //Allocator state once the scene is loaded
+    void SetMemoryStats( const MemoryStats& memoryStats ) { m_MemoryStats = memoryStats; }
+    //Total time spent creating pipelines, warmCache tells if the pipeline cache came from disk
+    void SetPipelineCreationTime( double milliseconds, bool warmCache )
+    {
+        m_PipelineCreationTime = milliseconds;
+        m_WarmPipelineCache = warmCache;
+    }
+    //gpuMilliseconds can be from an older frame, the renderer only knows it a few frames later
+    void AddFrame( double cpuMilliseconds, float gpuMilliseconds, uint32_t drawCalls, uint32_t visibleObjects );
+    //Call after the last frame, the profiler only keeps the last HISTORY_SIZE frames of every scope
+    void SetGpuScopes( const std::vector<GpuProfiler::ScopeHistory>& scopes ) { m_GpuScopes = scopes; }
+
+    void WriteReport( const std::string& file ) const;
+
+private:
+    struct Statistics
+    {
+        double mean = 0.0;
+        double p50 = 0.0;
+        double p95 = 0.0;
+        double p99 = 0.0;
+        double max = 0.0;
+    };
+    static Statistics ComputeStatistics( std::vector<double> samples );
+
+    const AppSettings m_Settings;
+    double m_LoadTime = 0.0;
+    std::vector<Model::ImportStats> m_ImportStats;
+    VkDeviceSize m_VertexBytes = 0;
+    VkDeviceSize m_FullVertexBytes = 0;
+    VkDeviceSize m_IndexBytes = 0;
+    MemoryStats m_MemoryStats;
+    double m_PipelineCreationTime = 0.0;
+    bool m_WarmPipelineCache = false;
+    uint32_t m_FrameCount = 0;
+
+    std::vector<double> m_CpuFrameTimes;
+    std::vector<double> m_GpuFrameTimes;
+    std::vector<double> m_DrawCalls;
+    std::vector<double> m_VisibleObjects;
+    std::vector<GpuProfiler::ScopeHistory> m_GpuScopes;
+};
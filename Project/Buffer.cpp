@@ -1,6 +1,7 @@
 #include "Buffer.h"
 #include <cassert>
 #include <cstring>
+#include <algorithm>
 
 VkDeviceSize Buffer::getAlignment( VkDeviceSize instanceSize, VkDeviceSize minOffsetAlignment ) {
     if ( minOffsetAlignment > 0 ) {
@@ -30,19 +31,39 @@ Buffer::Buffer(
 Buffer::~Buffer() {
     unmap();
     vkDestroyBuffer( m_EngineDevice.Device(), m_Buffer, nullptr );
-    vkFreeMemory( m_EngineDevice.Device(), m_Memory, nullptr );
+    m_EngineDevice.FreeMemory( m_Memory );
 }
 
+//The block is mapped once by the allocator, mapping a buffer just hands out a pointer into it
 VkResult Buffer::map( VkDeviceSize size, VkDeviceSize offset ) {
-    assert( m_Buffer && m_Memory && "Called map on buffer before create" );
-    return vkMapMemory( m_EngineDevice.Device(), m_Memory, offset, size, 0, &m_Mapped );
+    assert( m_Buffer && m_Memory.IsValid() && "Called map on buffer before create" );
+    if ( m_Memory.mapped == nullptr ) {
+        return VK_ERROR_MEMORY_MAP_FAILED;
+    }
+    m_Mapped = static_cast< char* >( m_Memory.mapped ) + offset;
+    return VK_SUCCESS;
 }
 
 void Buffer::unmap() {
-    if ( m_Mapped ) {
-        vkUnmapMemory( m_EngineDevice.Device(), m_Memory );
-        m_Mapped = nullptr;
-    }
+    m_Mapped = nullptr;
+}
+
+//Ranges are relative to the buffer, the memory is shared so offset them into the block and round to whole atoms
+VkMappedMemoryRange Buffer::getMappedRange( VkDeviceSize size, VkDeviceSize offset ) const {
+    const VkDeviceSize atomSize = std::max<VkDeviceSize>( m_EngineDevice.properties.limits.nonCoherentAtomSize, 1 );
+    const VkDeviceSize rangeEnd = m_Memory.offset + m_Memory.size;
+
+    VkDeviceSize begin = m_Memory.offset + offset;
+    VkDeviceSize end = size == VK_WHOLE_SIZE ? rangeEnd : begin + size;
+    begin = begin / atomSize * atomSize;
+    end = std::min( ( end + atomSize - 1 ) / atomSize * atomSize, rangeEnd );
+
+    VkMappedMemoryRange mappedRange = {};
+    mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    mappedRange.memory = m_Memory.memory;
+    mappedRange.offset = begin;
+    mappedRange.size = end - begin;
+    return mappedRange;
 }
 
 void Buffer::writeToBuffer( void* data, VkDeviceSize size, VkDeviceSize offset ) {
@@ -59,20 +80,12 @@ void Buffer::writeToBuffer( void* data, VkDeviceSize size, VkDeviceSize offset )
 }
 
 VkResult Buffer::flush( VkDeviceSize size, VkDeviceSize offset ) {
-    VkMappedMemoryRange mappedRange = {};
-    mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-    mappedRange.memory = m_Memory;
-    mappedRange.offset = offset;
-    mappedRange.size = size;
+    VkMappedMemoryRange mappedRange = getMappedRange( size, offset );
     return vkFlushMappedMemoryRanges( m_EngineDevice.Device(), 1, &mappedRange );
 }
 
 VkResult Buffer::invalidate( VkDeviceSize size, VkDeviceSize offset ) {
-    VkMappedMemoryRange mappedRange = {};
-    mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-    mappedRange.memory = m_Memory;
-    mappedRange.offset = offset;
-    mappedRange.size = size;
+    VkMappedMemoryRange mappedRange = getMappedRange( size, offset );
     return vkInvalidateMappedMemoryRanges( m_EngineDevice.Device(), 1, &mappedRange );
 }
 
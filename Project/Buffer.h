@@ -36,14 +36,16 @@ public:
     VkBufferUsageFlags getUsageFlags() const { return m_UsageFlags; }
     VkMemoryPropertyFlags getMemoryPropertyFlags() const { return m_MemoryPropertyFlags; }
     VkDeviceSize getBufferSize() const { return m_BufferSize; }
+    const MemoryAllocation& getMemory() const { return m_Memory; }
 
 private:
     static VkDeviceSize getAlignment( VkDeviceSize instanceSize, VkDeviceSize minOffsetAlignment );
+    VkMappedMemoryRange getMappedRange( VkDeviceSize size, VkDeviceSize offset ) const;
 
     EngineDevice& m_EngineDevice;
     void* m_Mapped = nullptr;
     VkBuffer m_Buffer = VK_NULL_HANDLE;
-    VkDeviceMemory m_Memory = VK_NULL_HANDLE;
+    MemoryAllocation m_Memory{};
 
     VkDeviceSize m_BufferSize;
     uint32_t m_InstanceCount;
@@ -64,6 +64,7 @@ public:
         m_ViewMatrix[ 3 ][ 0 ] = -glm::dot( u, pos );
         m_ViewMatrix[ 3 ][ 1 ] = -glm::dot( v, pos );
         m_ViewMatrix[ 3 ][ 2 ] = -glm::dot( w, pos );
+        m_Position = pos;
 	}
 
 	void SetViewYXZ( 
@@ -92,6 +93,7 @@ public:
         m_ViewMatrix[ 3 ][ 0 ] = -glm::dot( u, pos );
         m_ViewMatrix[ 3 ][ 1 ] = -glm::dot( v, pos );
         m_ViewMatrix[ 3 ][ 2 ] = -glm::dot( w, pos );
+        m_Position = pos;
 	}
 
     void SetViewTarget(
@@ -102,7 +104,7 @@ public:
 		SetViewDirection( pos, target - pos, up );
 	}
 
-	const glm::mat4& GetViewProjectionMatrix()
+	glm::mat4 GetViewProjectionMatrix() const
 	{
 		return m_ProjectionMatrix * m_ViewMatrix;
 	}
@@ -115,9 +117,14 @@ public:
 	{
 		return m_ViewMatrix;
 	}
+    const glm::vec3& GetPosition() const
+	{
+		return m_Position;
+	}
 
 private:
 
     glm::mat4 m_ProjectionMatrix{ 1.f };
     glm::mat4 m_ViewMatrix{ 1.f };
+    glm::vec3 m_Position{ 0.f };
 };
@@ -52,15 +52,25 @@ EngineDevice::EngineDevice(Window &window) : m_Window{window}
 {
   CreateInstance();
   SetupDebugMessenger();
-  CreateSurface();
+  if (!m_Window.IsHeadless()) {
+    CreateSurface();
+  }
   PickPhysicalDevice();
   CreateLogicalDevice();
   CreateCommandPool();
+  CreateAllocator();
+  CreateUploadQueue();
+  CreatePipelineCache();
   //CreateTextureImage();
 }
 
 EngineDevice::~EngineDevice() 
 {
+  m_PipelineCache.reset();
+  m_UploadQueue.reset();
+  m_Allocator.reset();
+  m_MemoryBackend.reset();
+
   vkDestroyCommandPool(m_Device, m_CommandPool, nullptr);
   vkDestroyDevice(m_Device, nullptr);
 
@@ -68,7 +78,9 @@ EngineDevice::~EngineDevice()
     DestroyDebugUtilsMessengerEXT(m_Instance, m_DebugMessenger, nullptr);
   }
 
-  vkDestroySurfaceKHR(m_Instance, m_Surface, nullptr);
+  if (m_Surface != VK_NULL_HANDLE) {
+    vkDestroySurfaceKHR(m_Instance, m_Surface, nullptr);
+  }
   vkDestroyInstance(m_Instance, nullptr);
 }
 
@@ -161,8 +173,15 @@ void EngineDevice::CreateLogicalDevice()
     queueCreateInfos.push_back(queueCreateInfo);
   }
 
+  VkPhysicalDeviceFeatures supportedFeatures;
+  vkGetPhysicalDeviceFeatures(m_PhysicalDevice, &supportedFeatures);
+
   VkPhysicalDeviceFeatures deviceFeatures = {};
-  deviceFeatures.samplerAnisotropy = VK_TRUE;
+  deviceFeatures.samplerAnisotropy = supportedFeatures.samplerAnisotropy;
+  // Gpu driven rendering writes many draws with their own firstInstance into one buffer
+  deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+  deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+  enabledFeatures = deviceFeatures;
 
   VkDeviceCreateInfo createInfo = {};
   createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -171,8 +190,13 @@ void EngineDevice::CreateLogicalDevice()
   createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
   createInfo.pEnabledFeatures = &deviceFeatures;
-  createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-  createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+  std::vector<const char *> extensions = GetDeviceExtensions();
+  const bool hasDrawIndirectCount = IsDeviceExtensionAvailable(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+  if (hasDrawIndirectCount) {
+    extensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+  }
+  createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+  createInfo.ppEnabledExtensionNames = extensions.data();
 
   if (enableValidationLayers) 
   {
@@ -186,6 +210,11 @@ void EngineDevice::CreateLogicalDevice()
     throw std::runtime_error("failed to create logical device!");
   }
 
+  if (hasDrawIndirectCount) {
+    cmdDrawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(
+        vkGetDeviceProcAddr(m_Device, "vkCmdDrawIndexedIndirectCountKHR"));
+  }
+
   vkGetDeviceQueue(m_Device, indices.graphicsFamily, 0, &m_GraphicsQueue);
   vkGetDeviceQueue(m_Device, indices.presentFamily, 0, &m_PresentQueue);
 }
@@ -205,6 +234,17 @@ void EngineDevice::CreateCommandPool()
   }
 }
 
+void EngineDevice::CreateAllocator() 
+{
+  m_MemoryBackend = std::make_unique<VulkanMemoryBackend>(m_Device);
+  m_Allocator = std::make_unique<MemoryAllocator>(
+      *m_MemoryBackend, MemoryAllocator::DEFAULT_BLOCK_SIZE, properties.limits.nonCoherentAtomSize);
+}
+
+void EngineDevice::CreateUploadQueue() { m_UploadQueue = std::make_unique<UploadQueue>(*this); }
+
+void EngineDevice::CreatePipelineCache() { m_PipelineCache = std::make_unique<PipelineCache>(*this); }
+
 void EngineDevice::CreateSurface() { m_Window.CreateWindowSurface(m_Instance, &m_Surface); }
 
 bool EngineDevice::IsDeviceSuitable(VkPhysicalDevice device) 
@@ -213,8 +253,9 @@ bool EngineDevice::IsDeviceSuitable(VkPhysicalDevice device)
 
   bool extensionsSupported = CheckDeviceExtensionSupport(device);
 
-  bool swapChainAdequate = false;
-  if (extensionsSupported) {
+  //Without a window there is nothing to present to, any device that can draw will do
+  bool swapChainAdequate = m_Window.IsHeadless();
+  if (extensionsSupported && !swapChainAdequate) {
     SwapChainSupportDetails swapChainSupport = QuerySwapChainSupport(device);
     swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
   }
@@ -223,7 +264,7 @@ bool EngineDevice::IsDeviceSuitable(VkPhysicalDevice device)
   vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
 
   return indices.IsComplete() && extensionsSupported && swapChainAdequate &&
-         supportedFeatures.samplerAnisotropy;
+         (supportedFeatures.samplerAnisotropy || m_Window.IsHeadless());
 }
 
 void EngineDevice::PopulateDebugMessengerCreateInfo(
@@ -274,11 +315,13 @@ bool EngineDevice::checkValidationLayerSupport() {
 }
 
 std::vector<const char *> EngineDevice::GetRequiredExtensions() {
-  uint32_t glfwExtensionCount = 0;
-  const char **glfwExtensions;
-  glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-  std::vector<const char *> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+  std::vector<const char *> extensions;
+  if (!m_Window.IsHeadless()) {
+    uint32_t glfwExtensionCount = 0;
+    const char **glfwExtensions;
+    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+  }
 
   if (enableValidationLayers) {
     extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -321,6 +364,7 @@ bool EngineDevice::CheckDeviceExtensionSupport(VkPhysicalDevice device) {
       &extensionCount,
       availableExtensions.data());
 
+  const std::vector<const char *> &deviceExtensions = GetDeviceExtensions();
   std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
 
   for (const auto &extension : availableExtensions) {
@@ -330,6 +374,30 @@ bool EngineDevice::CheckDeviceExtensionSupport(VkPhysicalDevice device) {
   return requiredExtensions.empty();
 }
 
+bool EngineDevice::IsDeviceExtensionAvailable(const char *extension) {
+  uint32_t extensionCount;
+  vkEnumerateDeviceExtensionProperties(m_PhysicalDevice, nullptr, &extensionCount, nullptr);
+
+  std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+  vkEnumerateDeviceExtensionProperties(
+      m_PhysicalDevice,
+      nullptr,
+      &extensionCount,
+      availableExtensions.data());
+
+  for (const auto &available : availableExtensions) {
+    if (std::string(available.extensionName) == extension) {
+      return true;
+    }
+  }
+  return false;
+}
+
+const std::vector<const char *> &EngineDevice::GetDeviceExtensions() const {
+  static const std::vector<const char *> noExtensions{};
+  return m_Window.IsHeadless() ? noExtensions : deviceExtensions;
+}
+
 QueueFamilyIndices EngineDevice::FindQueueFamilies(VkPhysicalDevice device) {
   QueueFamilyIndices indices;
 
@@ -345,8 +413,11 @@ QueueFamilyIndices EngineDevice::FindQueueFamilies(VkPhysicalDevice device) {
       indices.graphicsFamily = i;
       indices.graphicsFamilyHasValue = true;
     }
-    VkBool32 presentSupport = false;
-    vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_Surface, &presentSupport);
+    //Headless frames are never presented, the graphics queue stands in for the present queue
+    VkBool32 presentSupport = m_Window.IsHeadless() && indices.graphicsFamilyHasValue;
+    if (m_Surface != VK_NULL_HANDLE) {
+      vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_Surface, &presentSupport);
+    }
     if (queueFamily.queueCount > 0 && presentSupport) {
       indices.presentFamily = i;
       indices.presentFamilyHasValue = true;
@@ -421,7 +492,7 @@ void EngineDevice::CreateBuffer(
     VkBufferUsageFlags usage,
     VkMemoryPropertyFlags properties,
     VkBuffer &buffer,
-    VkDeviceMemory &bufferMemory) 
+    MemoryAllocation &bufferMemory) 
 {
   VkBufferCreateInfo bufferInfo{};
   bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -436,16 +507,13 @@ void EngineDevice::CreateBuffer(
   VkMemoryRequirements memRequirements;
   vkGetBufferMemoryRequirements(m_Device, buffer, &memRequirements);
 
-  VkMemoryAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memRequirements.size;
-  allocInfo.memoryTypeIndex = FindMemoryType(memRequirements.memoryTypeBits, properties);
-
-  if (vkAllocateMemory(m_Device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-    throw std::runtime_error("failed to allocate vertex buffer memory!");
-  }
+  bufferMemory = m_Allocator->Allocate(
+      memRequirements,
+      FindMemoryType(memRequirements.memoryTypeBits, properties),
+      (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0,
+      MemoryAllocator::ResourceType::Buffer);
 
-  vkBindBufferMemory(m_Device, buffer, bufferMemory, 0);
+  vkBindBufferMemory(m_Device, buffer, bufferMemory.memory, bufferMemory.offset);
 }
 
 VkCommandBuffer EngineDevice::BeginSingleTimeCommands() {
@@ -474,22 +542,22 @@ void EngineDevice::EndSingleTimeCommands(VkCommandBuffer commandBuffer) {
   submitInfo.commandBufferCount = 1;
   submitInfo.pCommandBuffers = &commandBuffer;
 
-  vkQueueSubmit(m_GraphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-  vkQueueWaitIdle(m_GraphicsQueue);
+  // Only wait for this submission, not for everything else on the queue
+  VkFenceCreateInfo fenceInfo{};
+  fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+  VkFence fence;
+  vkCreateFence(m_Device, &fenceInfo, nullptr, &fence);
 
+  vkQueueSubmit(m_GraphicsQueue, 1, &submitInfo, fence);
+  vkWaitForFences(m_Device, 1, &fence, VK_TRUE, UINT64_MAX);
+
+  vkDestroyFence(m_Device, fence, nullptr);
   vkFreeCommandBuffers(m_Device, m_CommandPool, 1, &commandBuffer);
 }
 
 void EngineDevice::CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
-  VkCommandBuffer commandBuffer = BeginSingleTimeCommands();
-
-  VkBufferCopy copyRegion{};
-  copyRegion.srcOffset = 0;
-  copyRegion.dstOffset = 0;
-  copyRegion.size = size;
-  vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
-
-  EndSingleTimeCommands(commandBuffer);
+  // Blocking for the callers that free srcBuffer right after, rides along with the pending uploads
+  m_UploadQueue->Wait(m_UploadQueue->Copy(srcBuffer, dstBuffer, size));
 }
 
 void EngineDevice::CopyBufferToImage(
@@ -523,7 +591,7 @@ void EngineDevice::CreateImageWithInfo(
     const VkImageCreateInfo &imageInfo,
     VkMemoryPropertyFlags properties,
     VkImage &image,
-    VkDeviceMemory &imageMemory) {
+    MemoryAllocation &imageMemory) {
   if (vkCreateImage(m_Device, &imageInfo, nullptr, &image) != VK_SUCCESS) {
     throw std::runtime_error("failed to create image!");
   }
@@ -531,16 +599,14 @@ void EngineDevice::CreateImageWithInfo(
   VkMemoryRequirements memRequirements;
   vkGetImageMemoryRequirements(m_Device, image, &memRequirements);
 
-  VkMemoryAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memRequirements.size;
-  allocInfo.memoryTypeIndex = FindMemoryType(memRequirements.memoryTypeBits, properties);
-
-  if (vkAllocateMemory(m_Device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-    throw std::runtime_error("failed to allocate image memory!");
-  }
+  imageMemory = m_Allocator->Allocate(
+      memRequirements,
+      FindMemoryType(memRequirements.memoryTypeBits, properties),
+      (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0,
+      imageInfo.tiling == VK_IMAGE_TILING_LINEAR ? MemoryAllocator::ResourceType::Buffer
+                                                 : MemoryAllocator::ResourceType::Image);
 
-  if (vkBindImageMemory(m_Device, image, imageMemory, 0) != VK_SUCCESS) {
+  if (vkBindImageMemory(m_Device, image, imageMemory.memory, imageMemory.offset) != VK_SUCCESS) {
     throw std::runtime_error("failed to bind image memory!");
   }
 }
@@ -715,12 +781,11 @@ void EngineDevice::CreateTextureImage( VkDeviceSize size,
         throw std::runtime_error( "failed to load texture image!" );
     }
 
-    CreateBuffer( size, usage, properties, buffer, bufferMemory );
+    MemoryAllocation stagingMemory;
+    CreateBuffer( size, usage, properties, buffer, stagingMemory );
+    bufferMemory = stagingMemory.memory;
 
-    void* data;
-    vkMapMemory( m_Device, bufferMemory, 0, size, 0, &data );
-    memcpy( data, pixels, static_cast< size_t >( size ) );
-    vkUnmapMemory( m_Device, bufferMemory );
+    memcpy( stagingMemory.mapped, pixels, static_cast< size_t >( size ) );
 
     stbi_image_free( pixels );
 
@@ -732,7 +797,7 @@ void EngineDevice::CreateTextureImage( VkDeviceSize size,
     //transitioned to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL while generating mipmaps
 
     vkDestroyBuffer( m_Device, buffer, nullptr );
-    vkFreeMemory( m_Device, bufferMemory, nullptr );
+    FreeMemory( stagingMemory );
 
     generateMipmaps( textureImage, VK_FORMAT_R8G8B8A8_SRGB, texWidth, texHeight, mipLevels );
 }
@@ -5,7 +5,10 @@
 // std lib headers
 #include <string>
 #include <vector>
-#include "EngineDevice.h"
+#include <memory>
+#include "MemoryAllocator.h"
+#include "UploadQueue.h"
+#include "PipelineCache.h"
 
 struct SwapChainSupportDetails
 {
@@ -54,12 +57,19 @@ class EngineDevice
       const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 
   // Buffer Helper Functions
+  // Memory comes out of the shared blocks of m_Allocator, give it back with FreeMemory
   void CreateBuffer(
       VkDeviceSize size,
       VkBufferUsageFlags usage,
       VkMemoryPropertyFlags properties,
       VkBuffer &buffer,
-      VkDeviceMemory &bufferMemory);
+      MemoryAllocation &bufferMemory);
+  void FreeMemory(MemoryAllocation &allocation) { m_Allocator->Free(allocation); }
+  MemoryStats GetMemoryStats() const { return m_Allocator->GetStats(); }
+  // Batched staging uploads, nothing reaches the gpu until its Submit
+  UploadQueue &GetUploadQueue() { return *m_UploadQueue; }
+  // Shared by every pipeline, persisted between runs
+  PipelineCache &GetPipelineCache() { return *m_PipelineCache; }
 
   VkCommandBuffer BeginSingleTimeCommands();
   void EndSingleTimeCommands(VkCommandBuffer commandBuffer);
@@ -71,7 +81,7 @@ class EngineDevice
       const VkImageCreateInfo &imageInfo,
       VkMemoryPropertyFlags properties,
       VkImage &image,
-      VkDeviceMemory &imageMemory);
+      MemoryAllocation &imageMemory);
   void CreateTextureImage( VkDeviceSize size,
       VkBufferUsageFlags usage,
       VkMemoryPropertyFlags properties,
@@ -82,6 +92,10 @@ class EngineDevice
       VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory );
 
   VkPhysicalDeviceProperties properties;
+  // Optional features that were available and got enabled on the logical device
+  VkPhysicalDeviceFeatures enabledFeatures{};
+  // Null when VK_KHR_draw_indirect_count is missing, fall back to vkCmdDrawIndexedIndirect
+  PFN_vkCmdDrawIndexedIndirectCountKHR cmdDrawIndexedIndirectCount = nullptr;
 
  private:
   void CreateInstance();
@@ -90,6 +104,9 @@ class EngineDevice
   void PickPhysicalDevice();
   void CreateLogicalDevice();
   void CreateCommandPool();
+  void CreateAllocator();
+  void CreateUploadQueue();
+  void CreatePipelineCache();
   uint32_t findMemoryType( uint32_t typeFilter, VkMemoryPropertyFlags properties );
   void transitionImageLayout( VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels );
   VkCommandBuffer beginSingleTimeCommands();
@@ -108,6 +125,8 @@ class EngineDevice
   void PopulateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT &createInfo);
   void HasGflwRequiredInstanceExtensions();
   bool CheckDeviceExtensionSupport(VkPhysicalDevice device);
+  const std::vector<const char *> &GetDeviceExtensions() const;
+  bool IsDeviceExtensionAvailable(const char *extension);
   SwapChainSupportDetails QuerySwapChainSupport(VkPhysicalDevice device);
 
   VkInstance m_Instance;
@@ -117,10 +136,15 @@ class EngineDevice
   VkCommandPool m_CommandPool;
 
   VkDevice m_Device;
-  VkSurfaceKHR m_Surface;
+  VkSurfaceKHR m_Surface = VK_NULL_HANDLE;
   VkQueue m_GraphicsQueue;
   VkQueue m_PresentQueue;
 
+  std::unique_ptr<VulkanMemoryBackend> m_MemoryBackend;
+  std::unique_ptr<MemoryAllocator> m_Allocator;
+  std::unique_ptr<UploadQueue> m_UploadQueue;
+  std::unique_ptr<PipelineCache> m_PipelineCache;
+
   const std::vector<const char *> validationLayers = {"VK_LAYER_KHRONOS_validation"};
   const std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
 
@@ -3,6 +3,8 @@
 #include "Camera.h"
 #include "vulkan/vulkan.h"
 
+class GpuProfiler;
+
 struct FrameInfo
 {
 	int frameIndex = 0;
@@ -10,6 +12,10 @@ struct FrameInfo
 	VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
 	Camera camera{};
 	VkDescriptorSet globalDescriptorSet;
+	//Systems add every draw they record, the benchmark reports it
+	uint32_t drawCallCount = 0;
+	//Systems open their timestamp scopes on this, can be null
+	GpuProfiler* gpuProfiler = nullptr;
 };
 
 struct TransformComponent
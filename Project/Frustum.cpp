@@ -0,0 +1,122 @@
+#include "Frustum.h"
+#include <cmath>
+
+#if defined( __SSE__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 1 )
+    #include <xmmintrin.h>
+    #define FRUSTUM_USE_SSE 1
+#endif
+
+void BoundingBoxBatch::Clear()
+{
+    centerX.clear(); centerY.clear(); centerZ.clear();
+    extentX.clear(); extentY.clear(); extentZ.clear();
+}
+
+void BoundingBoxBatch::Resize( size_t size )
+{
+    centerX.resize( size ); centerY.resize( size ); centerZ.resize( size );
+    extentX.resize( size ); extentY.resize( size ); extentZ.resize( size );
+}
+
+void BoundingBoxBatch::Add( const BoundingBox& localBox, const glm::mat4& modelMatrix )
+{
+    Resize( Size() + 1 );
+    Set( Size() - 1, localBox, modelMatrix );
+}
+
+void BoundingBoxBatch::Set( size_t index, const BoundingBox& localBox, const glm::mat4& modelMatrix )
+{
+    //Center goes through the full matrix, the extent through the absolute rotation/scale part (Arvo)
+    const glm::vec3 localCenter = localBox.GetCenter();
+    const glm::vec3 localExtent = localBox.GetExtent();
+    const glm::vec3 center = glm::vec3( modelMatrix * glm::vec4( localCenter, 1.f ) );
+    const glm::vec3 extent =
+        glm::abs( glm::vec3( modelMatrix[ 0 ] ) ) * localExtent.x +
+        glm::abs( glm::vec3( modelMatrix[ 1 ] ) ) * localExtent.y +
+        glm::abs( glm::vec3( modelMatrix[ 2 ] ) ) * localExtent.z;
+
+    centerX[ index ] = center.x; centerY[ index ] = center.y; centerZ[ index ] = center.z;
+    extentX[ index ] = extent.x; extentY[ index ] = extent.y; extentZ[ index ] = extent.z;
+}
+
+Frustum::Frustum( const glm::mat4& projectionView )
+{
+    //Gribb/Hartmann, glm is column major so row i is m[ 0..3 ][ i ]
+    auto row = [ &projectionView ]( int i )
+        {
+            return glm::vec4( projectionView[ 0 ][ i ], projectionView[ 1 ][ i ], projectionView[ 2 ][ i ], projectionView[ 3 ][ i ] );
+        };
+
+    m_Planes[ 0 ] = row( 3 ) + row( 0 );  //Left
+    m_Planes[ 1 ] = row( 3 ) - row( 0 );  //Right
+    m_Planes[ 2 ] = row( 3 ) + row( 1 );  //Bottom
+    m_Planes[ 3 ] = row( 3 ) - row( 1 );  //Top
+    m_Planes[ 4 ] = row( 2 );             //Near, depth starts at 0
+    m_Planes[ 5 ] = row( 3 ) - row( 2 );  //Far
+
+    for ( auto& plane : m_Planes )
+    {
+        plane /= glm::length( glm::vec3( plane ) );
+    }
+}
+
+bool Frustum::IsVisible( const glm::vec3& center, const glm::vec3& extent ) const
+{
+    for ( const auto& plane : m_Planes )
+    {
+        const float distance = glm::dot( glm::vec3( plane ), center ) + plane.w;
+        const float radius = glm::dot( glm::abs( glm::vec3( plane ) ), extent );
+        if ( distance + radius < 0.f )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Frustum::TestBoxes( const BoundingBoxBatch& boxes, std::vector<uint8_t>& visible ) const
+{
+    const size_t count = boxes.Size();
+    visible.resize( count );
+
+    size_t i = 0;
+#if defined( FRUSTUM_USE_SSE )
+    for ( ; i + 4 <= count; i += 4 )
+    {
+        const __m128 centerX = _mm_loadu_ps( &boxes.centerX[ i ] );
+        const __m128 centerY = _mm_loadu_ps( &boxes.centerY[ i ] );
+        const __m128 centerZ = _mm_loadu_ps( &boxes.centerZ[ i ] );
+        const __m128 extentX = _mm_loadu_ps( &boxes.extentX[ i ] );
+        const __m128 extentY = _mm_loadu_ps( &boxes.extentY[ i ] );
+        const __m128 extentZ = _mm_loadu_ps( &boxes.extentZ[ i ] );
+
+        //All bits set while a box is still inside every plane tested so far
+        __m128 inside = _mm_cmpeq_ps( _mm_setzero_ps(), _mm_setzero_ps() );
+        for ( const auto& plane : m_Planes )
+        {
+            const __m128 distance = _mm_add_ps(
+                _mm_add_ps( _mm_mul_ps( centerX, _mm_set1_ps( plane.x ) ), _mm_mul_ps( centerY, _mm_set1_ps( plane.y ) ) ),
+                _mm_add_ps( _mm_mul_ps( centerZ, _mm_set1_ps( plane.z ) ), _mm_set1_ps( plane.w ) ) );
+            const __m128 radius = _mm_add_ps(
+                _mm_add_ps( _mm_mul_ps( extentX, _mm_set1_ps( std::abs( plane.x ) ) ), _mm_mul_ps( extentY, _mm_set1_ps( std::abs( plane.y ) ) ) ),
+                _mm_mul_ps( extentZ, _mm_set1_ps( std::abs( plane.z ) ) ) );
+
+            inside = _mm_and_ps( inside, _mm_cmpge_ps( _mm_add_ps( distance, radius ), _mm_setzero_ps() ) );
+        }
+
+        const int mask = _mm_movemask_ps( inside );
+        visible[ i + 0 ] = ( mask >> 0 ) & 1;
+        visible[ i + 1 ] = ( mask >> 1 ) & 1;
+        visible[ i + 2 ] = ( mask >> 2 ) & 1;
+        visible[ i + 3 ] = ( mask >> 3 ) & 1;
+    }
+#endif
+
+    //Whatever doesn't fill a full batch, or everything without sse
+    for ( ; i < count; i++ )
+    {
+        visible[ i ] = IsVisible(
+            { boxes.centerX[ i ], boxes.centerY[ i ], boxes.centerZ[ i ] },
+            { boxes.extentX[ i ], boxes.extentY[ i ], boxes.extentZ[ i ] } ) ? 1 : 0;
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+//Axis aligned box in the space of whatever owns it
+struct BoundingBox
+{
+    glm::vec3 min{ 0.f };
+    glm::vec3 max{ 0.f };
+
+    glm::vec3 GetCenter() const { return ( min + max ) * 0.5f; }
+    glm::vec3 GetExtent() const { return ( max - min ) * 0.5f; }
+};
+
+//World space boxes as center + half extent, split per component so four of them fit one sse register
+struct BoundingBoxBatch
+{
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> extentX, extentY, extentZ;
+
+    void Clear();
+    void Resize( size_t size );
+    //Transforms the local box by the model matrix, the result encloses the rotated box
+    void Add( const BoundingBox& localBox, const glm::mat4& modelMatrix );
+    void Set( size_t index, const BoundingBox& localBox, const glm::mat4& modelMatrix );
+    size_t Size() const { return centerX.size(); }
+};
+
+//Six planes pointing inwards, from a Vulkan style (0 to 1 depth) projection * view matrix
+class Frustum
+{
+public:
+    explicit Frustum( const glm::mat4& projectionView );
+
+    bool IsVisible( const glm::vec3& center, const glm::vec3& extent ) const;
+
+    //Writes 1 for every box that touches the frustum, tests four boxes per step when sse is available
+    void TestBoxes( const BoundingBoxBatch& boxes, std::vector<uint8_t>& visible ) const;
+
+    //xyz is the normal, w the distance, for shaders that cull on the gpu
+    const std::array<glm::vec4, 6>& GetPlanes() const { return m_Planes; }
+
+private:
+    std::array<glm::vec4, 6> m_Planes;
+};
@@ -0,0 +1,169 @@
+#include "GpuProfiler.h"
+#include "EngineDevice.h"
+#include "SwapChain.h"
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+void GpuProfiler::ScopeHistory::AddSample( float milliseconds )
+{
+    samples[ nextSample ] = milliseconds;
+    nextSample = ( nextSample + 1 ) % HISTORY_SIZE;
+    sampleCount = std::min( sampleCount + 1, HISTORY_SIZE );
+}
+
+float GpuProfiler::ScopeHistory::GetLatest() const
+{
+    return sampleCount == 0 ? 0.f : samples[ ( nextSample + HISTORY_SIZE - 1 ) % HISTORY_SIZE ];
+}
+
+float GpuProfiler::ScopeHistory::GetAverage() const
+{
+    //The ring is only filled up to sampleCount until it wraps the first time
+    return sampleCount == 0 ? 0.f :
+        std::accumulate( samples.begin(), samples.begin() + sampleCount, 0.f ) / sampleCount;
+}
+
+float GpuProfiler::ScopeHistory::GetMax() const
+{
+    return sampleCount == 0 ? 0.f : *std::max_element( samples.begin(), samples.begin() + sampleCount );
+}
+
+GpuProfiler::Scope::Scope( GpuProfiler* profiler, VkCommandBuffer commandBuffer, const char* name )
+    : m_Profiler{ profiler },
+    m_CommandBuffer{ commandBuffer },
+    m_Query{ profiler ? profiler->BeginScope( commandBuffer, name ) : INVALID_QUERY }
+{
+}
+
+GpuProfiler::Scope::~Scope()
+{
+    if ( m_Profiler )
+    {
+        m_Profiler->EndScope( m_CommandBuffer, m_Query );
+    }
+}
+
+GpuProfiler::GpuProfiler( EngineDevice& device )
+    : m_Device{ device }
+{
+    //Without timestamps on graphics queues every call becomes a no-op
+    if ( !m_Device.properties.limits.timestampComputeAndGraphics )
+    {
+        return;
+    }
+    m_TimestampPeriod = m_Device.properties.limits.timestampPeriod;
+
+    m_Frames.resize( SwapChain::MAX_FRAMES_IN_FLIGHT );
+    for ( auto& frame : m_Frames )
+    {
+        VkQueryPoolCreateInfo queryPoolInfo{};
+        queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolInfo.queryCount = MAX_SCOPES_PER_FRAME * 2;
+
+        if ( vkCreateQueryPool( m_Device.Device(), &queryPoolInfo, nullptr, &frame.queryPool ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to create timestamp query pool!" );
+        }
+        frame.scopes.reserve( MAX_SCOPES_PER_FRAME );
+    }
+    m_Results.resize( MAX_SCOPES_PER_FRAME * 2 );
+}
+
+GpuProfiler::~GpuProfiler()
+{
+    for ( auto& frame : m_Frames )
+    {
+        vkDestroyQueryPool( m_Device.Device(), frame.queryPool, nullptr );
+    }
+}
+
+void GpuProfiler::BeginFrame( VkCommandBuffer commandBuffer, int frameIndex )
+{
+    if ( !IsSupported() )
+    {
+        return;
+    }
+
+    m_CurrentFrame = frameIndex;
+    Frame& frame = m_Frames[ frameIndex ];
+    ReadResults( frame );
+
+    frame.scopes.clear();
+    frame.queryCount = 0;
+    vkCmdResetQueryPool( commandBuffer, frame.queryPool, 0, MAX_SCOPES_PER_FRAME * 2 );
+}
+
+uint32_t GpuProfiler::BeginScope( VkCommandBuffer commandBuffer, const char* name )
+{
+    if ( !IsSupported() || m_CurrentFrame < 0 )
+    {
+        return INVALID_QUERY;
+    }
+
+    Frame& frame = m_Frames[ m_CurrentFrame ];
+    if ( frame.scopes.size() >= MAX_SCOPES_PER_FRAME )
+    {
+        return INVALID_QUERY;
+    }
+
+    const uint32_t query = frame.queryCount;
+    frame.queryCount += 2;
+    frame.scopes.push_back( { GetHistoryIndex( name ), query } );
+
+    vkCmdWriteTimestamp( commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.queryPool, query );
+    return query;
+}
+
+void GpuProfiler::EndScope( VkCommandBuffer commandBuffer, uint32_t query )
+{
+    if ( query == INVALID_QUERY )
+    {
+        return;
+    }
+
+    Frame& frame = m_Frames[ m_CurrentFrame ];
+    vkCmdWriteTimestamp( commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.queryPool, query + 1 );
+}
+
+float GpuProfiler::GetLatest( const std::string& name ) const
+{
+    auto it = m_HistoryIndices.find( name );
+    return it == m_HistoryIndices.end() ? 0.f : m_History[ it->second ].GetLatest();
+}
+
+void GpuProfiler::ReadResults( Frame& frame )
+{
+    if ( frame.queryCount == 0 )
+    {
+        return;
+    }
+
+    //No wait flag, if the gpu somehow isn't done the frame is dropped instead of stalling the cpu
+    VkResult result = vkGetQueryPoolResults( m_Device.Device(), frame.queryPool, 0, frame.queryCount,
+        frame.queryCount * sizeof( uint64_t ), m_Results.data(), sizeof( uint64_t ), VK_QUERY_RESULT_64_BIT );
+    if ( result != VK_SUCCESS )
+    {
+        return;
+    }
+
+    for ( const auto& scope : frame.scopes )
+    {
+        const uint64_t begin = m_Results[ scope.beginQuery ];
+        const uint64_t end = m_Results[ scope.beginQuery + 1 ];
+        const double nanoseconds = static_cast< double >( end - begin ) * m_TimestampPeriod;
+        m_History[ scope.historyIndex ].AddSample( static_cast< float >( nanoseconds / 1000000.0 ) );
+    }
+}
+
+uint32_t GpuProfiler::GetHistoryIndex( const char* name )
+{
+    auto [it, inserted] = m_HistoryIndices.try_emplace( name, static_cast< uint32_t >( m_History.size() ) );
+    if ( inserted )
+    {
+        m_History.emplace_back();
+        m_History.back().name = name;
+    }
+    return it->second;
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <array>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+class EngineDevice;
+
+//Times named sections of the command buffer with timestamp queries, one query pool per frame in flight.
+//Results are read back without waiting when the frame slot is reused, so they are MAX_FRAMES_IN_FLIGHT frames old.
+class GpuProfiler
+{
+public:
+    static constexpr uint32_t MAX_SCOPES_PER_FRAME = 32;
+    static constexpr uint32_t HISTORY_SIZE = 120;
+    static constexpr uint32_t INVALID_QUERY = ~0u;
+
+    //Last HISTORY_SIZE durations of one scope in ms
+    struct ScopeHistory
+    {
+        std::string name;
+        std::array<float, HISTORY_SIZE> samples{};
+        uint32_t sampleCount = 0;
+        uint32_t nextSample = 0;
+
+        void AddSample( float milliseconds );
+        float GetLatest() const;
+        float GetAverage() const;
+        float GetMax() const;
+    };
+
+    //Closes the scope when it goes out of scope, does nothing without a profiler
+    class Scope
+    {
+    public:
+        Scope( GpuProfiler* profiler, VkCommandBuffer commandBuffer, const char* name );
+        ~Scope();
+
+        Scope( const Scope& ) = delete;
+        Scope& operator=( const Scope& ) = delete;
+
+    private:
+        GpuProfiler* m_Profiler;
+        VkCommandBuffer m_CommandBuffer;
+        uint32_t m_Query;
+    };
+
+    explicit GpuProfiler( EngineDevice& device );
+    ~GpuProfiler();
+
+    GpuProfiler( const GpuProfiler& ) = delete;
+    GpuProfiler& operator=( const GpuProfiler& ) = delete;
+
+    bool IsSupported() const { return !m_Frames.empty(); }
+
+    //Call right after the command buffer began, the fence of this frame has to be waited on already
+    void BeginFrame( VkCommandBuffer commandBuffer, int frameIndex );
+
+    //Returns the query to pass to EndScope, scopes past MAX_SCOPES_PER_FRAME are dropped
+    uint32_t BeginScope( VkCommandBuffer commandBuffer, const char* name );
+    void EndScope( VkCommandBuffer commandBuffer, uint32_t query );
+
+    const std::vector<ScopeHistory>& GetHistory() const { return m_History; }
+    //Most recent duration of the scope in ms, 0 when it was never measured
+    float GetLatest( const std::string& name ) const;
+
+private:
+    struct RecordedScope
+    {
+        uint32_t historyIndex;
+        uint32_t beginQuery;
+    };
+
+    struct Frame
+    {
+        VkQueryPool queryPool = VK_NULL_HANDLE;
+        std::vector<RecordedScope> scopes;
+        uint32_t queryCount = 0;
+    };
+
+    void ReadResults( Frame& frame );
+    uint32_t GetHistoryIndex( const char* name );
+
+    EngineDevice& m_Device;
+    float m_TimestampPeriod = 1.f;
+
+    std::vector<Frame> m_Frames;
+    int m_CurrentFrame = -1;
+
+    std::vector<ScopeHistory> m_History;
+    std::unordered_map<std::string, uint32_t> m_HistoryIndices;
+    std::vector<uint64_t> m_Results;
+};
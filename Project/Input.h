@@ -10,12 +10,13 @@
 
 #pragma once
 
-#include "GameObject.h"
+#include "Scene.h"
 #include "Window.h"
 #include <limits>
 #include <iostream>
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/intersect.hpp>
+#include "BVH.h"
+#include "JobSystem.h"
+#include <glm/gtc/matrix_transform.hpp>
 
 class MovementController
 {
@@ -43,58 +44,48 @@ public:
 
     //your objects or just parse all your vertices/triangles to m_TransformedTriangles
     MovementController() = default;
-    MovementController( GameObject& gameObject ) { m_GameObjects.emplace_back( gameObject ); UpdateTriangles( m_GameObjects ); };
-    MovementController( std::vector<GameObject>& gameObjects ) : m_GameObjects( gameObjects )
+    MovementController( const Scene& scene )
     {
-        UpdateTriangles( gameObjects );
+        UpdateTriangles( scene );
     }
-    MovementController( std::vector<std::vector<glm::vec3>> transformedTriangles ) { m_TransformedTriangles = transformedTriangles; };
-    MovementController( std::vector<glm::vec3 > transformedTriangles ){ m_TransformedTriangles.emplace_back( transformedTriangles ); };
+    MovementController( std::vector<std::vector<glm::vec3>> transformedTriangles ) { m_TransformedTriangles = transformedTriangles; m_BVH.Build( m_TransformedTriangles ); };
+    MovementController( std::vector<glm::vec3 > transformedTriangles ){ m_TransformedTriangles.emplace_back( transformedTriangles ); m_BVH.Build( m_TransformedTriangles ); };
 
-    //Need to fix this
-    void UpdateTriangles( GameObject& gameObject )
-	{
-        m_GameObjects.clear();
-		m_GameObjects.emplace_back( gameObject );
-		m_TransformedTriangles.clear();
-		for ( auto& gameObject : m_GameObjects )
-		{
-			if ( gameObject.m_Model != nullptr )
-			{
-				//your transforms
-				TransformComponent& transform = gameObject.m_Transform;
-				//your triangles, you can also just parse them in the function
-				std::vector<glm::vec3> triangles = gameObject.m_Model->GetModelData().triangles;
-
-				TransformTriangles( transform, triangles );
-
-				m_TransformedTriangles.emplace_back( std::move( triangles ) );
-			}
-		}
-	}
-    void UpdateTriangles( std::vector<GameObject>& gameObjects )
+    void UpdateTriangles( const Scene& scene )
     {
-        m_GameObjects = gameObjects;
-        m_TransformedTriangles.clear();
-        for ( auto& gameObject : m_GameObjects )
+        const ComponentSpan<const ModelHandle> models = scene.GetModels();
+        const ComponentSpan<const TransformComponent> transforms = scene.GetTransforms();
+
+        std::vector<uint32_t> modelObjects;
+        modelObjects.reserve( models.size() );
+        for ( uint32_t i = 0; i < models.size(); i++ )
         {
-            if ( gameObject.m_Model != nullptr )
+            if ( models[ i ] != INVALID_MODEL )
             {
-                //your transforms
-                TransformComponent& transform = gameObject.m_Transform;
-                //your triangles, you can also just parse them in the function
-                std::vector<glm::vec3> triangles = gameObject.m_Model->GetModelData().triangles;
-
-                TransformTriangles( transform, triangles );
-
-                m_TransformedTriangles.emplace_back( std::move( triangles ) );
+                modelObjects.push_back( i );
             }
         }
+
+        //Every object writes its own slot, so big scenes transform in parallel and keep their order
+        m_TransformedTriangles.clear();
+        m_TransformedTriangles.resize( modelObjects.size() );
+        JobSystem::Get().ParallelFor( static_cast< uint32_t >( modelObjects.size() ), 16, [ & ]( uint32_t begin, uint32_t end )
+            {
+                for ( uint32_t i = begin; i < end; i++ )
+                {
+                    const uint32_t object = modelObjects[ i ];
+                    std::vector<glm::vec3> triangles = scene.GetModel( models[ object ] )->GetModelData().triangles;
+                    TransformTriangles( transforms[ object ], triangles );
+                    m_TransformedTriangles[ i ] = std::move( triangles );
+                }
+            } );
+        m_BVH.Build( m_TransformedTriangles );
     }
     void UpdateTriangles( std::vector<std::vector<glm::vec3>> transformed )
     {
         m_TransformedTriangles.clear();
         m_TransformedTriangles = transformed;
+        m_BVH.Build( m_TransformedTriangles );
     }
     void UpdateTriangles( std::vector<glm::vec3> transformed)
 	{
@@ -104,21 +95,23 @@ public:
     void AddTriangles( std::vector<glm::vec3> triangles)
 	{
 		m_TransformedTriangles.emplace_back( triangles );
+		m_BVH.Build( m_TransformedTriangles );
 	}
 
-    void UpdatePhysics( GLFWwindow* window, float dt, GameObject& gameObject )
+    void UpdatePhysics( GLFWwindow* window, float dt, TransformComponent& transform )
     {
-        if ( m_CanMoveWithInput ) 
+        //Headless runs have no window to read input from
+        if ( m_CanMoveWithInput && window != nullptr ) 
         {
-            CheckInputs( window, dt, gameObject );
+            CheckInputs( window, dt, transform );
         }
         if ( m_HasCollisions ) 
         {
-            CheckCollisions( dt, gameObject );
+            CheckCollisions( dt, transform );
         }
     }
 
-    void Jump( GameObject& gameObject, float strength )
+    void Jump( TransformComponent& transform, float strength )
     {
         m_IsFlying = false;
         m_IsFalling = true;
@@ -148,12 +141,12 @@ public:
 
 private:
     //FUNCTIONS
-    void CheckCollisions( float deltaTime, GameObject& camera )
+    void CheckCollisions( float deltaTime, TransformComponent& camera )
     {
         if ( m_IsFlying ) { return; }   //If the player is flying, don't do anything
 
         m_VelocityY += m_Gravity * deltaTime;
-        m_CurrentPositionY = camera.m_Transform.translation.y - m_VelocityY * deltaTime;
+        m_CurrentPositionY = camera.translation.y - m_VelocityY * deltaTime;
 
         if ( m_IsFalling )
         {
@@ -174,100 +167,50 @@ private:
                 }
             }
 
-            camera.m_Transform.translation.y = m_CurrentPositionY;
+            camera.translation.y = m_CurrentPositionY;
         }
 
-        glm::vec3 rayOrigin = camera.m_Transform.translation;
+        glm::vec3 rayOrigin = camera.translation;
         rayOrigin.y -= m_PlayerHeight;      //+=m_PlayerHeight if you want to start from the top of the player
 
-        bool foundIntersection = false;
-        float closestIntersectionDistance = std::numeric_limits<float>::max();
-
-        glm::vec2 intersectionPoint;
-        glm::vec3 vertex0;
-        glm::vec3 vertex1;
-        glm::vec3 vertex2;
-
-        //Check for intersection with the triangles
-        for ( auto& triangles : m_TransformedTriangles )
+        //Closest hit along the ray, the BVH skips everything that isn't near it
+        BVH::RayHit hit{};
+        if ( m_BVH.Raycast( rayOrigin, m_RayDirection, m_Epsilon, m_MaxRayCastDistance, hit ) )
         {
-            for ( size_t i = 0; i < triangles.size(); i += 3 )
-            {
-                vertex0 = triangles[ i ];
-                vertex1 = triangles[ i + 1 ];
-                vertex2 = triangles[ i + 2 ];
+            glm::vec3 intersectionPoint3D = rayOrigin + m_RayDirection * hit.distance;
+            if ( intersectionPoint3D.y == 0 ) { return; }
+            if ( intersectionPoint3D.y > 0 ) { intersectionPoint3D *= -1; }         //Setting for my world, you can change this, or remove it
 
-                //Raycast
-                if ( glm::intersectRayTriangle( rayOrigin, m_RayDirection, vertex0, vertex1, vertex2, intersectionPoint, closestIntersectionDistance ) )
-                {
-                    if ( closestIntersectionDistance < m_MaxRayCastDistance )
-                    {
-                        if ( std::abs( closestIntersectionDistance ) > m_Epsilon )
-                        {
-                            glm::vec3 intersectionPoint3D = rayOrigin + m_RayDirection * closestIntersectionDistance;
-                            if ( intersectionPoint3D.y == 0 ) { return; }
-                            if ( intersectionPoint3D.y > 0 ) { intersectionPoint3D *= -1; }         //Setting for my world, you can change this, or remove it
-
-                            //If the triangle is ok:
-                            if ( std::abs( intersectionPoint3D.y ) > m_Epsilon )
-                            {
-                                m_StartJumpPosition = intersectionPoint3D.y - m_PlayerHeight;
-                                m_LowestIntersectionY = std::max( m_LowestIntersectionY, m_StartJumpPosition );
-                                foundIntersection = true;
-                            }
-                        }
-                    }
-                }
+            //If the triangle is ok:
+            if ( std::abs( intersectionPoint3D.y ) > m_Epsilon )
+            {
+                m_StartJumpPosition = intersectionPoint3D.y - m_PlayerHeight;
+                m_LowestIntersectionY = std::max( m_LowestIntersectionY, m_StartJumpPosition );
+                m_StartJumpPosition = m_LowestIntersectionY;
             }
         }
-        if ( foundIntersection )
-        {
-            m_StartJumpPosition = m_LowestIntersectionY;
-        }
     }
-    void Shoot( GameObject& camera ) 
+    void Shoot( TransformComponent& camera ) 
     {
-        glm::vec3 rayOrigin = camera.m_Transform.translation;
-
-        glm::vec3 forward = camera.m_Transform.rotation;
-
-        float closestIntersectionDistance = std::numeric_limits<float>::max();
+        glm::vec3 rayOrigin = camera.translation;
 
-        glm::vec2 intersectionPoint;
-        glm::vec3 vertex0;
-        glm::vec3 vertex1;
-        glm::vec3 vertex2;
+        glm::vec3 forward = camera.rotation;
 
-        for ( auto& triangles : m_TransformedTriangles )
+        BVH::RayHit hit{};
+        if ( m_BVH.Raycast( rayOrigin, forward, m_Epsilon, m_MaxRayCastDistance, hit ) )
         {
-            for ( size_t i = 0; i < triangles.size(); i += 3 )
+            glm::vec3 intersectionPoint3D = rayOrigin + m_RayDirection * hit.distance;
+            if ( intersectionPoint3D.y == 0 ) { return; }
+            if ( intersectionPoint3D.y > 0 ) { intersectionPoint3D *= -1; }         //Setting for my world, you can change this, or remove it
+
+            if ( std::abs( intersectionPoint3D.y ) > m_Epsilon )
             {
-                vertex0 = triangles[ i ];
-                vertex1 = triangles[ i + 1 ];
-                vertex2 = triangles[ i + 2 ];
 
-                if ( glm::intersectRayTriangle( rayOrigin, forward, vertex0, vertex1, vertex2, intersectionPoint, closestIntersectionDistance ) )
-                {
-                    if ( closestIntersectionDistance < m_MaxRayCastDistance )
-                    {
-                        if ( std::abs( closestIntersectionDistance ) > m_Epsilon )
-                        {
-                            glm::vec3 intersectionPoint3D = rayOrigin + m_RayDirection * closestIntersectionDistance;
-                            if ( intersectionPoint3D.y == 0 ) { return; }
-                            if ( intersectionPoint3D.y > 0 ) { intersectionPoint3D *= -1; }         //Setting for my world, you can change this, or remove it
-
-                            if ( std::abs( intersectionPoint3D.y ) > m_Epsilon )
-                            {
-
-                            }
-                        }
-                    }
-                }
             }
         }
     }
 
-    void CheckInputs( GLFWwindow* window, float dt, GameObject& gameObject ) 
+    void CheckInputs( GLFWwindow* window, float dt, TransformComponent& transform ) 
     {
         if ( glfwGetMouseButton( window, GLFW_MOUSE_BUTTON_RIGHT ) == GLFW_PRESS )
         {
@@ -296,8 +239,8 @@ private:
             if ( m_Pitch < -89.0f )
                 m_Pitch = -89.0f;
 
-            gameObject.m_Transform.rotation.x = glm::radians( m_Pitch );
-            gameObject.m_Transform.rotation.y = glm::radians( m_Yaw );
+            transform.rotation.x = glm::radians( m_Pitch );
+            transform.rotation.y = glm::radians( m_Yaw );
         }
         else
         {
@@ -306,11 +249,11 @@ private:
 
         if ( glfwGetMouseButton( window, GLFW_MOUSE_BUTTON_LEFT ) == GLFW_PRESS && m_CanShoot==true)
         {
-            Shoot( gameObject );
+            Shoot( transform );
 		}
 
         // Movement
-        float yaw = gameObject.m_Transform.rotation.y;
+        float yaw = transform.rotation.y;
         const glm::vec3 forward{ sin( yaw ), 0.f, cos( yaw ) };
         const glm::vec3 right{ forward.z, 0.f, -forward.x };
         const glm::vec3 up{ 0.f, 1.f, 0.f };
@@ -348,11 +291,11 @@ private:
         }
         if ( glfwGetKey( window, m_keyMappings.jump ) == GLFW_PRESS )
         {
-            Jump( gameObject, m_JumpStrength );
+            Jump( transform, m_JumpStrength );
         }
         if ( glfwGetKey( window, m_keyMappings.fall ) == GLFW_PRESS )
         {
-            Jump( gameObject, 0.0f );
+            Jump( transform, 0.0f );
         }
         if ( glfwGetKey( window, m_keyMappings.sprint ) == GLFW_PRESS )
         {
@@ -366,10 +309,10 @@ private:
         //Update the position
         if ( glm::dot( moveDir, moveDir ) > std::numeric_limits<float>::epsilon() )
         {
-            gameObject.m_Transform.translation += glm::normalize( moveDir ) * m_MoveSpeed * dt;
+            transform.translation += glm::normalize( moveDir ) * m_MoveSpeed * dt;
         }
     };
-    void TransformTriangles( TransformComponent& transform, std::vector<glm::vec3>& triangles )
+    void TransformTriangles( const TransformComponent& transform, std::vector<glm::vec3>& triangles )
     {
         //Transform the triangles to your world space
         glm::vec3 scale = transform.scale;
@@ -432,10 +375,10 @@ private:
     float m_Yaw = 0.0f;
     float m_Pitch = 0.0f;
 
-    //Your game objects, transform and triangles
-    std::vector<GameObject> m_GameObjects{};
+    //Your transforms and triangles
     std::vector<TransformComponent> m_Transforms{};
     std::vector<std::vector<glm::vec3>> m_TransformedTriangles{};
+    BVH m_BVH{};                                //Rebuilt whenever m_TransformedTriangles changes
 
    /* glm::vec3 translation{};
     glm::vec3 scale{ 1.0f, 1.0f, 1.0f };
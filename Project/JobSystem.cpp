@@ -0,0 +1,414 @@
+#include "JobSystem.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <string>
+
+struct JobSystem::Job
+{
+    JobFunction function;
+    Job* parent = nullptr;
+    //The job itself plus every child that is not done yet
+    std::atomic<int32_t> unfinishedJobs{ 1 };
+    std::atomic<int32_t> references{ 1 };
+
+    //Written once by whoever sets failed first, read after unfinishedJobs reached 0
+    std::atomic<bool> failed{ false };
+    std::exception_ptr error;
+};
+
+//Which system the current thread works for, so a worker of one system is a plain thread to another
+static thread_local const JobSystem* t_JobSystem = nullptr;
+static thread_local uint32_t t_WorkerIndex = JobSystem::INVALID_WORKER;
+static thread_local uint32_t t_StealSeed = 0;
+
+//Workers spin this often on an empty system before they go to sleep
+static constexpr uint32_t IDLE_SPIN_COUNT = 64;
+
+JobSystem::JobHandle::~JobHandle()
+{
+    if ( m_Job ) Release( m_Job );
+}
+
+JobSystem::JobHandle::JobHandle( const JobHandle& other )
+    : m_Job{ other.m_Job }
+{
+    if ( m_Job ) Retain( m_Job );
+}
+
+JobSystem::JobHandle::JobHandle( JobHandle&& other ) noexcept
+    : m_Job{ other.m_Job }
+{
+    other.m_Job = nullptr;
+}
+
+JobSystem::JobHandle& JobSystem::JobHandle::operator=( JobHandle other ) noexcept
+{
+    std::swap( m_Job, other.m_Job );
+    return *this;
+}
+
+JobSystem::WorkStealingDeque::WorkStealingDeque()
+    : m_Jobs{ new std::atomic<Job*>[ DEQUE_CAPACITY ] }
+{
+    static_assert( ( DEQUE_CAPACITY & ( DEQUE_CAPACITY - 1 ) ) == 0, "Deque capacity has to be a power of two" );
+}
+
+bool JobSystem::WorkStealingDeque::Push( Job* job )
+{
+    const int64_t bottom = m_Bottom.load( std::memory_order_relaxed );
+    const int64_t top = m_Top.load( std::memory_order_acquire );
+    if ( bottom - top >= static_cast< int64_t >( DEQUE_CAPACITY ) )
+    {
+        return false;
+    }
+
+    m_Jobs[ bottom & ( DEQUE_CAPACITY - 1 ) ].store( job, std::memory_order_relaxed );
+    //Publishes the slot to thieves that read the new bottom
+    m_Bottom.store( bottom + 1, std::memory_order_seq_cst );
+    return true;
+}
+
+JobSystem::Job* JobSystem::WorkStealingDeque::Pop()
+{
+    const int64_t bottom = m_Bottom.load( std::memory_order_relaxed ) - 1;
+    //Has to be visible to thieves before top is read, they race for the last job
+    m_Bottom.store( bottom, std::memory_order_seq_cst );
+    int64_t top = m_Top.load( std::memory_order_seq_cst );
+
+    if ( top > bottom )
+    {
+        m_Bottom.store( bottom + 1, std::memory_order_relaxed );
+        return nullptr;
+    }
+
+    Job* job = m_Jobs[ bottom & ( DEQUE_CAPACITY - 1 ) ].load( std::memory_order_relaxed );
+    if ( top == bottom )
+    {
+        //Last job, whoever moves top first gets it
+        if ( !m_Top.compare_exchange_strong( top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed ) )
+        {
+            job = nullptr;
+        }
+        m_Bottom.store( bottom + 1, std::memory_order_relaxed );
+    }
+    return job;
+}
+
+JobSystem::Job* JobSystem::WorkStealingDeque::Steal()
+{
+    int64_t top = m_Top.load( std::memory_order_seq_cst );
+    const int64_t bottom = m_Bottom.load( std::memory_order_seq_cst );
+    if ( top >= bottom )
+    {
+        return nullptr;
+    }
+
+    Job* job = m_Jobs[ top & ( DEQUE_CAPACITY - 1 ) ].load( std::memory_order_relaxed );
+    if ( !m_Top.compare_exchange_strong( top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed ) )
+    {
+        return nullptr;
+    }
+    return job;
+}
+
+JobSystem& JobSystem::Get()
+{
+    static JobSystem jobSystem{ std::max( 1u, std::thread::hardware_concurrency() ) - 1 };
+    return jobSystem;
+}
+
+JobSystem::JobSystem( uint32_t workerCount )
+{
+    workerCount = std::max( 1u, workerCount );
+    m_Workers.reserve( workerCount );
+    for ( uint32_t i = 0; i < workerCount; i++ )
+    {
+        m_Workers.push_back( std::make_unique<Worker>() );
+    }
+    //Only start once every deque exists, workers steal from all of them
+    for ( uint32_t i = 0; i < workerCount; i++ )
+    {
+        m_Workers[ i ]->thread = std::thread( [ this, i ]() { WorkerLoop( i ); } );
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock{ m_WakeMutex };
+        m_Stopping.store( true );
+    }
+    m_WakeCondition.notify_all();
+
+    for ( auto& worker : m_Workers )
+    {
+        worker->thread.join();
+    }
+}
+
+void JobSystem::Retain( Job* job )
+{
+    job->references.fetch_add( 1, std::memory_order_relaxed );
+}
+
+void JobSystem::Release( Job* job )
+{
+    if ( job->references.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+    {
+        delete job;
+    }
+}
+
+JobSystem::JobHandle JobSystem::CreateJob( JobFunction function )
+{
+    Job* job = new Job{};
+    job->function = std::move( function );
+    return JobHandle{ job };
+}
+
+JobSystem::JobHandle JobSystem::CreateChildJob( const JobHandle& parent, JobFunction function )
+{
+    Job* job = new Job{};
+    job->function = std::move( function );
+    if ( parent.m_Job )
+    {
+        parent.m_Job->unfinishedJobs.fetch_add( 1, std::memory_order_relaxed );
+        Retain( parent.m_Job );
+        job->parent = parent.m_Job;
+    }
+    return JobHandle{ job };
+}
+
+uint32_t JobSystem::GetCurrentWorkerIndex() const
+{
+    return t_JobSystem == this ? t_WorkerIndex : INVALID_WORKER;
+}
+
+void JobSystem::Run( const JobHandle& handle )
+{
+    Job* job = handle.m_Job;
+    if ( job == nullptr )
+    {
+        return;
+    }
+
+    //The queue holds a reference until the job is finished
+    Retain( job );
+
+    const uint32_t workerIndex = GetCurrentWorkerIndex();
+    if ( workerIndex != INVALID_WORKER )
+    {
+        m_QueuedJobs.fetch_add( 1 );
+        if ( !m_Workers[ workerIndex ]->deque.Push( job ) )
+        {
+            m_QueuedJobs.fetch_sub( 1 );
+            Execute( job );
+            return;
+        }
+    }
+    else
+    {
+        m_QueuedJobs.fetch_add( 1 );
+        std::lock_guard<std::mutex> lock{ m_InjectMutex };
+        m_InjectedJobs.push_back( job );
+        m_InjectedCount.fetch_add( 1 );
+    }
+
+    //Pairs with the sleeping count a worker raises before its last look for work
+    if ( m_SleepingWorkers.load() > 0 )
+    {
+        std::lock_guard<std::mutex> lock{ m_WakeMutex };
+        m_WakeCondition.notify_one();
+    }
+}
+
+bool JobSystem::IsFinished( const JobHandle& handle ) const
+{
+    return handle.m_Job == nullptr || handle.m_Job->unfinishedJobs.load( std::memory_order_acquire ) == 0;
+}
+
+void JobSystem::Wait( const JobHandle& handle )
+{
+    if ( handle.m_Job == nullptr )
+    {
+        return;
+    }
+
+    const uint32_t workerIndex = GetCurrentWorkerIndex();
+    while ( !IsFinished( handle ) )
+    {
+        if ( Job* job = FindJob( workerIndex ) )
+        {
+            Execute( job );
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    if ( handle.m_Job->failed.load( std::memory_order_acquire ) )
+    {
+        std::rethrow_exception( handle.m_Job->error );
+    }
+}
+
+JobSystem::Job* JobSystem::FindJob( uint32_t workerIndex )
+{
+    Job* job = nullptr;
+    if ( workerIndex != INVALID_WORKER )
+    {
+        job = m_Workers[ workerIndex ]->deque.Pop();
+    }
+
+    if ( job == nullptr && m_InjectedCount.load( std::memory_order_relaxed ) > 0 )
+    {
+        std::lock_guard<std::mutex> lock{ m_InjectMutex };
+        if ( !m_InjectedJobs.empty() )
+        {
+            job = m_InjectedJobs.front();
+            m_InjectedJobs.pop_front();
+            m_InjectedCount.fetch_sub( 1, std::memory_order_relaxed );
+        }
+    }
+
+    if ( job == nullptr )
+    {
+        //Different starting victim every time, so thieves don't all hammer worker 0
+        const uint32_t workerCount = GetWorkerCount();
+        const uint32_t start = t_StealSeed++ % workerCount;
+        for ( uint32_t i = 0; i < workerCount && job == nullptr; i++ )
+        {
+            const uint32_t victim = ( start + i ) % workerCount;
+            if ( victim != workerIndex )
+            {
+                job = m_Workers[ victim ]->deque.Steal();
+            }
+        }
+    }
+
+    if ( job )
+    {
+        m_QueuedJobs.fetch_sub( 1 );
+    }
+    return job;
+}
+
+void JobSystem::Execute( Job* job )
+{
+    if ( job->function )
+    {
+        try
+        {
+            job->function();
+        }
+        catch ( ... )
+        {
+            bool expected = false;
+            if ( job->failed.compare_exchange_strong( expected, true ) )
+            {
+                job->error = std::current_exception();
+            }
+        }
+    }
+    Finish( job );
+}
+
+void JobSystem::Finish( Job* job )
+{
+    if ( job->unfinishedJobs.fetch_sub( 1, std::memory_order_acq_rel ) != 1 )
+    {
+        return;
+    }
+
+    Job* parent = job->parent;
+    if ( parent )
+    {
+        //A failed child fails the whole tree, the first error wins
+        bool expected = false;
+        if ( job->failed.load( std::memory_order_acquire ) &&
+            parent->failed.compare_exchange_strong( expected, true ) )
+        {
+            parent->error = job->error;
+        }
+        Finish( parent );
+        Release( parent );
+    }
+    //The reference Run took for the queue
+    Release( job );
+}
+
+void JobSystem::WorkerLoop( uint32_t workerIndex )
+{
+    t_JobSystem = this;
+    t_WorkerIndex = workerIndex;
+    t_StealSeed = workerIndex + 1;
+    PROFILE_THREAD_NAME( "Job worker " + std::to_string( workerIndex ) );
+
+    uint32_t idleSpins = 0;
+    while ( true )
+    {
+        if ( Job* job = FindJob( workerIndex ) )
+        {
+            Execute( job );
+            idleSpins = 0;
+            continue;
+        }
+
+        if ( ++idleSpins < IDLE_SPIN_COUNT )
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        idleSpins = 0;
+
+        m_SleepingWorkers.fetch_add( 1 );
+        {
+            std::unique_lock<std::mutex> lock{ m_WakeMutex };
+            m_WakeCondition.wait( lock, [ this ]()
+                {
+                    return m_Stopping.load() || m_QueuedJobs.load() > 0;
+                } );
+        }
+        m_SleepingWorkers.fetch_sub( 1 );
+
+        if ( m_Stopping.load() && m_QueuedJobs.load() <= 0 )
+        {
+            return;
+        }
+    }
+}
+
+void JobSystem::ParallelFor( uint32_t count, uint32_t minBatchSize, const RangeFunction& function )
+{
+    if ( count == 0 )
+    {
+        return;
+    }
+
+    //A few ranges per thread is enough to balance, smaller ones only add overhead
+    const uint32_t targetRanges = ( GetWorkerCount() + 1 ) * 4;
+    const uint32_t batchSize = std::max( { minBatchSize, 1u, count / targetRanges } );
+    if ( count <= batchSize )
+    {
+        function( 0, count );
+        return;
+    }
+
+    //Every range job is a child of root, root can't finish while one of them is still running
+    JobHandle root;
+    std::function<void( uint32_t, uint32_t )> split = [ & ]( uint32_t begin, uint32_t end )
+        {
+            while ( end - begin > batchSize )
+            {
+                const uint32_t middle = begin + ( end - begin ) / 2;
+                Run( CreateChildJob( root, [ &split, middle, end ]() { split( middle, end ); } ) );
+                end = middle;
+            }
+            function( begin, end );
+        };
+
+    root = CreateJob( [ &split, count ]() { split( 0, count ); } );
+    Run( root );
+    Wait( root );
+}
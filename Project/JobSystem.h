@@ -0,0 +1,118 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//Work stealing task scheduler shared by the whole engine.
+//Every worker owns a Chase-Lev deque: it pushes and pops its own jobs at the bottom without locks,
+//idle workers steal from the top of the others. Threads that are not workers (main, loaders) hand
+//their jobs in through one locked queue, and help executing jobs while they Wait.
+//A job finishes once its function and all of its children are done, Wait rethrows the first exception of the tree.
+class JobSystem
+{
+public:
+    //Jobs pushed past this on one worker run right away instead of being queued
+    static constexpr uint32_t DEQUE_CAPACITY = 4096;
+    static constexpr uint32_t INVALID_WORKER = ~0u;
+
+    using JobFunction = std::function<void()>;
+    using RangeFunction = std::function<void( uint32_t begin, uint32_t end )>;
+
+    struct Job;
+
+    //Reference counted, the job stays alive as long as a handle, a queue or a child points to it
+    class JobHandle
+    {
+    public:
+        JobHandle() = default;
+        ~JobHandle();
+        JobHandle( const JobHandle& other );
+        JobHandle( JobHandle&& other ) noexcept;
+        JobHandle& operator=( JobHandle other ) noexcept;
+
+        bool IsValid() const { return m_Job != nullptr; }
+
+    private:
+        friend class JobSystem;
+        explicit JobHandle( Job* job ) : m_Job{ job } {}
+
+        Job* m_Job = nullptr;
+    };
+
+    //Hardware threads - 1 workers, the calling thread is expected to help through Wait
+    static JobSystem& Get();
+
+    explicit JobSystem( uint32_t workerCount );
+    ~JobSystem();
+
+    JobSystem( const JobSystem& ) = delete;
+    JobSystem& operator=( const JobSystem& ) = delete;
+
+    JobHandle CreateJob( JobFunction function );
+    //The parent only finishes after the child, create children before the parent is Run or from inside its function
+    JobHandle CreateChildJob( const JobHandle& parent, JobFunction function );
+
+    void Run( const JobHandle& job );
+    //Executes other jobs until this one and its children are done
+    void Wait( const JobHandle& job );
+    bool IsFinished( const JobHandle& job ) const;
+
+    //Calls function on disjoint ranges of [0, count) that are at least minBatchSize long, returns when all are done.
+    //Ranges are split in halves on the fly, so idle workers steal big pieces first
+    void ParallelFor( uint32_t count, uint32_t minBatchSize, const RangeFunction& function );
+
+    uint32_t GetWorkerCount() const { return static_cast< uint32_t >( m_Workers.size() ); }
+    //Index of the calling thread in this system, INVALID_WORKER for threads that are not its workers
+    uint32_t GetCurrentWorkerIndex() const;
+
+private:
+    //Lê, Pop, Cohen, Zappa Nardelli 2013 with a fixed ring. Push and Pop only from the owner
+    class WorkStealingDeque
+    {
+    public:
+        WorkStealingDeque();
+
+        bool Push( Job* job );
+        Job* Pop();
+        Job* Steal();
+
+    private:
+        std::unique_ptr<std::atomic<Job*>[]> m_Jobs;
+        alignas( 64 ) std::atomic<int64_t> m_Top{ 0 };
+        alignas( 64 ) std::atomic<int64_t> m_Bottom{ 0 };
+    };
+
+    struct Worker
+    {
+        WorkStealingDeque deque;
+        std::thread thread;
+    };
+
+    static void Retain( Job* job );
+    static void Release( Job* job );
+
+    void WorkerLoop( uint32_t workerIndex );
+    Job* FindJob( uint32_t workerIndex );
+    void Execute( Job* job );
+    void Finish( Job* job );
+
+    std::vector<std::unique_ptr<Worker>> m_Workers;
+
+    std::mutex m_InjectMutex;
+    std::deque<Job*> m_InjectedJobs;
+    std::atomic<uint32_t> m_InjectedCount{ 0 };
+
+    //Queued minus taken, workers only go to sleep while it is 0
+    std::atomic<int64_t> m_QueuedJobs{ 0 };
+    std::atomic<uint32_t> m_SleepingWorkers{ 0 };
+    std::mutex m_WakeMutex;
+    std::condition_variable m_WakeCondition;
+    std::atomic<bool> m_Stopping{ false };
+};
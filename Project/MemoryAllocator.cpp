@@ -0,0 +1,299 @@
+#include "MemoryAllocator.h"
+#include <stdexcept>
+#include <algorithm>
+#include <cassert>
+
+VkDeviceMemory VulkanMemoryBackend::AllocateMemory( uint32_t memoryTypeIndex, VkDeviceSize size )
+{
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    if ( vkAllocateMemory( m_Device, &allocInfo, nullptr, &memory ) != VK_SUCCESS )
+    {
+        return VK_NULL_HANDLE;
+    }
+    return memory;
+}
+
+void VulkanMemoryBackend::FreeMemory( VkDeviceMemory memory )
+{
+    vkFreeMemory( m_Device, memory, nullptr );
+}
+
+void* VulkanMemoryBackend::MapMemory( VkDeviceMemory memory )
+{
+    void* data = nullptr;
+    if ( vkMapMemory( m_Device, memory, 0, VK_WHOLE_SIZE, 0, &data ) != VK_SUCCESS )
+    {
+        return nullptr;
+    }
+    return data;
+}
+
+void VulkanMemoryBackend::UnmapMemory( VkDeviceMemory memory )
+{
+    vkUnmapMemory( m_Device, memory );
+}
+
+MemoryAllocator::MemoryAllocator( MemoryBackend& backend, VkDeviceSize blockSize, VkDeviceSize nonCoherentAtomSize )
+    : m_Backend{ backend },
+    m_BlockSize{ blockSize },
+    m_NonCoherentAtomSize{ std::max<VkDeviceSize>( nonCoherentAtomSize, 1 ) }
+{
+}
+
+MemoryAllocator::~MemoryAllocator()
+{
+    for ( auto& pool : m_Pools )
+    {
+        for ( auto& block : pool.blocks )
+        {
+            if ( block )
+            {
+                DestroyBlock( *block );
+            }
+        }
+    }
+}
+
+VkDeviceSize MemoryAllocator::AlignUp( VkDeviceSize value, VkDeviceSize alignment )
+{
+    return ( value + alignment - 1 ) / alignment * alignment;
+}
+
+MemoryAllocation MemoryAllocator::Allocate( const VkMemoryRequirements& requirements,
+    uint32_t memoryTypeIndex, bool hostVisible, ResourceType type )
+{
+    //Flushes of non coherent memory work in whole atoms, so mappable ranges never share one
+    VkDeviceSize alignment = std::max<VkDeviceSize>( requirements.alignment, 1 );
+    VkDeviceSize size = requirements.size;
+    if ( hostVisible )
+    {
+        alignment = std::max( alignment, m_NonCoherentAtomSize );
+        size = AlignUp( size, m_NonCoherentAtomSize );
+    }
+
+    std::lock_guard<std::mutex> lock{ m_Mutex };
+
+    const uint32_t poolIndex = GetPoolIndex( memoryTypeIndex, hostVisible, type );
+    Pool& pool = m_Pools[ poolIndex ];
+
+    MemoryAllocation allocation{};
+    allocation.poolIndex = poolIndex;
+    allocation.size = size;
+
+    //Big resources would only fragment the blocks, give them their own memory
+    if ( size > m_BlockSize / 2 )
+    {
+        allocation.memory = m_Backend.AllocateMemory( memoryTypeIndex, size );
+        if ( allocation.memory == VK_NULL_HANDLE )
+        {
+            throw std::runtime_error( "failed to allocate dedicated device memory!" );
+        }
+        if ( hostVisible )
+        {
+            allocation.mapped = m_Backend.MapMemory( allocation.memory );
+        }
+        allocation.dedicated = true;
+
+        m_Stats.dedicatedAllocationCount++;
+        m_Stats.allocationCount++;
+        m_Stats.reservedBytes += size;
+        m_Stats.usedBytes += size;
+        return allocation;
+    }
+
+    uint32_t blockIndex = 0;
+    VkDeviceSize offset = 0;
+    bool found = false;
+    for ( ; blockIndex < pool.blocks.size(); blockIndex++ )
+    {
+        if ( pool.blocks[ blockIndex ] && AllocateFromBlock( *pool.blocks[ blockIndex ], size, alignment, offset ) )
+        {
+            found = true;
+            break;
+        }
+    }
+
+    if ( !found )
+    {
+        //Reuse a released slot so the indices of live allocations stay valid
+        auto freeSlot = std::find( pool.blocks.begin(), pool.blocks.end(), nullptr );
+        blockIndex = static_cast< uint32_t >( freeSlot - pool.blocks.begin() );
+        if ( freeSlot == pool.blocks.end() )
+        {
+            pool.blocks.emplace_back();
+        }
+
+        pool.blocks[ blockIndex ] = CreateBlock( pool, m_BlockSize );
+        AllocateFromBlock( *pool.blocks[ blockIndex ], size, alignment, offset );
+    }
+
+    Block& block = *pool.blocks[ blockIndex ];
+    block.allocationCount++;
+
+    allocation.memory = block.memory;
+    allocation.offset = offset;
+    allocation.blockIndex = blockIndex;
+    allocation.mapped = block.mapped ? block.mapped + offset : nullptr;
+
+    m_Stats.allocationCount++;
+    m_Stats.usedBytes += size;
+    return allocation;
+}
+
+void MemoryAllocator::Free( MemoryAllocation& allocation )
+{
+    if ( !allocation.IsValid() )
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock{ m_Mutex };
+
+    m_Stats.allocationCount--;
+    m_Stats.usedBytes -= allocation.size;
+
+    if ( allocation.dedicated )
+    {
+        if ( allocation.mapped )
+        {
+            m_Backend.UnmapMemory( allocation.memory );
+        }
+        m_Backend.FreeMemory( allocation.memory );
+
+        m_Stats.dedicatedAllocationCount--;
+        m_Stats.reservedBytes -= allocation.size;
+        allocation = MemoryAllocation{};
+        return;
+    }
+
+    Pool& pool = m_Pools[ allocation.poolIndex ];
+    Block& block = *pool.blocks[ allocation.blockIndex ];
+    assert( block.memory == allocation.memory && "Allocation was not made from this allocator" );
+
+    auto next = block.freeRanges.lower_bound( allocation.offset );
+    auto inserted = block.freeRanges.emplace_hint( next, allocation.offset, allocation.size );
+
+    if ( next != block.freeRanges.end() && inserted->first + inserted->second == next->first )
+    {
+        inserted->second += next->second;
+        block.freeRanges.erase( next );
+    }
+    if ( inserted != block.freeRanges.begin() )
+    {
+        auto previous = std::prev( inserted );
+        if ( previous->first + previous->second == inserted->first )
+        {
+            previous->second += inserted->second;
+            block.freeRanges.erase( inserted );
+        }
+    }
+
+    //Keep one empty block per pool around, so a load/unload loop doesn't hit vkAllocateMemory every time
+    block.allocationCount--;
+    if ( block.allocationCount == 0 )
+    {
+        size_t liveBlocks = std::count_if( pool.blocks.begin(), pool.blocks.end(),
+            []( const std::unique_ptr<Block>& poolBlock ) { return poolBlock != nullptr; } );
+        if ( liveBlocks > 1 )
+        {
+            DestroyBlock( block );
+            pool.blocks[ allocation.blockIndex ].reset();
+        }
+    }
+
+    allocation = MemoryAllocation{};
+}
+
+MemoryStats MemoryAllocator::GetStats() const
+{
+    std::lock_guard<std::mutex> lock{ m_Mutex };
+    return m_Stats;
+}
+
+uint32_t MemoryAllocator::GetPoolIndex( uint32_t memoryTypeIndex, bool hostVisible, ResourceType type )
+{
+    for ( uint32_t i = 0; i < m_Pools.size(); i++ )
+    {
+        if ( m_Pools[ i ].memoryTypeIndex == memoryTypeIndex && m_Pools[ i ].type == type &&
+            m_Pools[ i ].hostVisible == hostVisible )
+        {
+            return i;
+        }
+    }
+
+    Pool pool{};
+    pool.memoryTypeIndex = memoryTypeIndex;
+    pool.type = type;
+    pool.hostVisible = hostVisible;
+    m_Pools.push_back( std::move( pool ) );
+    return static_cast< uint32_t >( m_Pools.size() - 1 );
+}
+
+bool MemoryAllocator::AllocateFromBlock( Block& block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset )
+{
+    //First fit, the padding in front of an aligned offset stays in the free list
+    for ( auto it = block.freeRanges.begin(); it != block.freeRanges.end(); ++it )
+    {
+        const VkDeviceSize rangeOffset = it->first;
+        const VkDeviceSize rangeEnd = it->first + it->second;
+        const VkDeviceSize alignedOffset = AlignUp( rangeOffset, alignment );
+        if ( alignedOffset + size > rangeEnd )
+        {
+            continue;
+        }
+
+        block.freeRanges.erase( it );
+        if ( alignedOffset > rangeOffset )
+        {
+            block.freeRanges.emplace( rangeOffset, alignedOffset - rangeOffset );
+        }
+        if ( alignedOffset + size < rangeEnd )
+        {
+            block.freeRanges.emplace( alignedOffset + size, rangeEnd - alignedOffset - size );
+        }
+
+        offset = alignedOffset;
+        return true;
+    }
+    return false;
+}
+
+std::unique_ptr<MemoryAllocator::Block> MemoryAllocator::CreateBlock( const Pool& pool, VkDeviceSize size )
+{
+    auto block = std::make_unique<Block>();
+    block->memory = m_Backend.AllocateMemory( pool.memoryTypeIndex, size );
+    if ( block->memory == VK_NULL_HANDLE )
+    {
+        throw std::runtime_error( "failed to allocate device memory block!" );
+    }
+
+    if ( pool.hostVisible )
+    {
+        block->mapped = static_cast< uint8_t* >( m_Backend.MapMemory( block->memory ) );
+    }
+
+    block->size = size;
+    block->freeRanges.emplace( 0, size );
+
+    m_Stats.blockCount++;
+    m_Stats.reservedBytes += size;
+    return block;
+}
+
+void MemoryAllocator::DestroyBlock( Block& block )
+{
+    if ( block.mapped )
+    {
+        m_Backend.UnmapMemory( block.memory );
+    }
+    m_Backend.FreeMemory( block.memory );
+
+    m_Stats.blockCount--;
+    m_Stats.reservedBytes -= block.size;
+    block = Block{};
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+
+//Where the allocator gets its device memory from, swap in a mock to run it without a gpu
+class MemoryBackend
+{
+public:
+    virtual ~MemoryBackend() = default;
+
+    //VK_NULL_HANDLE when the device is out of memory
+    virtual VkDeviceMemory AllocateMemory( uint32_t memoryTypeIndex, VkDeviceSize size ) = 0;
+    virtual void FreeMemory( VkDeviceMemory memory ) = 0;
+    virtual void* MapMemory( VkDeviceMemory memory ) = 0;
+    virtual void UnmapMemory( VkDeviceMemory memory ) = 0;
+};
+
+class VulkanMemoryBackend final : public MemoryBackend
+{
+public:
+    explicit VulkanMemoryBackend( VkDevice device ) : m_Device{ device } {}
+
+    VkDeviceMemory AllocateMemory( uint32_t memoryTypeIndex, VkDeviceSize size ) override;
+    void FreeMemory( VkDeviceMemory memory ) override;
+    void* MapMemory( VkDeviceMemory memory ) override;
+    void UnmapMemory( VkDeviceMemory memory ) override;
+
+private:
+    VkDevice m_Device;
+};
+
+//A range inside a shared block, bind resources with memory + offset
+struct MemoryAllocation
+{
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    void* mapped = nullptr;     //Points at offset already, nullptr if the memory type isn't host visible
+    uint32_t poolIndex = 0;
+    uint32_t blockIndex = 0;
+    bool dedicated = false;
+
+    bool IsValid() const { return memory != VK_NULL_HANDLE; }
+};
+
+struct MemoryStats
+{
+    size_t blockCount = 0;
+    size_t dedicatedAllocationCount = 0;
+    size_t allocationCount = 0;
+    VkDeviceSize reservedBytes = 0;     //Everything taken from the device, blocks + dedicated
+    VkDeviceSize usedBytes = 0;         //What is handed out, alignment padding excluded
+
+    size_t GetDeviceAllocationCount() const { return blockCount + dedicatedAllocationCount; }
+};
+
+//Sub-allocates buffers and images out of big blocks per memory type, with a sorted free list per block.
+//Host visible blocks stay mapped for their whole lifetime, so Buffer::map is free.
+class MemoryAllocator
+{
+public:
+    //Linear and optimal resources get separate blocks, so bufferImageGranularity never matters
+    enum class ResourceType { Buffer, Image };
+
+    static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+    MemoryAllocator( MemoryBackend& backend, VkDeviceSize blockSize = DEFAULT_BLOCK_SIZE,
+        VkDeviceSize nonCoherentAtomSize = 1 );
+    ~MemoryAllocator();
+
+    MemoryAllocator( const MemoryAllocator& ) = delete;
+    MemoryAllocator& operator=( const MemoryAllocator& ) = delete;
+
+    //Throws std::runtime_error when the backend is out of memory
+    MemoryAllocation Allocate( const VkMemoryRequirements& requirements, uint32_t memoryTypeIndex,
+        bool hostVisible, ResourceType type );
+    void Free( MemoryAllocation& allocation );
+
+    MemoryStats GetStats() const;
+    VkDeviceSize GetBlockSize() const { return m_BlockSize; }
+
+private:
+    struct Block
+    {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize size = 0;
+        uint8_t* mapped = nullptr;
+        std::map<VkDeviceSize, VkDeviceSize> freeRanges;   //offset -> size, neighbours get merged on free
+        size_t allocationCount = 0;
+    };
+
+    struct Pool
+    {
+        uint32_t memoryTypeIndex = 0;
+        ResourceType type = ResourceType::Buffer;
+        bool hostVisible = false;
+        std::vector<std::unique_ptr<Block>> blocks;         //nullptr slots are released blocks, indices stay stable
+    };
+
+    uint32_t GetPoolIndex( uint32_t memoryTypeIndex, bool hostVisible, ResourceType type );
+    bool AllocateFromBlock( Block& block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset );
+    std::unique_ptr<Block> CreateBlock( const Pool& pool, VkDeviceSize size );
+    void DestroyBlock( Block& block );
+
+    static VkDeviceSize AlignUp( VkDeviceSize value, VkDeviceSize alignment );
+
+    MemoryBackend& m_Backend;
+    const VkDeviceSize m_BlockSize;
+    const VkDeviceSize m_NonCoherentAtomSize;
+
+    mutable std::mutex m_Mutex;
+    std::vector<Pool> m_Pools;
+    MemoryStats m_Stats{};
+};
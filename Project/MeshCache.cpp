@@ -0,0 +1,273 @@
+#include "MeshCache.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//Read only memory mapping of a whole file, so the cache is paged in instead of parsed
+class MappedFile
+{
+public:
+	explicit MappedFile( const std::string& file )
+	{
+#ifdef _WIN32
+		m_File = CreateFileA( file.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr );
+		if ( m_File == INVALID_HANDLE_VALUE ) { return; }
+
+		LARGE_INTEGER size{};
+		if ( !GetFileSizeEx( m_File, &size ) || size.QuadPart == 0 ) { return; }
+
+		m_Mapping = CreateFileMappingA( m_File, nullptr, PAGE_READONLY, 0, 0, nullptr );
+		if ( m_Mapping == nullptr ) { return; }
+
+		m_Data = static_cast< const uint8_t* >( MapViewOfFile( m_Mapping, FILE_MAP_READ, 0, 0, 0 ) );
+		m_Size = m_Data ? static_cast< size_t >( size.QuadPart ) : 0;
+#else
+		m_File = open( file.c_str(), O_RDONLY );
+		if ( m_File < 0 ) { return; }
+
+		struct stat fileStat{};
+		if ( fstat( m_File, &fileStat ) != 0 || fileStat.st_size == 0 ) { return; }
+
+		void* data = mmap( nullptr, static_cast< size_t >( fileStat.st_size ), PROT_READ, MAP_PRIVATE, m_File, 0 );
+		if ( data == MAP_FAILED ) { return; }
+
+		m_Data = static_cast< const uint8_t* >( data );
+		m_Size = static_cast< size_t >( fileStat.st_size );
+#endif
+	}
+
+	~MappedFile()
+	{
+#ifdef _WIN32
+		if ( m_Data ) { UnmapViewOfFile( m_Data ); }
+		if ( m_Mapping ) { CloseHandle( m_Mapping ); }
+		if ( m_File != INVALID_HANDLE_VALUE ) { CloseHandle( m_File ); }
+#else
+		if ( m_Data ) { munmap( const_cast< uint8_t* >( m_Data ), m_Size ); }
+		if ( m_File >= 0 ) { close( m_File ); }
+#endif
+	}
+
+	MappedFile( const MappedFile& ) = delete;
+	MappedFile& operator=( const MappedFile& ) = delete;
+
+	const uint8_t* Data() const { return m_Data; }
+	size_t Size() const { return m_Size; }
+
+private:
+#ifdef _WIN32
+	HANDLE m_File = INVALID_HANDLE_VALUE;
+	HANDLE m_Mapping = nullptr;
+#else
+	int m_File = -1;
+#endif
+	const uint8_t* m_Data = nullptr;
+	size_t m_Size = 0;
+};
+
+static bool GetSourceStamp( const std::string& sourceFile, uint64_t& size, int64_t& time )
+{
+	std::error_code error;
+	size = static_cast< uint64_t >( std::filesystem::file_size( sourceFile, error ) );
+	if ( error ) { return false; }
+
+	time = static_cast< int64_t >( std::filesystem::last_write_time( sourceFile, error ).time_since_epoch().count() );
+	return !error;
+}
+
+std::string MeshCache::GetCachePath( const std::string& sourceFile )
+{
+	return sourceFile + ".meshcache";
+}
+
+bool MeshCache::Load( const std::string& sourceFile, Model::ModelData& modelData )
+{
+	uint64_t sourceSize;
+	int64_t sourceTime;
+	if ( !GetSourceStamp( sourceFile, sourceSize, sourceTime ) )
+	{
+		return false;
+	}
+
+	const std::string cacheFile = GetCachePath( sourceFile );
+	Header header;
+	{
+		MappedFile mapped{ cacheFile };
+		if ( mapped.Data() == nullptr || mapped.Size() < sizeof( Header ) )
+		{
+			return false;
+		}
+
+		std::memcpy( &header, mapped.Data(), sizeof( Header ) );
+
+		const size_t expectedSize = sizeof( Header ) +
+			static_cast< size_t >( header.vertexCount ) * sizeof( Model::Vertex ) +
+			static_cast< size_t >( header.indexCount ) * sizeof( uint32_t ) +
+			static_cast< size_t >( header.lodCount ) * sizeof( Model::LodRange ) +
+			static_cast< size_t >( header.lodIndexCount ) * sizeof( uint32_t ) +
+			static_cast< size_t >( header.meshletCount ) * sizeof( Model::Meshlet );
+
+		if ( std::memcmp( header.magic, "VKMC", 4 ) != 0 ||
+			header.version != VERSION ||
+			header.vertexSize != sizeof( Model::Vertex ) ||
+			header.sourceSize != sourceSize ||
+			mapped.Size() != expectedSize )
+		{
+			return false;
+		}
+
+		//Same size but touched (checkout, copy): only trust the cache if the contents still hash the same
+		if ( header.sourceTime != sourceTime && HashFile( sourceFile ) != header.sourceHash )
+		{
+			return false;
+		}
+
+		const auto* vertices = reinterpret_cast< const Model::Vertex* >( mapped.Data() + sizeof( Header ) );
+		const auto* indices = reinterpret_cast< const uint32_t* >( vertices + header.vertexCount );
+		const auto* lods = reinterpret_cast< const Model::LodRange* >( indices + header.indexCount );
+		const auto* lodIndices = reinterpret_cast< const uint32_t* >( lods + header.lodCount );
+		const auto* meshlets = reinterpret_cast< const Model::Meshlet* >( lodIndices + header.lodIndexCount );
+
+		//Model draws straight from these ranges, a damaged file must not point past the indices
+		const uint64_t totalIndexCount = uint64_t( header.indexCount ) + header.lodIndexCount;
+		for ( uint32_t lod = 0; lod < header.lodCount; lod++ )
+		{
+			if ( uint64_t( lods[ lod ].firstIndex ) + lods[ lod ].indexCount > totalIndexCount )
+			{
+				return false;
+			}
+		}
+		for ( uint32_t meshlet = 0; meshlet < header.meshletCount; meshlet++ )
+		{
+			if ( uint64_t( meshlets[ meshlet ].firstIndex ) + meshlets[ meshlet ].indexCount > header.indexCount )
+			{
+				return false;
+			}
+		}
+		//Nor an index past the vertices, the gpu would read outside the vertex buffer
+		auto indicesInRange = [ &header ]( const uint32_t* first, uint32_t count )
+			{
+				for ( uint32_t i = 0; i < count; i++ )
+				{
+					if ( first[ i ] >= header.vertexCount ) return false;
+				}
+				return true;
+			};
+		if ( !indicesInRange( indices, header.indexCount ) || !indicesInRange( lodIndices, header.lodIndexCount ) )
+		{
+			return false;
+		}
+
+		modelData.vertices.assign( vertices, vertices + header.vertexCount );
+		modelData.indices.assign( indices, indices + header.indexCount );
+		modelData.lods.assign( lods, lods + header.lodCount );
+		modelData.lodIndices.assign( lodIndices, lodIndices + header.lodIndexCount );
+		modelData.meshlets.assign( meshlets, meshlets + header.meshletCount );
+	}
+
+	//Restamp after unmapping, so the next launch takes the fast path again
+	if ( header.sourceTime != sourceTime )
+	{
+		header.sourceTime = sourceTime;
+		UpdateSourceStamp( cacheFile, header );
+	}
+
+	modelData.triangles = modelData.GetTriangles();
+	return true;
+}
+
+bool MeshCache::Save( const std::string& sourceFile, const Model::ModelData& modelData )
+{
+	Header header{};
+	std::memcpy( header.magic, "VKMC", 4 );
+	header.version = VERSION;
+	header.vertexSize = sizeof( Model::Vertex );
+	header.vertexCount = static_cast< uint32_t >( modelData.vertices.size() );
+	header.indexCount = static_cast< uint32_t >( modelData.indices.size() );
+	header.lodCount = static_cast< uint32_t >( modelData.lods.size() );
+	header.lodIndexCount = static_cast< uint32_t >( modelData.lodIndices.size() );
+	header.meshletCount = static_cast< uint32_t >( modelData.meshlets.size() );
+	header.sourceHash = HashFile( sourceFile );
+
+	if ( !GetSourceStamp( sourceFile, header.sourceSize, header.sourceTime ) )
+	{
+		return false;
+	}
+
+	//Write to a temporary file first, so a crash never leaves a half written cache behind
+	const std::string cacheFile = GetCachePath( sourceFile );
+	const std::string tempFile = cacheFile + ".tmp";
+	{
+		std::ofstream file{ tempFile, std::ios::binary | std::ios::trunc };
+		if ( !file.is_open() )
+		{
+			std::cout << "Could not write mesh cache: " << cacheFile << std::endl;
+			return false;
+		}
+
+		file.write( reinterpret_cast< const char* >( &header ), sizeof( Header ) );
+		file.write( reinterpret_cast< const char* >( modelData.vertices.data() ),
+			modelData.vertices.size() * sizeof( Model::Vertex ) );
+		file.write( reinterpret_cast< const char* >( modelData.indices.data() ),
+			modelData.indices.size() * sizeof( uint32_t ) );
+		file.write( reinterpret_cast< const char* >( modelData.lods.data() ),
+			modelData.lods.size() * sizeof( Model::LodRange ) );
+		file.write( reinterpret_cast< const char* >( modelData.lodIndices.data() ),
+			modelData.lodIndices.size() * sizeof( uint32_t ) );
+		file.write( reinterpret_cast< const char* >( modelData.meshlets.data() ),
+			modelData.meshlets.size() * sizeof( Model::Meshlet ) );
+
+		if ( !file.good() )
+		{
+			std::cout << "Could not write mesh cache: " << cacheFile << std::endl;
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename( tempFile, cacheFile, error );
+	if ( error )
+	{
+		std::filesystem::remove( tempFile, error );
+		return false;
+	}
+	return true;
+}
+
+uint64_t MeshCache::HashFile( const std::string& file )
+{
+	MappedFile mapped{ file };
+
+	uint64_t hash = 14695981039346656037ull;
+	for ( size_t i = 0; i < mapped.Size(); i++ )
+	{
+		hash ^= mapped.Data()[ i ];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+bool MeshCache::UpdateSourceStamp( const std::string& cacheFile, const Header& header )
+{
+	std::fstream file{ cacheFile, std::ios::binary | std::ios::in | std::ios::out };
+	if ( !file.is_open() )
+	{
+		return false;
+	}
+
+	file.write( reinterpret_cast< const char* >( &header ), sizeof( Header ) );
+	return file.good();
+}
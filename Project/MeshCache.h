@@ -0,0 +1,44 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include "Model.h"
+
+//Binary cache of a parsed, deduplicated and MeshOptimizer processed mesh, written next to the source as <file>.meshcache.
+//Layout: Header, vertexCount * Model::Vertex, indexCount * uint32_t, lodCount * Model::LodRange, lodIndexCount * uint32_t,
+//meshletCount * Model::Meshlet
+class MeshCache
+{
+public:
+	//2: indices and vertices are stored in MeshOptimizer order
+	//3: lods from MeshSimplifier
+	//4: meshlets from MeshletBuilder
+	//5: seam preserving lods with plane distance errors
+	//6: meshlet cone axes point outward
+	//7: overdraw order sorts on outward normals
+	static constexpr uint32_t VERSION = 7;
+
+	struct Header
+	{
+		char magic[ 4 ];
+		uint32_t version;
+		uint32_t vertexSize;		//sizeof( Model::Vertex ) when written, guards against layout changes
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		uint32_t lodCount;
+		uint32_t lodIndexCount;
+		uint32_t meshletCount;
+		uint64_t sourceSize;
+		int64_t sourceTime;
+		uint64_t sourceHash;		//FNV-1a of the source file, used when only the timestamp changed
+	};
+
+	//Fills vertices, indices, lods, meshlets and triangles from the cache if it is still valid for the source file
+	static bool Load( const std::string& sourceFile, Model::ModelData& modelData );
+	static bool Save( const std::string& sourceFile, const Model::ModelData& modelData );
+
+	static std::string GetCachePath( const std::string& sourceFile );
+
+private:
+	static uint64_t HashFile( const std::string& file );
+	static bool UpdateSourceStamp( const std::string& cacheFile, const Header& header );
+};
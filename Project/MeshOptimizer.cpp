@@ -0,0 +1,396 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	//Forsyth's constants, his lru cache is larger than the fifo we measure with on purpose
+	constexpr uint32_t FORSYTH_CACHE_SIZE = 32;
+	constexpr float CACHE_DECAY_POWER = 1.5f;
+	constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+	constexpr float VALENCE_BOOST_SCALE = 2.f;
+	constexpr float VALENCE_BOOST_POWER = 0.5f;
+	constexpr uint32_t VALENCE_TABLE_SIZE = 64;
+
+	constexpr uint32_t INVALID_TRIANGLE = ~0u;
+
+	struct ScoreTables
+	{
+		float cache[ FORSYTH_CACHE_SIZE ];
+		float valence[ VALENCE_TABLE_SIZE ];
+
+		ScoreTables()
+		{
+			for ( uint32_t position = 0; position < FORSYTH_CACHE_SIZE; position++ )
+			{
+				//The last triangle's vertices get a fixed score, so it doesn't just continue the same strip
+				cache[ position ] = position < 3
+					? LAST_TRIANGLE_SCORE
+					: std::pow( 1.f - float( position - 3 ) / float( FORSYTH_CACHE_SIZE - 3 ), CACHE_DECAY_POWER );
+			}
+			for ( uint32_t remaining = 0; remaining < VALENCE_TABLE_SIZE; remaining++ )
+			{
+				valence[ remaining ] = remaining == 0 ? 0.f : VALENCE_BOOST_SCALE * std::pow( float( remaining ), -VALENCE_BOOST_POWER );
+			}
+		}
+
+		//Vertices with few triangles left are boosted, finishing them off frees their cache entry
+		float VertexScore( int32_t cachePosition, uint32_t remainingTriangles ) const
+		{
+			if ( remainingTriangles == 0 )
+			{
+				return -1.f;
+			}
+
+			const float cacheScore = cachePosition >= 0 ? cache[ cachePosition ] : 0.f;
+			const float valenceScore = remainingTriangles < VALENCE_TABLE_SIZE
+				? valence[ remainingTriangles ]
+				: VALENCE_BOOST_SCALE * std::pow( float( remainingTriangles ), -VALENCE_BOOST_POWER );
+			return cacheScore + valenceScore;
+		}
+	};
+
+	//Fifo post transform cache on timestamps, returns how many of the triangle's vertices had to be shaded
+	class CacheSimulation
+	{
+	public:
+		CacheSimulation( size_t vertexCount, uint32_t cacheSize )
+			: m_Timestamps( vertexCount, 0 ), m_CacheSize{ cacheSize }, m_Timestamp{ cacheSize + 1 } {}
+
+		uint32_t AddTriangle( const uint32_t* triangle )
+		{
+			uint32_t misses = 0;
+			for ( int i = 0; i < 3; i++ )
+			{
+				if ( m_Timestamp - m_Timestamps[ triangle[ i ] ] > m_CacheSize )
+				{
+					m_Timestamps[ triangle[ i ] ] = m_Timestamp++;
+					misses++;
+				}
+			}
+			return misses;
+		}
+
+		//Everything that was cached is evicted
+		void Flush() { m_Timestamp += m_CacheSize + 1; }
+
+	private:
+		std::vector<uint32_t> m_Timestamps;
+		uint32_t m_CacheSize;
+		uint32_t m_Timestamp;
+	};
+}
+
+MeshOptimizer::OptimizeStats MeshOptimizer::Optimize( std::vector<Model::Vertex>& vertices, std::vector<uint32_t>& indices )
+{
+	OptimizeStats stats{};
+	if ( indices.empty() || indices.size() % 3 != 0 )
+	{
+		return stats;
+	}
+
+	stats.before = AnalyzeVertexCache( indices, vertices.size() );
+	OptimizeVertexCache( indices, vertices.size() );
+	OptimizeOverdraw( indices, vertices );
+	OptimizeVertexFetch( vertices, indices );
+	stats.after = AnalyzeVertexCache( indices, vertices.size() );
+	return stats;
+}
+
+MeshOptimizer::VertexCacheStats MeshOptimizer::AnalyzeVertexCache( const std::vector<uint32_t>& indices,
+	size_t vertexCount, uint32_t cacheSize )
+{
+	VertexCacheStats stats{};
+	const size_t triangleCount = indices.size() / 3;
+	if ( triangleCount == 0 )
+	{
+		return stats;
+	}
+
+	CacheSimulation cache{ vertexCount, cacheSize };
+	std::vector<uint8_t> referenced( vertexCount, 0 );
+	size_t misses = 0;
+	size_t referencedCount = 0;
+
+	for ( size_t triangle = 0; triangle < triangleCount; triangle++ )
+	{
+		misses += cache.AddTriangle( &indices[ triangle * 3 ] );
+		for ( int i = 0; i < 3; i++ )
+		{
+			uint8_t& seen = referenced[ indices[ triangle * 3 + i ] ];
+			referencedCount += seen == 0;
+			seen = 1;
+		}
+	}
+
+	stats.acmr = float( misses ) / float( triangleCount );
+	stats.atvr = float( misses ) / float( referencedCount );
+	return stats;
+}
+
+void MeshOptimizer::OptimizeVertexCache( std::vector<uint32_t>& indices, size_t vertexCount )
+{
+	static const ScoreTables scoreTables{};
+
+	const size_t triangleCount = indices.size() / 3;
+	if ( triangleCount == 0 )
+	{
+		return;
+	}
+
+	//Triangles of every vertex as ranges in one array, the first remainingTriangles[ v ] of a range aren't emitted yet
+	std::vector<uint32_t> remainingTriangles( vertexCount, 0 );
+	for ( uint32_t index : indices )
+	{
+		remainingTriangles[ index ]++;
+	}
+
+	std::vector<uint32_t> offsets( vertexCount + 1, 0 );
+	for ( size_t vertex = 0; vertex < vertexCount; vertex++ )
+	{
+		offsets[ vertex + 1 ] = offsets[ vertex ] + remainingTriangles[ vertex ];
+	}
+
+	std::vector<uint32_t> adjacency( indices.size() );
+	{
+		std::vector<uint32_t> fill( offsets.begin(), offsets.end() - 1 );
+		for ( size_t i = 0; i < indices.size(); i++ )
+		{
+			adjacency[ fill[ indices[ i ] ]++ ] = static_cast< uint32_t >( i / 3 );
+		}
+	}
+
+	std::vector<int32_t> cachePositions( vertexCount, -1 );
+	std::vector<float> vertexScores( vertexCount );
+	for ( size_t vertex = 0; vertex < vertexCount; vertex++ )
+	{
+		vertexScores[ vertex ] = scoreTables.VertexScore( -1, remainingTriangles[ vertex ] );
+	}
+
+	auto triangleScore = [ & ]( uint32_t triangle )
+		{
+			return vertexScores[ indices[ triangle * 3 + 0 ] ] +
+				vertexScores[ indices[ triangle * 3 + 1 ] ] +
+				vertexScores[ indices[ triangle * 3 + 2 ] ];
+		};
+
+	//Start on the triangle with the loneliest vertices
+	uint32_t bestTriangle = 0;
+	float bestScore = -1.f;
+	for ( uint32_t triangle = 0; triangle < triangleCount; triangle++ )
+	{
+		const float score = triangleScore( triangle );
+		if ( score > bestScore )
+		{
+			bestScore = score;
+			bestTriangle = triangle;
+		}
+	}
+
+	std::vector<uint8_t> emitted( triangleCount, 0 );
+	std::vector<uint32_t> result;
+	result.reserve( indices.size() );
+	std::vector<uint32_t> cache;
+	std::vector<uint32_t> newCache;
+	cache.reserve( FORSYTH_CACHE_SIZE + 3 );
+	newCache.reserve( FORSYTH_CACHE_SIZE + 3 );
+	uint32_t scanCursor = 0;
+
+	while ( bestTriangle != INVALID_TRIANGLE )
+	{
+		emitted[ bestTriangle ] = 1;
+		const uint32_t* triangle = &indices[ bestTriangle * 3 ];
+		result.insert( result.end(), triangle, triangle + 3 );
+
+		//The triangle's vertices move to the front, the rest keeps its order behind them
+		newCache.assign( triangle, triangle + 3 );
+		for ( uint32_t vertex : cache )
+		{
+			if ( vertex != triangle[ 0 ] && vertex != triangle[ 1 ] && vertex != triangle[ 2 ] )
+			{
+				newCache.push_back( vertex );
+			}
+		}
+
+		//Swap the emitted triangle behind the still remaining ones of each of its vertices
+		for ( int i = 0; i < 3; i++ )
+		{
+			const uint32_t vertex = triangle[ i ];
+			uint32_t* begin = &adjacency[ offsets[ vertex ] ];
+			uint32_t* last = begin + remainingTriangles[ vertex ] - 1;
+			std::iter_swap( std::find( begin, last, bestTriangle ), last );
+			remainingTriangles[ vertex ]--;
+		}
+
+		//Everything that moved or fell out of the cache gets rescored, the best triangle touching it goes next
+		for ( size_t i = 0; i < newCache.size(); i++ )
+		{
+			const uint32_t vertex = newCache[ i ];
+			cachePositions[ vertex ] = i < FORSYTH_CACHE_SIZE ? static_cast< int32_t >( i ) : -1;
+			vertexScores[ vertex ] = scoreTables.VertexScore( cachePositions[ vertex ], remainingTriangles[ vertex ] );
+		}
+
+		bestTriangle = INVALID_TRIANGLE;
+		bestScore = -1.f;
+		for ( uint32_t vertex : newCache )
+		{
+			for ( uint32_t i = 0; i < remainingTriangles[ vertex ]; i++ )
+			{
+				const uint32_t candidate = adjacency[ offsets[ vertex ] + i ];
+				const float score = triangleScore( candidate );
+				if ( score > bestScore )
+				{
+					bestScore = score;
+					bestTriangle = candidate;
+				}
+			}
+		}
+
+		newCache.resize( std::min<size_t>( newCache.size(), FORSYTH_CACHE_SIZE ) );
+		cache.swap( newCache );
+
+		//Nothing in the cache has work left, carry on with the next triangle in the original order
+		if ( bestTriangle == INVALID_TRIANGLE )
+		{
+			while ( scanCursor < triangleCount && emitted[ scanCursor ] )
+			{
+				scanCursor++;
+			}
+			if ( scanCursor < triangleCount )
+			{
+				bestTriangle = scanCursor;
+			}
+		}
+	}
+
+	indices.swap( result );
+}
+
+std::vector<uint32_t> MeshOptimizer::FindClusters( const std::vector<uint32_t>& indices, size_t vertexCount, float threshold )
+{
+	const uint32_t triangleCount = static_cast< uint32_t >( indices.size() / 3 );
+	CacheSimulation cache{ vertexCount, SIMULATED_CACHE_SIZE };
+
+	//Hard boundaries: all three vertices missed, so nothing before the triangle was still in the cache
+	std::vector<uint32_t> hardBoundaries;
+	for ( uint32_t triangle = 0; triangle < triangleCount; triangle++ )
+	{
+		if ( cache.AddTriangle( &indices[ triangle * 3 ] ) == 3 || triangle == 0 )
+		{
+			hardBoundaries.push_back( triangle );
+		}
+	}
+	hardBoundaries.push_back( triangleCount );
+
+	//Soft boundaries: split a hard cluster again as soon as the part so far, from a cold cache,
+	//is within threshold of the whole cluster's miss ratio
+	std::vector<uint32_t> clusters;
+	for ( size_t i = 0; i + 1 < hardBoundaries.size(); i++ )
+	{
+		const uint32_t begin = hardBoundaries[ i ];
+		const uint32_t end = hardBoundaries[ i + 1 ];
+
+		cache.Flush();
+		uint32_t clusterMisses = 0;
+		for ( uint32_t triangle = begin; triangle < end; triangle++ )
+		{
+			clusterMisses += cache.AddTriangle( &indices[ triangle * 3 ] );
+		}
+		const float clusterThreshold = threshold * float( clusterMisses ) / float( end - begin );
+
+		cache.Flush();
+		clusters.push_back( begin );
+		uint32_t runningMisses = 0;
+		uint32_t runningTriangles = 0;
+		for ( uint32_t triangle = begin; triangle < end; triangle++ )
+		{
+			runningMisses += cache.AddTriangle( &indices[ triangle * 3 ] );
+			runningTriangles++;
+
+			if ( triangle + 1 < end && float( runningMisses ) <= clusterThreshold * float( runningTriangles ) )
+			{
+				clusters.push_back( triangle + 1 );
+				cache.Flush();
+				runningMisses = 0;
+				runningTriangles = 0;
+			}
+		}
+	}
+	return clusters;
+}
+
+void MeshOptimizer::OptimizeOverdraw( std::vector<uint32_t>& indices, const std::vector<Model::Vertex>& vertices, float threshold )
+{
+	const uint32_t triangleCount = static_cast< uint32_t >( indices.size() / 3 );
+	if ( triangleCount == 0 )
+	{
+		return;
+	}
+
+	std::vector<uint32_t> clusters = FindClusters( indices, vertices.size(), threshold );
+	clusters.push_back( triangleCount );
+	const size_t clusterCount = clusters.size() - 1;
+
+	//Area weighted centroid and summed normal of every cluster
+	std::vector<glm::vec3> centroids( clusterCount, glm::vec3( 0.f ) );
+	std::vector<glm::vec3> normals( clusterCount, glm::vec3( 0.f ) );
+	std::vector<float> areas( clusterCount, 0.f );
+	glm::vec3 meshCentroid{ 0.f };
+	float meshArea = 0.f;
+
+	for ( size_t cluster = 0; cluster < clusterCount; cluster++ )
+	{
+		for ( uint32_t triangle = clusters[ cluster ]; triangle < clusters[ cluster + 1 ]; triangle++ )
+		{
+			const glm::vec3& a = vertices[ indices[ triangle * 3 + 0 ] ].position;
+			const glm::vec3& b = vertices[ indices[ triangle * 3 + 1 ] ].position;
+			const glm::vec3& c = vertices[ indices[ triangle * 3 + 2 ] ].position;
+
+			//LoadModel mirrors y without reversing the winding, so this is the outward normal
+			const glm::vec3 normal = glm::cross( c - a, b - a );
+			const float area = glm::length( normal );
+
+			centroids[ cluster ] = centroids[ cluster ] + ( a + b + c ) * ( area / 3.f );
+			normals[ cluster ] = normals[ cluster ] + normal;
+			areas[ cluster ] += area;
+		}
+
+		meshCentroid = meshCentroid + centroids[ cluster ];
+		meshArea += areas[ cluster ];
+	}
+
+	if ( meshArea > 0.f )
+	{
+		meshCentroid = meshCentroid / meshArea;
+	}
+
+	//Clusters far out along their own normal are seen first from most directions, so they go first
+	std::vector<float> sortKeys( clusterCount, 0.f );
+	for ( size_t cluster = 0; cluster < clusterCount; cluster++ )
+	{
+		const float normalLength = glm::length( normals[ cluster ] );
+		if ( areas[ cluster ] > 0.f && normalLength > 0.f )
+		{
+			const glm::vec3 centroid = centroids[ cluster ] / areas[ cluster ];
+			sortKeys[ cluster ] = glm::dot( centroid - meshCentroid, normals[ cluster ] / normalLength );
+		}
+	}
+
+	std::vector<uint32_t> order( clusterCount );
+	for ( uint32_t cluster = 0; cluster < clusterCount; cluster++ )
+	{
+		order[ cluster ] = cluster;
+	}
+	std::stable_sort( order.begin(), order.end(),
+		[ &sortKeys ]( uint32_t a, uint32_t b ) { return sortKeys[ a ] > sortKeys[ b ]; } );
+
+	std::vector<uint32_t> result;
+	result.reserve( indices.size() );
+	for ( uint32_t cluster : order )
+	{
+		result.insert( result.end(),
+			indices.begin() + clusters[ cluster ] * 3,
+			indices.begin() + clusters[ cluster + 1 ] * 3 );
+	}
+	indices.swap( result );
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "Model.h"
+
+//Reorders a mesh for the gpu at import time, the mesh cache stores the result so it only runs once per file.
+//Triangles are reordered for the post transform vertex cache (Forsyth), then clusters of them are sorted
+//so outward facing ones draw first (less overdraw), then vertices are renumbered in the new fetch order.
+class MeshOptimizer
+{
+public:
+	//Entries of the simulated fifo post transform cache, what current desktop gpus roughly behave like
+	static constexpr uint32_t SIMULATED_CACHE_SIZE = 16;
+	//Clusters may cost this much more vertex cache misses than the order they were cut from
+	static constexpr float OVERDRAW_THRESHOLD = 1.05f;
+
+	using VertexCacheStats = Model::VertexCacheStats;
+
+	struct OptimizeStats
+	{
+		VertexCacheStats before;
+		VertexCacheStats after;
+	};
+
+	//All three passes, in the order they build on each other. Returns the vertex cache stats of the order
+	//the mesh came in and of the optimized one
+	static OptimizeStats Optimize( std::vector<Model::Vertex>& vertices, std::vector<uint32_t>& indices );
+
+	static VertexCacheStats AnalyzeVertexCache( const std::vector<uint32_t>& indices, size_t vertexCount,
+		uint32_t cacheSize = SIMULATED_CACHE_SIZE );
+
+	//Tom Forsyth's linear speed vertex cache optimisation, scores vertices on their lru position and remaining triangles
+	static void OptimizeVertexCache( std::vector<uint32_t>& indices, size_t vertexCount );
+	//Cuts the cache optimized order into clusters and sorts them front to back as seen from outside the mesh
+	static void OptimizeOverdraw( std::vector<uint32_t>& indices, const std::vector<Model::Vertex>& vertices,
+		float threshold = OVERDRAW_THRESHOLD );
+	//Renumbers vertices in first use order and drops unreferenced ones, so fetches walk the buffer forward
+	template<typename VertexType>
+	static void OptimizeVertexFetch( std::vector<VertexType>& vertices, std::vector<uint32_t>& indices );
+
+private:
+	//Triangle index where every cluster starts
+	static std::vector<uint32_t> FindClusters( const std::vector<uint32_t>& indices, size_t vertexCount, float threshold );
+};
+
+template<typename VertexType>
+void MeshOptimizer::OptimizeVertexFetch( std::vector<VertexType>& vertices, std::vector<uint32_t>& indices )
+{
+	constexpr uint32_t UNUSED = ~0u;
+	std::vector<uint32_t> remap( vertices.size(), UNUSED );
+	std::vector<VertexType> reordered;
+	reordered.reserve( vertices.size() );
+
+	for ( uint32_t& index : indices )
+	{
+		if ( remap[ index ] == UNUSED )
+		{
+			remap[ index ] = static_cast< uint32_t >( reordered.size() );
+			reordered.push_back( vertices[ index ] );
+		}
+		index = remap[ index ];
+	}
+
+	vertices.swap( reordered );
+}
@@ -0,0 +1,411 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <unordered_map>
+
+namespace
+{
+	//Symmetric 4x4 matrix of the summed squared plane distances, weighted by triangle area
+	struct Quadric
+	{
+		double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+		double a11 = 0, a12 = 0, a13 = 0;
+		double a22 = 0, a23 = 0;
+		double a33 = 0;
+		double weight = 0;
+
+		static Quadric FromPlane( const glm::vec3& normal, float distance, double weight )
+		{
+			const double a = normal.x, b = normal.y, c = normal.z, d = distance;
+			Quadric quadric;
+			quadric.a00 = a * a * weight; quadric.a01 = a * b * weight; quadric.a02 = a * c * weight; quadric.a03 = a * d * weight;
+			quadric.a11 = b * b * weight; quadric.a12 = b * c * weight; quadric.a13 = b * d * weight;
+			quadric.a22 = c * c * weight; quadric.a23 = c * d * weight;
+			quadric.a33 = d * d * weight;
+			quadric.weight = weight;
+			return quadric;
+		}
+
+		Quadric& operator+=( const Quadric& other )
+		{
+			a00 += other.a00; a01 += other.a01; a02 += other.a02; a03 += other.a03;
+			a11 += other.a11; a12 += other.a12; a13 += other.a13;
+			a22 += other.a22; a23 += other.a23;
+			a33 += other.a33;
+			weight += other.weight;
+			return *this;
+		}
+
+		//Area weighted mean squared distance of the point to all the planes
+		double Evaluate( const glm::vec3& point ) const
+		{
+			const double x = point.x, y = point.y, z = point.z;
+			const double error =
+				a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + 2 * a03 * x +
+				a11 * y * y + 2 * a12 * y * z + 2 * a13 * y +
+				a22 * z * z + 2 * a23 * z +
+				a33;
+			return weight > 0 ? std::max( error, 0.0 ) / weight : 0.0;
+		}
+	};
+
+	struct PositionKey
+	{
+		uint32_t bits[ 3 ];
+		bool operator==( const PositionKey& other ) const { return std::memcmp( bits, other.bits, sizeof( bits ) ) == 0; }
+	};
+
+	struct PositionKeyHash
+	{
+		size_t operator()( const PositionKey& key ) const
+		{
+			return ( key.bits[ 0 ] * 73856093u ) ^ ( key.bits[ 1 ] * 19349663u ) ^ ( key.bits[ 2 ] * 83492791u );
+		}
+	};
+
+	struct Collapse
+	{
+		uint32_t from;
+		uint32_t to;
+		double cost;
+	};
+
+	uint64_t EdgeKey( uint32_t a, uint32_t b )
+	{
+		return a < b ? ( uint64_t( a ) << 32 ) | b : ( uint64_t( b ) << 32 ) | a;
+	}
+}
+
+void MeshSimplifier::BuildLods( Model::ModelData& modelData )
+{
+	modelData.lods.clear();
+	modelData.lodIndices.clear();
+	if ( modelData.indices.empty() )
+	{
+		return;
+	}
+
+	const uint32_t baseCount = static_cast< uint32_t >( modelData.indices.size() );
+	modelData.lods.push_back( { 0, baseCount, 0.f } );
+
+	//Every level is simplified from the one before, its error adds up on top of the previous ones
+	std::vector<uint32_t> previous = modelData.indices;
+	float error = 0.f;
+	while ( modelData.lods.size() < Model::MAX_LODS )
+	{
+		const size_t target = static_cast< size_t >( previous.size() / 3 * LOD_TRIANGLE_RATIO ) * 3;
+		float levelError = 0.f;
+		std::vector<uint32_t> simplified = Simplify( modelData.vertices, previous, target, levelError );
+		if ( simplified.empty() || simplified.size() > previous.size() * MIN_LOD_REDUCTION )
+		{
+			break;
+		}
+
+		MeshOptimizer::OptimizeVertexCache( simplified, modelData.vertices.size() );
+		error += levelError;
+
+		const uint32_t firstIndex = baseCount + static_cast< uint32_t >( modelData.lodIndices.size() );
+		modelData.lods.push_back( { firstIndex, static_cast< uint32_t >( simplified.size() ), error } );
+		modelData.lodIndices.insert( modelData.lodIndices.end(), simplified.begin(), simplified.end() );
+		previous.swap( simplified );
+	}
+}
+
+std::vector<uint32_t> MeshSimplifier::Simplify( const std::vector<Model::Vertex>& vertices, const std::vector<uint32_t>& indices,
+	size_t targetIndexCount, float& resultError )
+{
+	resultError = 0.f;
+
+	//Vertices on the same position become one, the wedges of a position are its original vertices
+	std::vector<uint32_t> remap( vertices.size() );
+	std::vector<glm::vec3> positions;
+	{
+		std::unordered_map<PositionKey, uint32_t, PositionKeyHash> positionIds;
+		for ( uint32_t vertex = 0; vertex < vertices.size(); vertex++ )
+		{
+			PositionKey key;
+			std::memcpy( key.bits, &vertices[ vertex ].position, sizeof( key.bits ) );
+			auto [ it, inserted ] = positionIds.emplace( key, static_cast< uint32_t >( positions.size() ) );
+			if ( inserted )
+			{
+				positions.push_back( vertices[ vertex ].position );
+			}
+			remap[ vertex ] = it->second;
+		}
+	}
+	const size_t positionCount = positions.size();
+
+	//Triangles on positions, corners holds the wedge every corner of the triangle uses
+	std::vector<std::array<uint32_t, 3>> triangles;
+	std::vector<std::array<uint32_t, 3>> corners;
+	for ( size_t i = 0; i + 2 < indices.size(); i += 3 )
+	{
+		const std::array<uint32_t, 3> triangle = { remap[ indices[ i ] ], remap[ indices[ i + 1 ] ], remap[ indices[ i + 2 ] ] };
+		if ( triangle[ 0 ] != triangle[ 1 ] && triangle[ 1 ] != triangle[ 2 ] && triangle[ 0 ] != triangle[ 2 ] )
+		{
+			triangles.push_back( triangle );
+			corners.push_back( { indices[ i ], indices[ i + 1 ], indices[ i + 2 ] } );
+		}
+	}
+
+	//Edges used by a single triangle are the open border, their ends stay where they are
+	std::vector<uint8_t> locked( positionCount, 0 );
+	{
+		std::unordered_map<uint64_t, uint32_t> edgeUses;
+		for ( const auto& triangle : triangles )
+		{
+			for ( int k = 0; k < 3; k++ )
+			{
+				edgeUses[ EdgeKey( triangle[ k ], triangle[ ( k + 1 ) % 3 ] ) ]++;
+			}
+		}
+		for ( const auto& [ edge, uses ] : edgeUses )
+		{
+			if ( uses == 1 )
+			{
+				locked[ edge >> 32 ] = 1;
+				locked[ edge & 0xffffffffu ] = 1;
+			}
+		}
+	}
+
+	//The quadric cost orders the collapses but is an area weighted squared mean, the reported error is the largest
+	//plain distance of a moved position to the input planes it has absorbed, kept as a sorted list per position
+	std::vector<Quadric> quadrics( positionCount );
+	std::vector<glm::vec4> planes;
+	std::vector<std::vector<uint32_t>> positionPlanes( positionCount );
+	for ( const auto& triangle : triangles )
+	{
+		const glm::vec3& a = positions[ triangle[ 0 ] ];
+		const glm::vec3 normal = glm::cross( positions[ triangle[ 1 ] ] - a, positions[ triangle[ 2 ] ] - a );
+		const float area = glm::length( normal );
+		if ( area <= 0.f )
+		{
+			continue;
+		}
+
+		const glm::vec3 unitNormal = normal / area;
+		const Quadric quadric = Quadric::FromPlane( unitNormal, -glm::dot( unitNormal, a ), area * 0.5 );
+		for ( uint32_t position : triangle )
+		{
+			quadrics[ position ] += quadric;
+			positionPlanes[ position ].push_back( static_cast< uint32_t >( planes.size() ) );
+		}
+		planes.push_back( glm::vec4{ unitNormal, -glm::dot( unitNormal, a ) } );
+	}
+
+	//Passes of independent collapses, cheapest first, until the target or nothing can collapse anymore
+	const size_t targetTriangles = targetIndexCount / 3;
+	std::vector<Collapse> collapses;
+	std::vector<uint32_t> adjacencyOffsets( positionCount + 1 );
+	std::vector<uint32_t> adjacency;
+	std::vector<uint8_t> touched( positionCount );
+	std::vector<uint32_t> collapseTo( positionCount );
+	//Wedge of the target every wedge of a collapsed position moves to, and the pairs of the collapse being checked
+	std::vector<uint32_t> wedgeTo( vertices.size() );
+	std::vector<std::pair<uint32_t, uint32_t>> wedgePairs;
+	std::vector<uint32_t> mergedPlanes;
+
+	while ( triangles.size() > targetTriangles )
+	{
+		std::fill( adjacencyOffsets.begin(), adjacencyOffsets.end(), 0u );
+		for ( const auto& triangle : triangles )
+		{
+			for ( uint32_t position : triangle )
+			{
+				adjacencyOffsets[ position + 1 ]++;
+			}
+		}
+		for ( size_t position = 0; position < positionCount; position++ )
+		{
+			adjacencyOffsets[ position + 1 ] += adjacencyOffsets[ position ];
+		}
+		adjacency.resize( triangles.size() * 3 );
+		{
+			std::vector<uint32_t> fill( adjacencyOffsets.begin(), adjacencyOffsets.end() - 1 );
+			for ( uint32_t triangle = 0; triangle < triangles.size(); triangle++ )
+			{
+				for ( uint32_t position : triangles[ triangle ] )
+				{
+					adjacency[ fill[ position ]++ ] = triangle;
+				}
+			}
+		}
+
+		collapses.clear();
+		for ( const auto& triangle : triangles )
+		{
+			for ( int k = 0; k < 3; k++ )
+			{
+				const uint32_t from = triangle[ k ];
+				const uint32_t to = triangle[ ( k + 1 ) % 3 ];
+				for ( const auto& [ a, b ] : { std::pair{ from, to }, std::pair{ to, from } } )
+				{
+					if ( locked[ a ] )
+					{
+						continue;
+					}
+					Quadric merged = quadrics[ a ];
+					merged += quadrics[ b ];
+					collapses.push_back( { a, b, merged.Evaluate( positions[ b ] ) } );
+				}
+			}
+		}
+		std::sort( collapses.begin(), collapses.end(),
+			[]( const Collapse& a, const Collapse& b ) { return a.cost < b.cost; } );
+
+		std::fill( touched.begin(), touched.end(), uint8_t( 0 ) );
+		for ( size_t position = 0; position < positionCount; position++ )
+		{
+			collapseTo[ position ] = static_cast< uint32_t >( position );
+		}
+
+		size_t remainingTriangles = triangles.size();
+		size_t collapseCount = 0;
+		for ( const Collapse& collapse : collapses )
+		{
+			if ( remainingTriangles <= targetTriangles )
+			{
+				break;
+			}
+			if ( touched[ collapse.from ] || touched[ collapse.to ] )
+			{
+				continue;
+			}
+
+			//The triangles on the collapsed edge disappear, across them every wedge of from meets the wedge of to
+			//it turns into. A wedge meeting two different ones would merge a seam that doesn't end here
+			bool rejected = false;
+			size_t removed = 0;
+			wedgePairs.clear();
+			for ( uint32_t i = adjacencyOffsets[ collapse.from ]; i < adjacencyOffsets[ collapse.from + 1 ] && !rejected; i++ )
+			{
+				const auto& triangle = triangles[ adjacency[ i ] ];
+				const auto toCorner = std::find( triangle.begin(), triangle.end(), collapse.to );
+				if ( toCorner == triangle.end() )
+				{
+					continue;
+				}
+
+				const auto& wedges = corners[ adjacency[ i ] ];
+				const uint32_t fromWedge = wedges[ std::find( triangle.begin(), triangle.end(), collapse.from ) - triangle.begin() ];
+				const uint32_t toWedge = wedges[ toCorner - triangle.begin() ];
+				const auto known = std::find_if( wedgePairs.begin(), wedgePairs.end(),
+					[ & ]( const auto& pair ) { return pair.first == fromWedge; } );
+				if ( known == wedgePairs.end() )
+				{
+					wedgePairs.push_back( { fromWedge, toWedge } );
+				}
+				else
+				{
+					rejected = known->second != toWedge;
+				}
+				removed++;
+			}
+
+			//Triangles around from that don't contain to move with it, none of them may flip and each needs a wedge
+			//that crosses the collapsed edge, a seam through from that doesn't run along the edge stays put
+			for ( uint32_t i = adjacencyOffsets[ collapse.from ]; i < adjacencyOffsets[ collapse.from + 1 ] && !rejected; i++ )
+			{
+				const auto& triangle = triangles[ adjacency[ i ] ];
+				if ( triangle[ 0 ] == collapse.to || triangle[ 1 ] == collapse.to || triangle[ 2 ] == collapse.to )
+				{
+					continue;
+				}
+
+				const uint32_t fromWedge = corners[ adjacency[ i ] ][ std::find( triangle.begin(), triangle.end(), collapse.from ) - triangle.begin() ];
+				if ( std::none_of( wedgePairs.begin(), wedgePairs.end(), [ & ]( const auto& pair ) { return pair.first == fromWedge; } ) )
+				{
+					rejected = true;
+					break;
+				}
+
+				std::array<glm::vec3, 3> points;
+				std::array<glm::vec3, 3> moved;
+				for ( int k = 0; k < 3; k++ )
+				{
+					points[ k ] = positions[ triangle[ k ] ];
+					moved[ k ] = triangle[ k ] == collapse.from ? positions[ collapse.to ] : points[ k ];
+				}
+				const glm::vec3 before = glm::cross( points[ 1 ] - points[ 0 ], points[ 2 ] - points[ 0 ] );
+				const glm::vec3 after = glm::cross( moved[ 1 ] - moved[ 0 ], moved[ 2 ] - moved[ 0 ] );
+				rejected = glm::dot( before, after ) <= 0.f;
+			}
+			if ( rejected )
+			{
+				continue;
+			}
+
+			//The one ring of from changes shape, nothing in it collapses again this pass
+			for ( uint32_t i = adjacencyOffsets[ collapse.from ]; i < adjacencyOffsets[ collapse.from + 1 ]; i++ )
+			{
+				for ( uint32_t position : triangles[ adjacency[ i ] ] )
+				{
+					touched[ position ] = 1;
+				}
+			}
+
+			collapseTo[ collapse.from ] = collapse.to;
+			for ( const auto& [ fromWedge, toWedge ] : wedgePairs )
+			{
+				wedgeTo[ fromWedge ] = toWedge;
+			}
+			quadrics[ collapse.to ] += quadrics[ collapse.from ];
+
+			//To never moved, only the planes that were around from can be away from it
+			const glm::vec4 target{ positions[ collapse.to ], 1.f };
+			for ( uint32_t plane : positionPlanes[ collapse.from ] )
+			{
+				resultError = std::max( resultError, std::abs( glm::dot( planes[ plane ], target ) ) );
+			}
+			std::vector<uint32_t>& toPlanes = positionPlanes[ collapse.to ];
+			mergedPlanes.clear();
+			std::set_union( toPlanes.begin(), toPlanes.end(), positionPlanes[ collapse.from ].begin(), positionPlanes[ collapse.from ].end(),
+				std::back_inserter( mergedPlanes ) );
+			toPlanes.swap( mergedPlanes );
+			std::vector<uint32_t>().swap( positionPlanes[ collapse.from ] );
+			remainingTriangles -= removed;
+			collapseCount++;
+		}
+
+		if ( collapseCount == 0 )
+		{
+			break;
+		}
+
+		size_t kept = 0;
+		for ( size_t triangle = 0; triangle < triangles.size(); triangle++ )
+		{
+			std::array<uint32_t, 3> collapsed = triangles[ triangle ];
+			std::array<uint32_t, 3> wedges = corners[ triangle ];
+			for ( int k = 0; k < 3; k++ )
+			{
+				if ( collapseTo[ collapsed[ k ] ] != collapsed[ k ] )
+				{
+					collapsed[ k ] = collapseTo[ collapsed[ k ] ];
+					wedges[ k ] = wedgeTo[ wedges[ k ] ];
+				}
+			}
+			if ( collapsed[ 0 ] != collapsed[ 1 ] && collapsed[ 1 ] != collapsed[ 2 ] && collapsed[ 0 ] != collapsed[ 2 ] )
+			{
+				triangles[ kept ] = collapsed;
+				corners[ kept ] = wedges;
+				kept++;
+			}
+		}
+		triangles.resize( kept );
+		corners.resize( kept );
+	}
+
+	std::vector<uint32_t> result;
+	result.reserve( corners.size() * 3 );
+	for ( const auto& wedges : corners )
+	{
+		result.insert( result.end(), wedges.begin(), wedges.end() );
+	}
+	return result;
+}
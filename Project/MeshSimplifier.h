@@ -0,0 +1,27 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "Model.h"
+
+//Quadric error metric edge collapse (Garland/Heckbert), only moving vertices onto existing ones,
+//so every level is a new index list over the same vertex buffer.
+//Vertices that share a position are simplified as one, every corner keeps track of which of them (wedges) it uses.
+//A collapse carries each wedge of the moved position onto the wedge of the target it shares a triangle with on
+//the collapsed edge, so a position on a uv or normal seam only slides along the seam and the seam survives.
+//Open borders never move.
+class MeshSimplifier
+{
+public:
+	//Each level aims for this fraction of the previous level's triangles
+	static constexpr float LOD_TRIANGLE_RATIO = 0.5f;
+	//A level that keeps more than this fraction of the previous one's triangles isn't worth storing
+	static constexpr float MIN_LOD_REDUCTION = 0.8f;
+
+	//Fills modelData.lods and modelData.lodIndices from vertices and indices, up to Model::MAX_LODS levels
+	static void BuildLods( Model::ModelData& modelData );
+
+	//Index list of at most targetIndexCount indices if the mesh allows it.
+	//resultError is the largest distance of a kept vertex to the plane of any input triangle collapsed onto it, in mesh units
+	static std::vector<uint32_t> Simplify( const std::vector<Model::Vertex>& vertices, const std::vector<uint32_t>& indices,
+		size_t targetIndexCount, float& resultError );
+};
@@ -0,0 +1,244 @@
+#include "MeshletBuilder.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+
+void MeshletBuilder::Build( Model::ModelData& modelData )
+{
+	modelData.meshlets = Build( modelData.vertices, modelData.indices );
+}
+
+std::vector<Model::Meshlet> MeshletBuilder::Build( const std::vector<Model::Vertex>& vertices, std::vector<uint32_t>& indices )
+{
+	std::vector<Model::Meshlet> meshlets;
+	const size_t triangleCount = indices.size() / 3;
+	if ( triangleCount == 0 )
+	{
+		return meshlets;
+	}
+
+	//Triangles around every vertex
+	std::vector<uint32_t> adjacencyOffsets( vertices.size() + 1, 0 );
+	for ( size_t i = 0; i < triangleCount * 3; i++ )
+	{
+		adjacencyOffsets[ indices[ i ] + 1 ]++;
+	}
+	for ( size_t vertex = 0; vertex < vertices.size(); vertex++ )
+	{
+		adjacencyOffsets[ vertex + 1 ] += adjacencyOffsets[ vertex ];
+	}
+	std::vector<uint32_t> adjacency( triangleCount * 3 );
+	std::vector<uint32_t> adjacencyFill( adjacencyOffsets.begin(), adjacencyOffsets.end() - 1 );
+	for ( size_t i = 0; i < triangleCount * 3; i++ )
+	{
+		adjacency[ adjacencyFill[ indices[ i ] ]++ ] = static_cast< uint32_t >( i / 3 );
+	}
+
+	std::vector<glm::vec3> triangleNormals( triangleCount );
+	for ( size_t triangle = 0; triangle < triangleCount; triangle++ )
+	{
+		const glm::vec3& p0 = vertices[ indices[ triangle * 3 ] ].position;
+		const glm::vec3 normal = glm::cross( vertices[ indices[ triangle * 3 + 1 ] ].position - p0,
+			vertices[ indices[ triangle * 3 + 2 ] ].position - p0 );
+		const float length = glm::length( normal );
+		triangleNormals[ triangle ] = length > 0.f ? normal / length : glm::vec3{ 0.f };
+	}
+
+	//Meshlet that last used each vertex, so counting a triangle's new vertices needs no set
+	constexpr uint32_t NONE = ~0u;
+	std::vector<uint32_t> vertexMeshlet( vertices.size(), NONE );
+	std::vector<uint32_t> meshletVertices;
+	std::vector<bool> emitted( triangleCount, false );
+	std::vector<uint32_t> reordered;
+	reordered.reserve( indices.size() );
+
+	uint32_t meshletIndex = 0;
+	glm::vec3 normalSum{ 0.f };
+	Model::Meshlet meshlet{};
+	size_t seed = 0;
+
+	auto countNewVertices = [ & ]( uint32_t triangle )
+	{
+		const uint32_t a = indices[ triangle * 3 ];
+		const uint32_t b = indices[ triangle * 3 + 1 ];
+		const uint32_t c = indices[ triangle * 3 + 2 ];
+		return uint32_t( vertexMeshlet[ a ] != meshletIndex ) +
+			uint32_t( vertexMeshlet[ b ] != meshletIndex && b != a ) +
+			uint32_t( vertexMeshlet[ c ] != meshletIndex && c != a && c != b );
+	};
+	auto fits = [ & ]( uint32_t triangle )
+	{
+		return meshletVertices.size() + countNewVertices( triangle ) <= MAX_VERTICES && meshlet.indexCount / 3 < MAX_TRIANGLES;
+	};
+	auto closeMeshlet = [ & ]()
+	{
+		ComputeBounds( vertices, reordered, meshlet );
+		meshlets.push_back( meshlet );
+
+		meshlet = Model::Meshlet{};
+		meshlet.firstIndex = static_cast< uint32_t >( reordered.size() );
+		meshletIndex++;
+		meshletVertices.clear();
+		normalSum = glm::vec3{ 0.f };
+	};
+
+	for ( size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++ )
+	{
+		//Fewest new vertices first, then the triangle facing closest to the meshlet so far
+		uint32_t best = NONE;
+		uint32_t bestNewVertices = 4;
+		float bestFacing = -2.f;
+		for ( uint32_t vertex : meshletVertices )
+		{
+			for ( uint32_t i = adjacencyOffsets[ vertex ]; i < adjacencyOffsets[ vertex + 1 ]; i++ )
+			{
+				const uint32_t triangle = adjacency[ i ];
+				if ( emitted[ triangle ] ) continue;
+
+				const uint32_t newVertices = countNewVertices( triangle );
+				const float facing = glm::dot( triangleNormals[ triangle ], normalSum );
+				if ( newVertices < bestNewVertices || ( newVertices == bestNewVertices && facing > bestFacing ) )
+				{
+					best = triangle;
+					bestNewVertices = newVertices;
+					bestFacing = facing;
+				}
+			}
+		}
+
+		if ( best != NONE && !fits( best ) )
+		{
+			closeMeshlet();
+			best = NONE;
+		}
+
+		//Nothing connected left, continue from the next triangle in the incoming (cache optimized) order
+		if ( best == NONE )
+		{
+			while ( emitted[ seed ] )
+			{
+				seed++;
+			}
+			best = static_cast< uint32_t >( seed );
+			if ( !fits( best ) )
+			{
+				closeMeshlet();
+			}
+		}
+
+		emitted[ best ] = true;
+		for ( uint32_t corner = 0; corner < 3; corner++ )
+		{
+			const uint32_t vertex = indices[ best * 3 + corner ];
+			if ( vertexMeshlet[ vertex ] != meshletIndex )
+			{
+				vertexMeshlet[ vertex ] = meshletIndex;
+				meshletVertices.push_back( vertex );
+			}
+			reordered.push_back( vertex );
+		}
+		normalSum += triangleNormals[ best ];
+		meshlet.indexCount += 3;
+	}
+
+	ComputeBounds( vertices, reordered, meshlet );
+	meshlets.push_back( meshlet );
+
+	//Growing by adjacency loses the incoming cache order, restore it inside every meshlet on local indices
+	std::vector<uint32_t> localIndices;
+	for ( const Model::Meshlet& cluster : meshlets )
+	{
+		const auto first = reordered.begin() + cluster.firstIndex;
+		const auto last = first + cluster.indexCount;
+		std::vector<uint32_t> localVertices;
+		localIndices.clear();
+		for ( auto index = first; index != last; ++index )
+		{
+			auto local = std::find( localVertices.begin(), localVertices.end(), *index );
+			if ( local == localVertices.end() )
+			{
+				local = localVertices.insert( local, *index );
+			}
+			localIndices.push_back( static_cast< uint32_t >( local - localVertices.begin() ) );
+		}
+
+		MeshOptimizer::OptimizeVertexCache( localIndices, localVertices.size() );
+		std::transform( localIndices.begin(), localIndices.end(), first,
+			[ & ]( uint32_t local ) { return localVertices[ local ]; } );
+	}
+
+	//A trailing partial triangle stays where it was, outside every meshlet
+	reordered.insert( reordered.end(), indices.begin() + triangleCount * 3, indices.end() );
+	indices.swap( reordered );
+	return meshlets;
+}
+
+void MeshletBuilder::ComputeBounds( const std::vector<Model::Vertex>& vertices, const std::vector<uint32_t>& indices,
+	Model::Meshlet& meshlet )
+{
+	const uint32_t lastIndex = meshlet.firstIndex + meshlet.indexCount;
+
+	glm::vec3 min{ vertices[ indices[ meshlet.firstIndex ] ].position };
+	glm::vec3 max{ min };
+	for ( uint32_t i = meshlet.firstIndex; i < lastIndex; i++ )
+	{
+		min = glm::min( min, vertices[ indices[ i ] ].position );
+		max = glm::max( max, vertices[ indices[ i ] ].position );
+	}
+
+	meshlet.center = ( min + max ) * 0.5f;
+	float radiusSquared = 0.f;
+	for ( uint32_t i = meshlet.firstIndex; i < lastIndex; i++ )
+	{
+		const glm::vec3 offset = vertices[ indices[ i ] ].position - meshlet.center;
+		radiusSquared = std::max( radiusSquared, glm::dot( offset, offset ) );
+	}
+	meshlet.radius = std::sqrt( radiusSquared );
+
+	//Geometric normals from the winding, the vertex normals can be smoothed across the silhouette.
+	//LoadModel mirrors y without reversing the winding, so the outward normal is ( p2 - p0 ) x ( p1 - p0 )
+	std::vector<glm::vec3> normals;
+	normals.reserve( meshlet.indexCount / 3 );
+	glm::vec3 axis{ 0.f };
+	for ( uint32_t i = meshlet.firstIndex; i < lastIndex; i += 3 )
+	{
+		const glm::vec3& p0 = vertices[ indices[ i ] ].position;
+		const glm::vec3 normal = glm::cross( vertices[ indices[ i + 2 ] ].position - p0, vertices[ indices[ i + 1 ] ].position - p0 );
+		const float length = glm::length( normal );
+		if ( length > 0.f )
+		{
+			normals.push_back( normal / length );
+			axis += normals.back();
+		}
+	}
+
+	meshlet.coneCutoff = 1.f;
+	const float axisLength = glm::length( axis );
+	if ( normals.empty() || axisLength <= 0.f )
+	{
+		return;
+	}
+	meshlet.coneAxis = axis / axisLength;
+
+	float minDot = 1.f;
+	for ( const glm::vec3& normal : normals )
+	{
+		minDot = std::min( minDot, glm::dot( normal, meshlet.coneAxis ) );
+	}
+
+	if ( minDot > MIN_CONE_DOT )
+	{
+		meshlet.coneCutoff = std::sqrt( 1.f - minDot * minDot );
+	}
+}
+
+bool MeshletBuilder::IsBackFacing( const Model::Meshlet& meshlet, const glm::vec3& cameraPosition )
+{
+	if ( meshlet.coneCutoff >= 1.f )
+	{
+		return false;
+	}
+
+	const glm::vec3 toCluster = meshlet.center - cameraPosition;
+	return glm::dot( toCluster, meshlet.coneAxis ) >= meshlet.coneCutoff * glm::length( toCluster ) + meshlet.radius;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "Model.h"
+
+//Cuts an index list into meshlets for cluster culling. A meshlet grows through the triangles that share
+//the most of its vertices, preferring the ones facing its way, so it stays compact and its normal cone narrow.
+//The triangles are reordered so every meshlet is a contiguous index range that one indexed indirect draw covers.
+class MeshletBuilder
+{
+public:
+	//The sizes mesh shader hardware is tuned for, kept so the clusters could feed a mesh shader unchanged
+	static constexpr uint32_t MAX_VERTICES = 64;
+	static constexpr uint32_t MAX_TRIANGLES = 124;
+	//Meshlets whose triangles spread wider than this (cosine to the axis) never get cone culled
+	static constexpr float MIN_CONE_DOT = 0.1f;
+
+	//Fills modelData.meshlets and reorders modelData.indices into meshlet order
+	static void Build( Model::ModelData& modelData );
+	static std::vector<Model::Meshlet> Build( const std::vector<Model::Vertex>& vertices, std::vector<uint32_t>& indices );
+
+	//The cone test cullObjects.comp runs, in mesh space: true when the camera sees the back of every triangle
+	//of the meshlet from anywhere in its bounding sphere
+	static bool IsBackFacing( const Model::Meshlet& meshlet, const glm::vec3& cameraPosition );
+
+private:
+	//Bounding sphere and normal cone of indices[ firstIndex, firstIndex + indexCount )
+	static void ComputeBounds( const std::vector<Model::Vertex>& vertices, const std::vector<uint32_t>& indices,
+		Model::Meshlet& meshlet );
+};
@@ -7,9 +7,18 @@
 #define GLM_ENABLE_EXPERIMENTAL //is it still so experimental?
 #include <glm/gtx/hash.hpp>
 #include <unordered_map>
+#include <filesystem>
 #include "stb_image.h"
 #include "Buffer.h"
 #include "json.hpp"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "MeshletBuilder.h"
+#include <glm/gtc/packing.hpp>
+#include <type_traits>
+#include <algorithm>
+#include <cmath>
 
 using json = nlohmann::json;
 
@@ -27,15 +36,86 @@ namespace std
 }
 
 Model::Model( EngineDevice& device,
-	const Model::ModelData& modelData )
+	const Model::ModelData& modelData, VertexLayout layout, bool splitLargeMeshes )
 	: m_Device( device )
+	, m_VertexLayout( layout )
 {
 	m_ModelData = modelData;
-	CreateVertexBuffer( m_ModelData.vertices );
-	CreateIndexBuffer( m_ModelData.indices );
+	ComputeBoundingBox( m_ModelData.vertices );
+
+	//Every lod lives in the one index buffer, LOD 0 first
+	std::vector<LodRange> lodRanges = m_ModelData.lods;
+	if ( lodRanges.empty() )
+	{
+		lodRanges.push_back( { 0, static_cast< uint32_t >( m_ModelData.indices.size() ), 0.f } );
+	}
+	std::vector<uint32_t> allIndices;
+	allIndices.reserve( m_ModelData.indices.size() + m_ModelData.lodIndices.size() );
+	allIndices.insert( allIndices.end(), m_ModelData.indices.begin(), m_ModelData.indices.end() );
+	allIndices.insert( allIndices.end(), m_ModelData.lodIndices.begin(), m_ModelData.lodIndices.end() );
+
+	const std::vector<Vertex>* vertices = &m_ModelData.vertices;
+	const std::vector<uint32_t>* indices = &allIndices;
+	std::vector<Vertex> splitVertices;
+	std::vector<uint32_t> splitIndices;
+	std::vector<uint32_t> splitSources;
+	VertexRuns lod0Runs;
+
+	const bool fitsUint16 = vertices->size() <= MAX_UINT16_VERTICES;
+	const bool split = !fitsUint16 && splitLargeMeshes && !allIndices.empty();
+	m_IndexType = fitsUint16 || split ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+
+	for ( const LodRange& range : lodRanges )
+	{
+		Lod lod{};
+		lod.firstSubmesh = static_cast< uint32_t >( m_Submeshes.size() );
+		lod.error = range.error;
+		//Lower lods reuse the vertices LOD 0 was split into, they only use a subset of them
+		if ( split && m_Lods.empty() )
+		{
+			SplitSubmeshes( m_ModelData.vertices, allIndices.data() + range.firstIndex, range.indexCount,
+				splitVertices, splitIndices, splitSources );
+			if ( lodRanges.size() > 1 )
+			{
+				lod0Runs = MapVertexRuns( m_ModelData.vertices.size(), splitSources );
+			}
+		}
+		else if ( split )
+		{
+			SplitIntoVertexRuns( m_ModelData.vertices, allIndices.data() + range.firstIndex, range.indexCount,
+				lod0Runs, splitVertices, splitIndices, splitSources );
+		}
+		else
+		{
+			m_Submeshes.push_back( { range.firstIndex, range.indexCount, 0 } );
+		}
+		lod.submeshCount = static_cast< uint32_t >( m_Submeshes.size() ) - lod.firstSubmesh;
+		m_Lods.push_back( lod );
+	}
+
+	if ( split )
+	{
+		vertices = &splitVertices;
+		indices = &splitIndices;
+	}
+
+	switch ( m_VertexLayout )
+	{
+	case VertexLayout::Compact:
+		CreateVertexBuffer<CompactVertex>( *vertices );
+		break;
+	default:
+		CreateVertexBuffer<Vertex>( *vertices );
+		break;
+	}
+	CreateIndexBuffer( *indices );
 }
 
-Model::~Model(){}
+Model::~Model()
+{
+	//The copies into our buffers may still be pending
+	m_Device.GetUploadQueue().Wait( m_UploadTicket );
+}
 
 void Model::Bind( VkCommandBuffer commandBuffer )
 {
@@ -46,38 +126,33 @@ void Model::Bind( VkCommandBuffer commandBuffer )
 	if( m_HasIndexBuffer )
 	{
 		vkCmdBindIndexBuffer( commandBuffer,
-			m_IndexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+			m_IndexBuffer->getBuffer(), 0, m_IndexType );
 	}
 }
 
-std::unique_ptr<Model> Model::CreateModelFromFile( EngineDevice& device, const std::string& filename )
+std::unique_ptr<Model> Model::CreateModelFromFile( EngineDevice& device, const std::string& filename, VertexLayout layout )
 {
 	ModelData modelData;
-
-	std::string extension = std::filesystem::path( filename ).extension().string();
-	if ( extension == ".obj" ) {
-		modelData.LoadModel( filename );
-	}
-	else if ( extension == ".json" ) {
-		modelData.LoadJSON( filename );
-	}
-	else {
-		throw std::runtime_error( "Unsupported file format: " + extension );
-	}
-	return std::make_unique<Model>( device, modelData );
+	modelData.LoadFromFile( filename );
+	return std::make_unique<Model>( device, modelData, layout );
 }
 
-void Model::Draw( VkCommandBuffer commandBuffer )
+uint32_t Model::Draw( VkCommandBuffer commandBuffer, uint32_t instanceCount, uint32_t firstInstance, uint32_t lod )
 {
-	if ( m_HasIndexBuffer )
+	if ( !m_HasIndexBuffer )
 	{
-		vkCmdDrawIndexed( commandBuffer, m_IndexCount,
-			1, 0, 0, 0 );
+		vkCmdDraw( commandBuffer, m_VertexCount, instanceCount, 0, firstInstance );
+		return 1;
 	}
-	else 
+
+	const Lod& range = m_Lods[ std::min( lod, GetLodCount() - 1 ) ];
+	for ( uint32_t i = range.firstSubmesh; i < range.firstSubmesh + range.submeshCount; i++ )
 	{
-		vkCmdDraw( commandBuffer, m_VertexCount, 1, 0, 0 );
+		const Submesh& submesh = m_Submeshes[ i ];
+		vkCmdDrawIndexed( commandBuffer, submesh.indexCount,
+			instanceCount, submesh.firstIndex, submesh.vertexOffset, firstInstance );
 	}
+	return range.submeshCount;
 }
 
 Model::ModelData Model::GetModelData() const
@@ -85,21 +160,44 @@ Model::ModelData Model::GetModelData() const
 	return m_ModelData;
 }
 
+void Model::ComputeBoundingBox( const std::vector<Vertex>& vertices )
+{
+	if ( vertices.empty() ) return;
+
+	m_BoundingBox.min = vertices[ 0 ].position;
+	m_BoundingBox.max = vertices[ 0 ].position;
+	for ( const auto& vertex : vertices )
+	{
+		m_BoundingBox.min = glm::min( m_BoundingBox.min, vertex.position );
+		m_BoundingBox.max = glm::max( m_BoundingBox.max, vertex.position );
+	}
+
+	//Flat meshes still need a non zero scale on their flat axis
+	m_Quantization.offset = m_BoundingBox.GetCenter();
+	m_Quantization.scale = glm::max( m_BoundingBox.GetExtent(), glm::vec3( 1e-6f ) );
+}
+
+template<typename VertexType>
 void Model::CreateVertexBuffer( const std::vector<Vertex>& vertices )
 {
 	m_VertexCount = static_cast< uint32_t >( vertices.size() );
 	assert( m_VertexCount >= 3 && "Vertex count must be at least 3 for a triangle" );
-	VkDeviceSize bufferSize = sizeof( vertices[ 0 ] ) * m_VertexCount;
 
-	uint32_t vertexSize = sizeof( vertices[ 0 ] );
-
-	Buffer stagingBuffer( m_Device, vertexSize, m_VertexCount,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-		VK_MEMORY_PROPERTY_HOST_COHERENT_BIT );
+	//The upload copies into staging right away, so the encoded vector can be a temporary
+	const void* data = vertices.data();
+	std::vector<VertexType> encoded;
+	if constexpr ( !std::is_same_v<VertexType, Vertex> )
+	{
+		encoded.reserve( vertices.size() );
+		for ( const Vertex& vertex : vertices )
+		{
+			encoded.push_back( VertexType::Encode( vertex, m_Quantization ) );
+		}
+		data = encoded.data();
+	}
 
-	stagingBuffer.map();
-	stagingBuffer.writeToBuffer( (void*) vertices.data() );
+	uint32_t vertexSize = sizeof( VertexType );
+	m_VertexBufferSize = static_cast< VkDeviceSize >( vertexSize ) * m_VertexCount;
 
 	m_VertexBuffer = std::make_unique<Buffer>
 		( m_Device, vertexSize, m_VertexCount,
@@ -107,8 +205,8 @@ void Model::CreateVertexBuffer( const std::vector<Vertex>& vertices )
 			VK_BUFFER_USAGE_TRANSFER_DST_BIT,
 				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT );
 
-	m_Device.CopyBuffer( stagingBuffer.getBuffer(),
-		m_VertexBuffer->getBuffer(), bufferSize);
+	m_UploadTicket = m_Device.GetUploadQueue().Upload(
+		m_VertexBuffer->getBuffer(), data, m_VertexBufferSize );
 }
 
 void Model::CreateIndexBuffer( const std::vector<uint32_t>& indices )
@@ -121,17 +219,18 @@ void Model::CreateIndexBuffer( const std::vector<uint32_t>& indices )
 		return;
 	}
 
-	VkDeviceSize bufferSize = sizeof( indices[ 0 ] ) * m_IndexCount;
-
-	uint32_t indexSize = sizeof( indices[ 0 ] );
-
-	Buffer stagingBuffer( m_Device, indexSize, m_IndexCount,
-				VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-			VK_MEMORY_PROPERTY_HOST_COHERENT_BIT );
+	//Same as with the vertices, the upload copies right away so the narrowed copy can be a temporary
+	const void* data = indices.data();
+	std::vector<uint16_t> narrowIndices;
+	uint32_t indexSize = sizeof( uint32_t );
+	if ( m_IndexType == VK_INDEX_TYPE_UINT16 )
+	{
+		narrowIndices.assign( indices.begin(), indices.end() );
+		data = narrowIndices.data();
+		indexSize = sizeof( uint16_t );
+	}
 
-	stagingBuffer.map();
-	stagingBuffer.writeToBuffer( (void*) indices.data() );
+	m_IndexBufferSize = static_cast< VkDeviceSize >( indexSize ) * m_IndexCount;
 
 	m_IndexBuffer = std::make_unique<Buffer>
 		( m_Device, indexSize, m_IndexCount,
@@ -139,45 +238,226 @@ void Model::CreateIndexBuffer( const std::vector<uint32_t>& indices )
 					VK_BUFFER_USAGE_TRANSFER_DST_BIT,
 							VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT );
 
-	m_Device.CopyBuffer( stagingBuffer.getBuffer(),
-		m_IndexBuffer->getBuffer(), bufferSize);
+	m_UploadTicket = m_Device.GetUploadQueue().Upload(
+		m_IndexBuffer->getBuffer(), data, m_IndexBufferSize );
 }
 
-std::vector<VkVertexInputBindingDescription> 
-Model::Vertex::GetBindingDescriptions()
+void Model::SplitSubmeshes( const std::vector<Vertex>& vertices, const uint32_t* indices, size_t indexCount,
+	std::vector<Vertex>& splitVertices, std::vector<uint32_t>& splitIndices, std::vector<uint32_t>& splitSources )
 {
-	std::vector<VkVertexInputBindingDescription> 
-		bindingDescriptions( 1 );
-	bindingDescriptions[ 0 ].binding = 0;
-	bindingDescriptions[ 0 ].stride = sizeof( Vertex );
-	bindingDescriptions[ 0 ].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-	return bindingDescriptions;
+	constexpr uint32_t UNASSIGNED = ~0u;
+
+	//Vertex -> index inside the current submesh, reset for the vertices it used when a new one starts
+	std::vector<uint32_t> localIndices( vertices.size(), UNASSIGNED );
+	std::vector<uint32_t> usedVertices;
+
+	auto startSubmesh = [ & ]()
+		{
+			for ( uint32_t vertex : usedVertices )
+			{
+				localIndices[ vertex ] = UNASSIGNED;
+			}
+			usedVertices.clear();
+
+			Submesh submesh{};
+			submesh.firstIndex = static_cast< uint32_t >( splitIndices.size() );
+			submesh.vertexOffset = static_cast< int32_t >( splitVertices.size() );
+			m_Submeshes.push_back( submesh );
+		};
+
+	startSubmesh();
+	for ( size_t triangle = 0; triangle + 2 < indexCount; triangle += 3 )
+	{
+		const uint32_t* corners = &indices[ triangle ];
+
+		uint32_t newVertices = 0;
+		for ( int i = 0; i < 3; i++ )
+		{
+			const bool repeated = ( i > 0 && corners[ i ] == corners[ 0 ] ) || ( i > 1 && corners[ i ] == corners[ 1 ] );
+			newVertices += !repeated && localIndices[ corners[ i ] ] == UNASSIGNED;
+		}
+
+		if ( usedVertices.size() + newVertices > MAX_UINT16_VERTICES )
+		{
+			startSubmesh();
+		}
+
+		for ( int i = 0; i < 3; i++ )
+		{
+			uint32_t& localIndex = localIndices[ corners[ i ] ];
+			if ( localIndex == UNASSIGNED )
+			{
+				localIndex = static_cast< uint32_t >( usedVertices.size() );
+				usedVertices.push_back( corners[ i ] );
+				splitVertices.push_back( vertices[ corners[ i ] ] );
+				splitSources.push_back( corners[ i ] );
+			}
+			splitIndices.push_back( localIndex );
+		}
+		m_Submeshes.back().indexCount += 3;
+	}
 }
 
-std::vector<VkVertexInputAttributeDescription> 
-Model::Vertex::GetAttributeDescriptions()
+Model::VertexRuns Model::MapVertexRuns( size_t vertexCount, const std::vector<uint32_t>& splitSources ) const
 {
-	std::vector<VkVertexInputAttributeDescription>
-		attributeDescriptions;
-
-	attributeDescriptions.push_back( 
-		{ 0,0,VK_FORMAT_R32G32B32_SFLOAT,
-		offsetof( Vertex, position )} );
-	attributeDescriptions.push_back(
-		{ 1,0,VK_FORMAT_R32G32B32_SFLOAT,
-		offsetof( Vertex, color ) } );
-	attributeDescriptions.push_back(
-		{ 2,0,VK_FORMAT_R32G32B32_SFLOAT,
-		offsetof( Vertex, normal ) } );
-	attributeDescriptions.push_back(
-		{ 3,0,VK_FORMAT_R32G32_SFLOAT,
-		offsetof( Vertex, uv ) } );
-
-	return attributeDescriptions;
+	VertexRuns runs;
+	runs.offsets.assign( vertexCount + 1, 0 );
+	for ( uint32_t source : splitSources )
+	{
+		runs.offsets[ source + 1 ]++;
+	}
+	for ( size_t vertex = 0; vertex < vertexCount; vertex++ )
+	{
+		runs.offsets[ vertex + 1 ] += runs.offsets[ vertex ];
+	}
+
+	runs.entries.resize( splitSources.size() );
+	std::vector<uint32_t> fill( runs.offsets.begin(), runs.offsets.end() - 1 );
+	for ( uint32_t run = 0; run < m_Submeshes.size(); run++ )
+	{
+		const size_t first = static_cast< size_t >( m_Submeshes[ run ].vertexOffset );
+		const size_t end = run + 1 < m_Submeshes.size() ? static_cast< size_t >( m_Submeshes[ run + 1 ].vertexOffset ) : splitSources.size();
+		for ( size_t splitVertex = first; splitVertex < end; splitVertex++ )
+		{
+			runs.entries[ fill[ splitSources[ splitVertex ] ]++ ] = { run, static_cast< uint32_t >( splitVertex - first ) };
+		}
+	}
+	return runs;
+}
+
+void Model::SplitIntoVertexRuns( const std::vector<Vertex>& vertices, const uint32_t* indices, size_t indexCount,
+	const VertexRuns& runs, std::vector<Vertex>& splitVertices, std::vector<uint32_t>& splitIndices,
+	std::vector<uint32_t>& splitSources )
+{
+	constexpr uint32_t UNASSIGNED = ~0u;
+	const uint32_t runCount = static_cast< uint32_t >( m_Lods.empty() ? m_Submeshes.size() : m_Lods[ 0 ].submeshCount );
+
+	auto findInRun = [ & ]( uint32_t vertex, uint32_t run )
+		{
+			for ( uint32_t i = runs.offsets[ vertex ]; i < runs.offsets[ vertex + 1 ]; i++ )
+			{
+				if ( runs.entries[ i ].first == run ) return runs.entries[ i ].second;
+			}
+			return UNASSIGNED;
+		};
+
+	//Triangles keep their order inside a run, the ones no run has all corners of are split on their own afterwards
+	std::vector<std::vector<uint32_t>> runTriangles( runCount );
+	std::vector<uint32_t> leftover;
+	for ( size_t triangle = 0; triangle + 2 < indexCount; triangle += 3 )
+	{
+		const uint32_t* corners = &indices[ triangle ];
+		bool placed = false;
+		for ( uint32_t i = runs.offsets[ corners[ 0 ] ]; i < runs.offsets[ corners[ 0 ] + 1 ] && !placed; i++ )
+		{
+			const auto [ run, local0 ] = runs.entries[ i ];
+			const uint32_t local1 = findInRun( corners[ 1 ], run );
+			const uint32_t local2 = findInRun( corners[ 2 ], run );
+			if ( local1 != UNASSIGNED && local2 != UNASSIGNED )
+			{
+				runTriangles[ run ].insert( runTriangles[ run ].end(), { local0, local1, local2 } );
+				placed = true;
+			}
+		}
+		if ( !placed )
+		{
+			leftover.insert( leftover.end(), corners, corners + 3 );
+		}
+	}
+
+	for ( uint32_t run = 0; run < runCount; run++ )
+	{
+		if ( runTriangles[ run ].empty() ) continue;
+
+		Submesh submesh{};
+		submesh.firstIndex = static_cast< uint32_t >( splitIndices.size() );
+		submesh.indexCount = static_cast< uint32_t >( runTriangles[ run ].size() );
+		submesh.vertexOffset = m_Submeshes[ run ].vertexOffset;
+		m_Submeshes.push_back( submesh );
+		splitIndices.insert( splitIndices.end(), runTriangles[ run ].begin(), runTriangles[ run ].end() );
+	}
+
+	if ( !leftover.empty() )
+	{
+		SplitSubmeshes( vertices, leftover.data(), leftover.size(), splitVertices, splitIndices, splitSources );
+	}
+}
+
+const std::array<VertexAttribute, 4> Model::Vertex::ATTRIBUTES =
+{ {
+	{ 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof( Vertex, position ) },
+	{ 1, VK_FORMAT_R32G32B32_SFLOAT, offsetof( Vertex, color ) },
+	{ 2, VK_FORMAT_R32G32B32_SFLOAT, offsetof( Vertex, normal ) },
+	{ 3, VK_FORMAT_R32G32_SFLOAT, offsetof( Vertex, uv ) },
+} };
+
+//Same locations as Vertex, the compact shaders decode the normal and apply the dequantization
+const std::array<VertexAttribute, 4> Model::CompactVertex::ATTRIBUTES =
+{ {
+	{ 0, VK_FORMAT_R16G16B16A16_SNORM, offsetof( CompactVertex, position ) },
+	{ 1, VK_FORMAT_R8G8B8A8_UNORM, offsetof( CompactVertex, color ) },
+	{ 2, VK_FORMAT_R16G16_SNORM, offsetof( CompactVertex, normal ) },
+	{ 3, VK_FORMAT_R16G16_SFLOAT, offsetof( CompactVertex, uv ) },
+} };
+
+static_assert( sizeof( Model::CompactVertex ) == 20, "CompactVertex should stay 20 bytes" );
+
+namespace
+{
+	//Octahedral mapping of a unit vector to [-1, 1]^2, the lower hemisphere folds over the diagonals
+	glm::vec2 OctahedralEncode( glm::vec3 normal )
+	{
+		const float length = std::abs( normal.x ) + std::abs( normal.y ) + std::abs( normal.z );
+		if ( length == 0.f )
+		{
+			return glm::vec2( 0.f );
+		}
+
+		normal /= length;
+		glm::vec2 encoded{ normal.x, normal.y };
+		if ( normal.z < 0.f )
+		{
+			encoded.x = ( 1.f - std::abs( normal.y ) ) * ( normal.x >= 0.f ? 1.f : -1.f );
+			encoded.y = ( 1.f - std::abs( normal.x ) ) * ( normal.y >= 0.f ? 1.f : -1.f );
+		}
+		return encoded;
+	}
+}
+
+glm::mat4 Model::VertexQuantization::Apply( const glm::mat4& worldMatrix ) const
+{
+	glm::mat4 result;
+	result[ 0 ] = worldMatrix[ 0 ] * scale.x;
+	result[ 1 ] = worldMatrix[ 1 ] * scale.y;
+	result[ 2 ] = worldMatrix[ 2 ] * scale.z;
+	result[ 3 ] = worldMatrix * glm::vec4( offset, 1.f );
+	return result;
+}
+
+Model::CompactVertex Model::CompactVertex::Encode( const Vertex& vertex, const VertexQuantization& quantization )
+{
+	CompactVertex compact{};
+
+	const glm::vec3 position = glm::clamp( ( vertex.position - quantization.offset ) / quantization.scale, -1.f, 1.f );
+	for ( int i = 0; i < 3; i++ )
+	{
+		compact.position[ i ] = static_cast< int16_t >( std::round( position[ i ] * 32767.f ) );
+	}
+	compact.position[ 3 ] = 32767;
+
+	compact.color = glm::packUnorm4x8( glm::vec4( glm::clamp( vertex.color, 0.f, 1.f ), 1.f ) );
+	compact.normal = glm::packSnorm2x16( OctahedralEncode( vertex.normal ) );
+	compact.uv = glm::packHalf2x16( vertex.uv );
+	return compact;
 }
 
 void Model::ModelData::LoadModel( const std::string& filename )
 {
+	if ( MeshCache::Load( filename, *this ) )
+	{
+		return;
+	}
+
 	tinyobj::attrib_t attrib;
 	std::vector<tinyobj::shape_t> shapes;
 	std::vector<tinyobj::material_t> materials;
@@ -247,8 +527,18 @@ void Model::ModelData::LoadModel( const std::string& filename )
 		}
 	}
 
+	//Only runs on import, the cache below stores the optimized order
+	const MeshOptimizer::OptimizeStats optimizeStats = MeshOptimizer::Optimize( vertices, indices );
+	importStats = { filename, optimizeStats.before, optimizeStats.after };
+
+	MeshSimplifier::BuildLods( *this );
+
+	MeshletBuilder::Build( *this );
+
 	triangles = GetTriangles();
 
+	MeshCache::Save( filename, *this );
+
 	//// TODO: Load the image using a library like STB image
 	//int texWidth, texHeight, texChannels;
 	//stbi_uc* pixels = stbi_load( "texture.png", &texWidth, &texHeight, &texChannels, STBI_rgb_alpha );
@@ -272,6 +562,20 @@ void Model::ModelData::LoadModel( const std::string& filename )
 	//// Bind texture to shader (this is done in your shader code)
 }
 
+void Model::ModelData::LoadFromFile( const std::string& filename )
+{
+	std::string extension = std::filesystem::path( filename ).extension().string();
+	if ( extension == ".obj" ) {
+		LoadModel( filename );
+	}
+	else if ( extension == ".json" ) {
+		LoadJSON( filename );
+	}
+	else {
+		throw std::runtime_error( "Unsupported file format: " + extension );
+	}
+}
+
 void  Model::ModelData::LoadJSON( const std::string& filename )
 {
 	std::ifstream file( filename );
@@ -8,23 +8,35 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <memory>
+#include <array>
 #include "FrameInfo.h"
+#include "Frustum.h"
+#include "VertexLayout.h"
 
 class Model 
 {
 public:
-	struct Vertex
+	//Compact positions are snorm16 inside the mesh bounds: position = offset + scale * decoded
+	struct VertexQuantization
 	{
+		glm::vec3 offset{ 0.f };
+		glm::vec3 scale{ 1.f };
+
+		//Same as worldMatrix * translate( offset ) * scale( scale ), without the full matrix product
+		glm::mat4 Apply( const glm::mat4& worldMatrix ) const;
+	};
+
+	//44 bytes, also what ModelData and the mesh cache hold
+	struct Vertex : VertexLayoutDescriptions<Vertex>
+	{
+		static constexpr VertexLayout LAYOUT = VertexLayout::Full;
+		static const std::array<VertexAttribute, 4> ATTRIBUTES;
+
 		glm::vec3 position;
 		glm::vec3 color;
 		glm::vec3 normal;
 		glm::vec2 uv;
 
-		static std::vector<VkVertexInputBindingDescription> 
-			GetBindingDescriptions();
-		static std::vector<VkVertexInputAttributeDescription> 
-			GetAttributeDescriptions();
-
 		bool operator==( const Vertex& other ) const
 		{
 			return position == other.position &&
@@ -34,15 +46,87 @@ public:
 		}
 	};
 
+	//20 bytes, read by the shader*Compact.vert shaders on the same locations as Vertex
+	struct CompactVertex : VertexLayoutDescriptions<CompactVertex>
+	{
+		static constexpr VertexLayout LAYOUT = VertexLayout::Compact;
+		static const std::array<VertexAttribute, 4> ATTRIBUTES;
+
+		int16_t position[ 4 ];	//snorm16, w is padding
+		uint32_t color;			//unorm8 rgba
+		uint32_t normal;		//octahedral, snorm16 x2
+		uint32_t uv;			//half float x2
+
+		static CompactVertex Encode( const Vertex& vertex, const VertexQuantization& quantization );
+	};
+
+	//Part of the index buffer drawn with its own base vertex, so 16 bit indices can reach every vertex
+	struct Submesh
+	{
+		uint32_t firstIndex = 0;
+		uint32_t indexCount = 0;
+		int32_t vertexOffset = 0;
+	};
+
+	//Highest vertex count a 16 bit index buffer covers, 0xffff stays clear of the primitive restart value
+	static constexpr uint32_t MAX_UINT16_VERTICES = 0xffff;
+
+	//Levels of detail, 0 is the full mesh
+	static constexpr uint32_t MAX_LODS = 4;
+
+	struct LodRange
+	{
+		uint32_t firstIndex = 0;	//Into indices followed by lodIndices
+		uint32_t indexCount = 0;
+		float error = 0.f;			//Largest deviation from LOD 0, in mesh units
+	};
+
+	//Run of at most MeshletBuilder::MAX_VERTICES vertices and MAX_TRIANGLES triangles of indices,
+	//culled on its own by the gpu driven renderer
+	struct Meshlet
+	{
+		glm::vec3 center{ 0.f };		//Bounding sphere
+		float radius = 0.f;
+		glm::vec3 coneAxis{ 0.f, 0.f, 1.f };	//Average facing of the triangles
+		float coneCutoff = 1.f;			//Sine of the cone's half angle, 1 when the triangles face too many ways to cull
+		uint32_t firstIndex = 0;		//Into indices
+		uint32_t indexCount = 0;
+	};
+
+	//Post transform vertex cache efficiency of an index order, see MeshOptimizer::AnalyzeVertexCache
+	struct VertexCacheStats
+	{
+		float acmr = 0.f;	//Average cache miss ratio, shaded vertices per triangle (0.5 at best, 3 at worst)
+		float atvr = 0.f;	//Average transformed vertex ratio, shaded vertices per referenced vertex (1 at best)
+	};
+
+	//What MeshOptimizer did to one imported file
+	struct ImportStats
+	{
+		std::string filename;
+		VertexCacheStats before;
+		VertexCacheStats after;
+	};
+
 	struct ModelData
 	{
 	public:
 		std::vector<Vertex> vertices;
 		std::vector<uint32_t> indices;
 		std::vector<glm::vec3> triangles;
+		//Simplified index lists over the same vertices, lods[ 0 ] covers indices.
+		//Empty for meshes that were never simplified, those draw indices only
+		std::vector<uint32_t> lodIndices;
+		std::vector<LodRange> lods;
+		//Partition of indices, empty until MeshletBuilder ran
+		std::vector<Meshlet> meshlets;
+		//Only filled when LoadModel imported the file, the filename stays empty when it came from the mesh cache
+		ImportStats importStats;
 
 		void LoadModel( const std::string& filename );
 		void LoadJSON( const std::string& filename );
+		//Picks LoadModel or LoadJSON from the extension, safe to call from worker threads
+		void LoadFromFile( const std::string& filename );
 
 		std::vector<glm::vec3> GetTriangles();
 
@@ -51,36 +135,95 @@ public:
 	};
 
 	static std::unique_ptr<Model> CreateModelFromFile
-	( EngineDevice& device,const std::string& filename );
+	( EngineDevice& device,const std::string& filename, VertexLayout layout = VertexLayout::Full );
 
+	//The gpu copy is encoded in the given layout, ModelData always stays fp32.
+	//Indices are 16 bit when the vertices fit, larger meshes are split into submeshes that each fit
+	//unless splitLargeMeshes is off, then they keep 32 bit indices
 	Model( EngineDevice& device,
-		const Model::ModelData& modelData );
+		const Model::ModelData& modelData, VertexLayout layout = VertexLayout::Full, bool splitLargeMeshes = true );
 	~Model();
 
 	Model( const Model& ) = delete;
 	Model& operator=( const Model& ) = delete;
 
 	void Bind(VkCommandBuffer commandBuffer);
-	void Draw( VkCommandBuffer commandBuffer );
+	//Returns the number of draw calls recorded, one per submesh of the lod
+	uint32_t Draw( VkCommandBuffer commandBuffer, uint32_t instanceCount = 1, uint32_t firstInstance = 0, uint32_t lod = 0 );
 
 	ModelData GetModelData() const;
-
+	//The buffers can only be drawn once the upload queue submitted this
+	UploadTicket GetUploadTicket() const { return m_UploadTicket; }
+	//Local space bounds of all vertices, computed once at load
+	const BoundingBox& GetBoundingBox() const { return m_BoundingBox; }
+
+	VertexLayout GetVertexLayout() const { return m_VertexLayout; }
+	const VertexQuantization& GetQuantization() const { return m_Quantization; }
+	//The model matrix the shaders of this layout expect, compact layouts get the dequantization folded in
+	glm::mat4 GetDrawMatrix( const glm::mat4& worldMatrix ) const
+	{
+		return m_VertexLayout == VertexLayout::Full ? worldMatrix : m_Quantization.Apply( worldMatrix );
+	}
+	uint32_t GetVertexCount() const { return m_VertexCount; }
+	VkDeviceSize GetVertexBufferSize() const { return m_VertexBufferSize; }
+	VkIndexType GetIndexType() const { return m_IndexType; }
+	VkDeviceSize GetIndexBufferSize() const { return m_IndexBufferSize; }
+	const std::vector<Submesh>& GetSubmeshes() const { return m_Submeshes; }
+	uint32_t GetLodCount() const { return static_cast< uint32_t >( m_Lods.size() ); }
+	float GetLodError( uint32_t lod ) const { return m_Lods[ lod ].error; }
 
 private:
-	void CreateVertexBuffer(const std::vector<Vertex>& vertices);
+	//Encodes every vertex as VertexType before the upload
+	template<typename VertexType>
+	void CreateVertexBuffer( const std::vector<Vertex>& vertices );
 	void CreateIndexBuffer( const std::vector<uint32_t>& indices );
+	void ComputeBoundingBox( const std::vector<Vertex>& vertices );
+	//Cuts the triangles into runs of at most MAX_UINT16_VERTICES vertices, shared vertices are duplicated,
+	//the indices written are relative to their submesh's vertexOffset. Appends to the outputs and m_Submeshes,
+	//splitSources gets the index into vertices of every vertex appended to splitVertices
+	void SplitSubmeshes( const std::vector<Vertex>& vertices, const uint32_t* indices, size_t indexCount,
+		std::vector<Vertex>& splitVertices, std::vector<uint32_t>& splitIndices, std::vector<uint32_t>& splitSources );
+	//Where the submeshes split so far put every vertex: entries[ offsets[ v ], offsets[ v + 1 ] ) are
+	//( submesh, index inside it ) pairs, more than one for vertices duplicated at a submesh border
+	struct VertexRuns
+	{
+		std::vector<uint32_t> offsets;
+		std::vector<std::pair<uint32_t, uint32_t>> entries;
+	};
+	VertexRuns MapVertexRuns( size_t vertexCount, const std::vector<uint32_t>& splitSources ) const;
+	//Draws a lower lod from the vertex runs LOD 0 was split into instead of new copies.
+	//Only triangles whose vertices don't share a run are split again with vertices of their own
+	void SplitIntoVertexRuns( const std::vector<Vertex>& vertices, const uint32_t* indices, size_t indexCount,
+		const VertexRuns& runs, std::vector<Vertex>& splitVertices, std::vector<uint32_t>& splitIndices,
+		std::vector<uint32_t>& splitSources );
 	
 	EngineDevice& m_Device;
 	std::unique_ptr<Buffer> m_VertexBuffer;
 
 	uint32_t m_VertexCount;
+	VkDeviceSize m_VertexBufferSize = 0;
+	VertexLayout m_VertexLayout = VertexLayout::Full;
+	VertexQuantization m_Quantization{};
 
 	bool m_HasIndexBuffer = false;
 	std::unique_ptr<Buffer> m_IndexBuffer;
 	uint32_t m_IndexCount;
+	VkDeviceSize m_IndexBufferSize = 0;
+	VkIndexType m_IndexType = VK_INDEX_TYPE_UINT32;
+	std::vector<Submesh> m_Submeshes;
+
+	struct Lod
+	{
+		uint32_t firstSubmesh = 0;
+		uint32_t submeshCount = 0;
+		float error = 0.f;
+	};
+	std::vector<Lod> m_Lods;
 
 	std::vector<Vertex> m_Vertices;
 	std::vector<uint32_t> m_Indices;
 
 	ModelData m_ModelData;
+	UploadTicket m_UploadTicket{};
+	BoundingBox m_BoundingBox{};
 };
\ No newline at end of file
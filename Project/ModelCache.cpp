@@ -0,0 +1,83 @@
+#include "ModelCache.h"
+#include <filesystem>
+
+std::string ModelCache::MakeKey( const std::string& filename, VertexLayout layout )
+{
+	//"Models/Cube.obj" and "./Models/Cube.obj" should hit the same entry
+	std::error_code error;
+	std::filesystem::path path = std::filesystem::absolute( filename, error );
+	if ( error )
+	{
+		path = filename;
+	}
+
+	std::filesystem::path canonical = std::filesystem::weakly_canonical( path, error );
+	//The same file in another layout is another gpu buffer
+	return ( error ? path.lexically_normal() : canonical ).generic_string() + '|' + GetVertexLayoutName( layout );
+}
+
+std::shared_ptr<Model> ModelCache::Find( const std::string& filename, VertexLayout layout )
+{
+	const std::string key = MakeKey( filename, layout );
+
+	std::lock_guard<std::mutex> lock{ m_Mutex };
+	auto it = m_Models.find( key );
+	if ( it == m_Models.end() )
+	{
+		return nullptr;
+	}
+
+	std::shared_ptr<Model> model = it->second.lock();
+	if ( !model )
+	{
+		m_Models.erase( it );
+	}
+	return model;
+}
+
+std::shared_ptr<Model> ModelCache::Add( const std::string& filename, const Model::ModelData& modelData, VertexLayout layout )
+{
+	const std::string key = MakeKey( filename, layout );
+
+	std::lock_guard<std::mutex> lock{ m_Mutex };
+	std::weak_ptr<Model>& entry = m_Models[ key ];
+	if ( std::shared_ptr<Model> model = entry.lock() )
+	{
+		return model;
+	}
+
+	auto model = std::make_shared<Model>( m_Device, modelData, layout, m_SplitLargeMeshes );
+	entry = model;
+	return model;
+}
+
+std::shared_ptr<Model> ModelCache::Load( const std::string& filename, VertexLayout layout )
+{
+	if ( std::shared_ptr<Model> model = Find( filename, layout ) )
+	{
+		return model;
+	}
+
+	Model::ModelData modelData;
+	modelData.LoadFromFile( filename );
+	return Add( filename, modelData, layout );
+}
+
+size_t ModelCache::GetLiveModelCount()
+{
+	std::lock_guard<std::mutex> lock{ m_Mutex };
+	size_t count = 0;
+	for ( auto it = m_Models.begin(); it != m_Models.end(); )
+	{
+		if ( it->second.expired() )
+		{
+			it = m_Models.erase( it );
+		}
+		else
+		{
+			++count;
+			++it;
+		}
+	}
+	return count;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <string>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "Model.h"
+
+//Path and vertex layout keyed registry of loaded models, every unique mesh is parsed and uploaded once per layout.
+//Only weak references are kept, a model is freed as soon as no Scene uses it anymore.
+class ModelCache
+{
+public:
+	//splitLargeMeshes goes to every Model, see its constructor
+	explicit ModelCache( EngineDevice& device, bool splitLargeMeshes = true )
+		: m_Device{ device }, m_SplitLargeMeshes{ splitLargeMeshes } {}
+
+	ModelCache( const ModelCache& ) = delete;
+	ModelCache& operator=( const ModelCache& ) = delete;
+
+	//Returns the live model for this file or nullptr
+	std::shared_ptr<Model> Find( const std::string& filename, VertexLayout layout = VertexLayout::Full );
+	//Uploads already parsed data, or returns the existing model if another load got there first
+	std::shared_ptr<Model> Add( const std::string& filename, const Model::ModelData& modelData, VertexLayout layout = VertexLayout::Full );
+	//Find, or parse and upload on the calling thread
+	std::shared_ptr<Model> Load( const std::string& filename, VertexLayout layout = VertexLayout::Full );
+
+	size_t GetLiveModelCount();
+
+private:
+	static std::string MakeKey( const std::string& filename, VertexLayout layout );
+
+	EngineDevice& m_Device;
+	bool m_SplitLargeMeshes;
+	std::mutex m_Mutex;
+	std::unordered_map<std::string, std::weak_ptr<Model>> m_Models;
+};
@@ -0,0 +1,294 @@
+#include "OffscreenTarget.h"
+#include "SwapChain.h"
+#include <array>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include "Profiler.h"
+
+OffscreenTarget::OffscreenTarget( EngineDevice& device, VkExtent2D extent )
+    : m_Device{ device }, m_Extent{ extent }
+{
+    m_DepthFormat = m_Device.FindSupportedFormat(
+        { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT },
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT );
+
+    CreateRenderPass();
+
+    m_Frames.resize( SwapChain::MAX_FRAMES_IN_FLIGHT );
+    for ( auto& frame : m_Frames )
+    {
+        CreateFrame( frame );
+    }
+}
+
+OffscreenTarget::~OffscreenTarget()
+{
+    WaitIdle();
+
+    for ( auto& frame : m_Frames )
+    {
+        DestroyFrame( frame );
+    }
+    vkDestroyRenderPass( m_Device.Device(), m_RenderPass, nullptr );
+}
+
+void OffscreenTarget::AcquireFrame( int frameIndex )
+{
+    PROFILE_SCOPE( "OffscreenTarget::WaitForFrameFence" );
+    Frame& frame = m_Frames[ frameIndex ];
+    vkWaitForFences( m_Device.Device(), 1, &frame.fence, VK_TRUE, UINT64_MAX );
+
+    if ( !frame.pendingReadback.empty() )
+    {
+        WriteReadback( frame );
+    }
+}
+
+void OffscreenTarget::RecordReadback( VkCommandBuffer commandBuffer, int frameIndex, const std::string& file )
+{
+    Frame& frame = m_Frames[ frameIndex ];
+    if ( frame.readbackBuffer == nullptr )
+    {
+        frame.readbackBuffer = std::make_unique<Buffer>( m_Device, 4, m_Extent.width * m_Extent.height,
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT );
+        frame.readbackBuffer->map();
+    }
+
+    //The render pass already left the image in TRANSFER_SRC_OPTIMAL, only wait for its writes
+    VkImageMemoryBarrier renderBarrier{};
+    renderBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    renderBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    renderBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    renderBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    renderBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    renderBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    renderBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    renderBarrier.image = frame.colorImage;
+    renderBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0, 0, nullptr, 0, nullptr, 1, &renderBarrier );
+
+    VkBufferImageCopy region{};
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent = { m_Extent.width, m_Extent.height, 1 };
+    vkCmdCopyImageToBuffer( commandBuffer, frame.colorImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        frame.readbackBuffer->getBuffer(), 1, &region );
+
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+        0, 1, &barrier, 0, nullptr, 0, nullptr );
+
+    frame.pendingReadback = file;
+}
+
+VkResult OffscreenTarget::Submit( VkCommandBuffer commandBuffer, int frameIndex )
+{
+    Frame& frame = m_Frames[ frameIndex ];
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+
+    vkResetFences( m_Device.Device(), 1, &frame.fence );
+    return vkQueueSubmit( m_Device.GraphicsQueue(), 1, &submitInfo, frame.fence );
+}
+
+void OffscreenTarget::WaitIdle()
+{
+    for ( int i = 0; i < static_cast< int >( m_Frames.size() ); i++ )
+    {
+        AcquireFrame( i );
+    }
+}
+
+void OffscreenTarget::WriteReadback( Frame& frame )
+{
+    frame.readbackBuffer->invalidate();
+
+    //Binary PPM, every viewer and image diff tool reads it and it needs no extra dependency
+    std::ofstream file{ frame.pendingReadback, std::ios::binary };
+    if ( !file.is_open() )
+    {
+        std::cout << "Could not write frame capture: " << frame.pendingReadback << std::endl;
+        frame.pendingReadback.clear();
+        return;
+    }
+
+    file << "P6\n" << m_Extent.width << " " << m_Extent.height << "\n255\n";
+
+    const auto* pixels = static_cast< const uint8_t* >( frame.readbackBuffer->getMappedMemory() );
+    std::vector<uint8_t> row( m_Extent.width * 3 );
+    for ( uint32_t y = 0; y < m_Extent.height; y++ )
+    {
+        const uint8_t* source = pixels + static_cast< size_t >( y ) * m_Extent.width * 4;
+        for ( uint32_t x = 0; x < m_Extent.width; x++ )
+        {
+            row[ x * 3 + 0 ] = source[ x * 4 + 0 ];
+            row[ x * 3 + 1 ] = source[ x * 4 + 1 ];
+            row[ x * 3 + 2 ] = source[ x * 4 + 2 ];
+        }
+        file.write( reinterpret_cast< const char* >( row.data() ), row.size() );
+    }
+
+    frame.pendingReadback.clear();
+}
+
+void OffscreenTarget::CreateRenderPass()
+{
+    //Same attachments and subpass as SwapChain::CreateRenderPass, so every pipeline works with both
+    VkAttachmentDescription depthAttachment{};
+    depthAttachment.format = m_DepthFormat;
+    depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference depthAttachmentRef{};
+    depthAttachmentRef.attachment = 1;
+    depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentDescription colorAttachment{};
+    colorAttachment.format = m_ColorFormat;
+    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    //Nothing presents it, leave it ready for the readback copy
+    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+    VkAttachmentReference colorAttachmentRef{};
+    colorAttachmentRef.attachment = 0;
+    colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &colorAttachmentRef;
+    subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+    VkSubpassDependency dependency{};
+    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependency.srcAccessMask = 0;
+    dependency.srcStageMask =
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+        VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    dependency.dstSubpass = 0;
+    dependency.dstStageMask =
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+        VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    dependency.dstAccessMask =
+        VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+    std::array<VkAttachmentDescription, 2> attachments = { colorAttachment, depthAttachment };
+    VkRenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = static_cast< uint32_t >( attachments.size() );
+    renderPassInfo.pAttachments = attachments.data();
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+    renderPassInfo.dependencyCount = 1;
+    renderPassInfo.pDependencies = &dependency;
+
+    if ( vkCreateRenderPass( m_Device.Device(), &renderPassInfo, nullptr, &m_RenderPass ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create offscreen render pass!" );
+    }
+}
+
+void OffscreenTarget::CreateFrame( Frame& frame )
+{
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent = { m_Extent.width, m_Extent.height, 1 };
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    imageInfo.format = m_ColorFormat;
+    imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    m_Device.CreateImageWithInfo( imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame.colorImage, frame.colorMemory );
+    frame.colorView = CreateImageView( frame.colorImage, m_ColorFormat, VK_IMAGE_ASPECT_COLOR_BIT );
+
+    imageInfo.format = m_DepthFormat;
+    imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    m_Device.CreateImageWithInfo( imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame.depthImage, frame.depthMemory );
+    frame.depthView = CreateImageView( frame.depthImage, m_DepthFormat, VK_IMAGE_ASPECT_DEPTH_BIT );
+
+    std::array<VkImageView, 2> attachments = { frame.colorView, frame.depthView };
+    VkFramebufferCreateInfo framebufferInfo{};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = m_RenderPass;
+    framebufferInfo.attachmentCount = static_cast< uint32_t >( attachments.size() );
+    framebufferInfo.pAttachments = attachments.data();
+    framebufferInfo.width = m_Extent.width;
+    framebufferInfo.height = m_Extent.height;
+    framebufferInfo.layers = 1;
+
+    if ( vkCreateFramebuffer( m_Device.Device(), &framebufferInfo, nullptr, &frame.framebuffer ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create offscreen framebuffer!" );
+    }
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+    if ( vkCreateFence( m_Device.Device(), &fenceInfo, nullptr, &frame.fence ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create offscreen fence!" );
+    }
+}
+
+void OffscreenTarget::DestroyFrame( Frame& frame )
+{
+    vkDestroyFence( m_Device.Device(), frame.fence, nullptr );
+    vkDestroyFramebuffer( m_Device.Device(), frame.framebuffer, nullptr );
+
+    vkDestroyImageView( m_Device.Device(), frame.depthView, nullptr );
+    vkDestroyImage( m_Device.Device(), frame.depthImage, nullptr );
+    m_Device.FreeMemory( frame.depthMemory );
+
+    vkDestroyImageView( m_Device.Device(), frame.colorView, nullptr );
+    vkDestroyImage( m_Device.Device(), frame.colorImage, nullptr );
+    m_Device.FreeMemory( frame.colorMemory );
+
+    frame.readbackBuffer.reset();
+}
+
+VkImageView OffscreenTarget::CreateImageView( VkImage image, VkFormat format, VkImageAspectFlags aspect )
+{
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = format;
+    viewInfo.subresourceRange.aspectMask = aspect;
+    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = 1;
+
+    VkImageView imageView;
+    if ( vkCreateImageView( m_Device.Device(), &viewInfo, nullptr, &imageView ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create offscreen image view!" );
+    }
+    return imageView;
+}
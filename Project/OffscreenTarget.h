@@ -0,0 +1,64 @@
+#pragma once
+#include "EngineDevice.h"
+#include "Buffer.h"
+#include <vulkan/vulkan.h>
+#include <string>
+#include <vector>
+#include <memory>
+
+//Stand in for SwapChain when there is no window: color + depth images per frame in flight,
+//rendered with the same render pass layout, and copied back to host memory on request.
+class OffscreenTarget
+{
+public:
+    OffscreenTarget( EngineDevice& device, VkExtent2D extent );
+    ~OffscreenTarget();
+
+    OffscreenTarget( const OffscreenTarget& ) = delete;
+    OffscreenTarget& operator=( const OffscreenTarget& ) = delete;
+
+    VkRenderPass GetRenderPass() const { return m_RenderPass; }
+    VkFramebuffer GetFrameBuffer( int frameIndex ) const { return m_Frames[ frameIndex ].framebuffer; }
+    VkExtent2D GetExtent() const { return m_Extent; }
+    VkFormat GetImageFormat() const { return m_ColorFormat; }
+    float GetAspectRatio() const { return static_cast< float >( m_Extent.width ) / static_cast< float >( m_Extent.height ); }
+
+    //Waits until the frame's previous submit is done, and writes its readback if one was requested
+    void AcquireFrame( int frameIndex );
+    //Records the copy of the color image into host memory, call after the render pass ended
+    void RecordReadback( VkCommandBuffer commandBuffer, int frameIndex, const std::string& file );
+    VkResult Submit( VkCommandBuffer commandBuffer, int frameIndex );
+    //Finishes all frames and writes every readback that is still pending
+    void WaitIdle();
+
+private:
+    struct Frame
+    {
+        VkImage colorImage = VK_NULL_HANDLE;
+        MemoryAllocation colorMemory{};
+        VkImageView colorView = VK_NULL_HANDLE;
+        VkImage depthImage = VK_NULL_HANDLE;
+        MemoryAllocation depthMemory{};
+        VkImageView depthView = VK_NULL_HANDLE;
+        VkFramebuffer framebuffer = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+
+        std::unique_ptr<Buffer> readbackBuffer;
+        std::string pendingReadback;
+    };
+
+    void CreateRenderPass();
+    void CreateFrame( Frame& frame );
+    void DestroyFrame( Frame& frame );
+    VkImageView CreateImageView( VkImage image, VkFormat format, VkImageAspectFlags aspect );
+    void WriteReadback( Frame& frame );
+
+    EngineDevice& m_Device;
+    VkExtent2D m_Extent;
+    //RGBA byte order so the readback can be written out without swizzling
+    VkFormat m_ColorFormat = VK_FORMAT_R8G8B8A8_SRGB;
+    VkFormat m_DepthFormat;
+    VkRenderPass m_RenderPass = VK_NULL_HANDLE;
+
+    std::vector<Frame> m_Frames;
+};
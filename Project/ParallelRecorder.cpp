@@ -0,0 +1,180 @@
+#include "ParallelRecorder.h"
+#include "EngineDevice.h"
+#include "SwapChain.h"
+#include "Profiler.h"
+#include <stdexcept>
+
+ParallelRecorder::ParallelRecorder( EngineDevice& device, JobSystem& jobSystem )
+    : m_Device{ device },
+    m_JobSystem{ jobSystem }
+{
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = m_Device.FindPhysicalQueueFamilies().graphicsFamily;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+    m_Frames.resize( SwapChain::MAX_FRAMES_IN_FLIGHT );
+    for ( auto& slots : m_Frames )
+    {
+        slots.resize( GetSlotCount() );
+        for ( auto& slot : slots )
+        {
+            if ( vkCreateCommandPool( m_Device.Device(), &poolInfo, nullptr, &slot.commandPool ) != VK_SUCCESS )
+            {
+                throw std::runtime_error( "Failed to create secondary command pool!" );
+            }
+        }
+    }
+
+    m_InheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+}
+
+ParallelRecorder::~ParallelRecorder()
+{
+    //Destroying a pool frees its command buffers
+    for ( auto& slots : m_Frames )
+    {
+        for ( auto& slot : slots )
+        {
+            vkDestroyCommandPool( m_Device.Device(), slot.commandPool, nullptr );
+        }
+    }
+}
+
+void ParallelRecorder::BeginRenderPass( int frameIndex, VkRenderPass renderPass, VkFramebuffer framebuffer, VkExtent2D extent )
+{
+    PROFILE_FUNCTION();
+    m_FrameIndex = frameIndex;
+    m_InheritanceInfo.renderPass = renderPass;
+    m_InheritanceInfo.subpass = 0;
+    m_InheritanceInfo.framebuffer = framebuffer;
+    m_Extent = extent;
+    m_Recorded.clear();
+
+    //The fence of this frame index was waited on, none of its buffers are still executing
+    for ( auto& slot : m_Frames[ m_FrameIndex ] )
+    {
+        vkResetCommandPool( m_Device.Device(), slot.commandPool, 0 );
+        slot.usedCount = 0;
+    }
+}
+
+VkCommandBuffer ParallelRecorder::BeginSecondary( Slot& slot )
+{
+    if ( slot.usedCount == slot.commandBuffers.size() )
+    {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocInfo.commandPool = slot.commandPool;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer commandBuffer;
+        if ( vkAllocateCommandBuffers( m_Device.Device(), &allocInfo, &commandBuffer ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to allocate secondary command buffer!" );
+        }
+        slot.commandBuffers.push_back( commandBuffer );
+    }
+    VkCommandBuffer commandBuffer = slot.commandBuffers[ slot.usedCount++ ];
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.pInheritanceInfo = &m_InheritanceInfo;
+
+    if ( vkBeginCommandBuffer( commandBuffer, &beginInfo ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to begin secondary command buffer!" );
+    }
+
+    //Dynamic state is not inherited from the primary
+    VkViewport viewport{};
+    viewport.width = static_cast< float >( m_Extent.width );
+    viewport.height = static_cast< float >( m_Extent.height );
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    VkRect2D scissor{ { 0, 0 }, m_Extent };
+
+    vkCmdSetViewport( commandBuffer, 0, 1, &viewport );
+    vkCmdSetScissor( commandBuffer, 0, 1, &scissor );
+    return commandBuffer;
+}
+
+void ParallelRecorder::Record( FrameInfo& frameinfo, uint32_t count, uint32_t minRangeSize, const RangeFunction& record )
+{
+    PROFILE_FUNCTION();
+    if ( count == 0 )
+    {
+        return;
+    }
+
+    std::vector<Slot>& slots = m_Frames[ m_FrameIndex ];
+    const uint32_t rangeCount = std::min( GetSlotCount(), ( count + std::max( minRangeSize, 1u ) - 1 ) / std::max( minRangeSize, 1u ) );
+    const uint32_t rangeSize = ( count + rangeCount - 1 ) / rangeCount;
+
+    //Buffers are taken from the pools here, after that every job only touches the pool of its own slot
+    std::vector<FrameInfo> rangeInfos( rangeCount, frameinfo );
+    for ( uint32_t range = 0; range < rangeCount; range++ )
+    {
+        rangeInfos[ range ].commandBuffer = BeginSecondary( slots[ range ] );
+        rangeInfos[ range ].drawCallCount = 0;
+        rangeInfos[ range ].gpuProfiler = nullptr;
+    }
+
+    auto recordRange = [ & ]( uint32_t range )
+        {
+            PROFILE_SCOPE( "ParallelRecorder::RecordRange" );
+            const uint32_t begin = range * rangeSize;
+            const uint32_t end = std::min( count, begin + rangeSize );
+            if ( begin < end )
+            {
+                record( rangeInfos[ range ], begin, end );
+            }
+            if ( vkEndCommandBuffer( rangeInfos[ range ].commandBuffer ) != VK_SUCCESS )
+            {
+                throw std::runtime_error( "Failed to record secondary command buffer!" );
+            }
+        };
+
+    //The last range is the parent, it can't finish before the others, so Wait covers them all even when one throws
+    JobSystem::JobHandle lastRange = m_JobSystem.CreateJob( [ &recordRange, rangeCount ]() { recordRange( rangeCount - 1 ); } );
+    for ( uint32_t range = 0; range + 1 < rangeCount; range++ )
+    {
+        m_JobSystem.Run( m_JobSystem.CreateChildJob( lastRange, [ &recordRange, range ]() { recordRange( range ); } ) );
+    }
+    m_JobSystem.Run( lastRange );
+    m_JobSystem.Wait( lastRange );
+
+    for ( const FrameInfo& rangeInfo : rangeInfos )
+    {
+        m_Recorded.push_back( rangeInfo.commandBuffer );
+        frameinfo.drawCallCount += rangeInfo.drawCallCount;
+    }
+}
+
+void ParallelRecorder::RecordInline( FrameInfo& frameinfo, const RecordFunction& record )
+{
+    //No range jobs are running between Record calls, so the first slot is free
+    FrameInfo inlineInfo = frameinfo;
+    inlineInfo.commandBuffer = BeginSecondary( m_Frames[ m_FrameIndex ][ 0 ] );
+    inlineInfo.drawCallCount = 0;
+
+    record( inlineInfo );
+    if ( vkEndCommandBuffer( inlineInfo.commandBuffer ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to record secondary command buffer!" );
+    }
+
+    m_Recorded.push_back( inlineInfo.commandBuffer );
+    frameinfo.drawCallCount += inlineInfo.drawCallCount;
+}
+
+void ParallelRecorder::Execute( VkCommandBuffer primaryCommandBuffer )
+{
+    if ( !m_Recorded.empty() )
+    {
+        vkCmdExecuteCommands( primaryCommandBuffer, static_cast< uint32_t >( m_Recorded.size() ), m_Recorded.data() );
+    }
+    m_Recorded.clear();
+}
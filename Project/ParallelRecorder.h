@@ -0,0 +1,61 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <functional>
+#include "FrameInfo.h"
+#include "JobSystem.h"
+
+class EngineDevice;
+
+//Records the contents of a render pass into secondary command buffers, split over the engine JobSystem.
+//Every recording slot has its own command pool per frame in flight, so no pool is ever touched by two threads,
+//and the pools of a frame are reset as a whole once its fence was waited on.
+class ParallelRecorder
+{
+public:
+    //Gets a copy of the frame info with its own secondary command buffer, records items [begin, end)
+    using RangeFunction = std::function<void( FrameInfo& frameinfo, uint32_t begin, uint32_t end )>;
+    using RecordFunction = std::function<void( FrameInfo& frameinfo )>;
+
+    explicit ParallelRecorder( EngineDevice& device, JobSystem& jobSystem = JobSystem::Get() );
+    ~ParallelRecorder();
+
+    ParallelRecorder( const ParallelRecorder& ) = delete;
+    ParallelRecorder& operator=( const ParallelRecorder& ) = delete;
+
+    //Called by the renderer when a render pass begins with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+    void BeginRenderPass( int frameIndex, VkRenderPass renderPass, VkFramebuffer framebuffer, VkExtent2D extent );
+
+    //Splits count items in ranges of at least minRangeSize and records them in parallel, one secondary buffer per range.
+    //Workers get no gpu profiler, the timestamp scopes are not thread safe
+    void Record( FrameInfo& frameinfo, uint32_t count, uint32_t minRangeSize, const RangeFunction& record );
+    //One secondary buffer recorded on the calling thread, for systems with a handful of draws
+    void RecordInline( FrameInfo& frameinfo, const RecordFunction& record );
+
+    //Executes everything recorded since BeginRenderPass, in recording order
+    void Execute( VkCommandBuffer primaryCommandBuffer );
+
+    //One range per job worker plus the calling thread
+    uint32_t GetSlotCount() const { return m_JobSystem.GetWorkerCount() + 1; }
+
+private:
+    struct Slot
+    {
+        VkCommandPool commandPool = VK_NULL_HANDLE;
+        std::vector<VkCommandBuffer> commandBuffers;
+        uint32_t usedCount = 0;
+    };
+
+    //Takes the next free secondary buffer of the slot and begins it inside the current render pass
+    VkCommandBuffer BeginSecondary( Slot& slot );
+
+    EngineDevice& m_Device;
+    JobSystem& m_JobSystem;
+
+    std::vector<std::vector<Slot>> m_Frames;
+    int m_FrameIndex = 0;
+
+    VkCommandBufferInheritanceInfo m_InheritanceInfo{};
+    VkExtent2D m_Extent{};
+    std::vector<VkCommandBuffer> m_Recorded;
+};
@@ -4,6 +4,7 @@
 #include <vulkan/vulkan.h>
 #include <vulkan/vulkan_core.h>
 #include <cassert>
+#include <chrono>
 #include "Model.h"
 
 Pipeline::Pipeline( 
@@ -15,11 +16,21 @@ Pipeline::Pipeline(
 	createGraphicsPipeline( vertFile, fragFile, pipelineInfo );
 }
 
+Pipeline::Pipeline(
+	EngineDevice& device,
+	const std::string& compFile,
+	const ComputePipelineConfigInfo& computeInfo ) : m_Device{ device }
+{
+	createComputePipeline( compFile, computeInfo );
+}
+
 Pipeline::~Pipeline()
 {
 	vkDestroyShaderModule( m_Device.Device(), m_VertShaderModule, nullptr );
 	vkDestroyShaderModule( m_Device.Device(), m_FragShaderModule, nullptr );
-	vkDestroyPipeline( m_Device.Device(), m_GraphicsPipeline, nullptr );
+	vkDestroyShaderModule( m_Device.Device(), m_CompShaderModule, nullptr );
+	vkDestroyPipeline( m_Device.Device(), m_Pipeline, nullptr );
+	vkDestroyPipelineLayout( m_Device.Device(), m_PipelineLayout, nullptr );
 }
 
 void Pipeline::defaultPipelineConfigInfo(PipelineConfigInfo& configInfo)
@@ -118,8 +129,19 @@ void Pipeline::defaultPipelineConfigInfo(PipelineConfigInfo& configInfo)
 void Pipeline::Bind( VkCommandBuffer commandBuffer )
 {
 	vkCmdBindPipeline( commandBuffer, 
-		VK_PIPELINE_BIND_POINT_GRAPHICS,
-		m_GraphicsPipeline );
+		m_BindPoint,
+		m_Pipeline );
+}
+
+void Pipeline::Dispatch( VkCommandBuffer commandBuffer,
+	uint32_t threadCountX, uint32_t threadCountY, uint32_t threadCountZ )
+{
+	assert( IsCompute() && "Cannot dispatch a graphics pipeline" );
+
+	vkCmdDispatch( commandBuffer,
+		( threadCountX + m_LocalSize[ 0 ] - 1 ) / m_LocalSize[ 0 ],
+		( threadCountY + m_LocalSize[ 1 ] - 1 ) / m_LocalSize[ 1 ],
+		( threadCountZ + m_LocalSize[ 2 ] - 1 ) / m_LocalSize[ 2 ] );
 }
 
 std::vector<char> Pipeline::readFile( const std::string& file )
@@ -208,15 +230,75 @@ void Pipeline::createGraphicsPipeline(
 	createPipelineInfo.basePipelineIndex = -1;
 	createPipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
+	PipelineCache& pipelineCache = m_Device.GetPipelineCache();
+	auto createStart = std::chrono::high_resolution_clock::now();
 	if ( vkCreateGraphicsPipelines(
 		m_Device.Device(),
-		VK_NULL_HANDLE,
+		pipelineCache.GetHandle(),
 		1,
 		&createPipelineInfo,
 		nullptr,
-		&m_GraphicsPipeline ) != VK_SUCCESS ) {
+		&m_Pipeline ) != VK_SUCCESS ) {
 		throw std::runtime_error( "failed to create graphics pipeline" );
 	}
+	pipelineCache.RecordPipelineCreation( std::chrono::duration<double, std::milli>(
+		std::chrono::high_resolution_clock::now() - createStart ).count() );
+}
+
+void Pipeline::createComputePipeline(
+	const std::string& compFile,
+	const ComputePipelineConfigInfo& computeInfo )
+{
+	assert(
+		computeInfo.localSizeX > 0 && computeInfo.localSizeY > 0 && computeInfo.localSizeZ > 0 &&
+		"Cannot create compute pipeline: local size has to be at least 1" );
+
+	m_BindPoint = VK_PIPELINE_BIND_POINT_COMPUTE;
+	m_LocalSize[ 0 ] = computeInfo.localSizeX;
+	m_LocalSize[ 1 ] = computeInfo.localSizeY;
+	m_LocalSize[ 2 ] = computeInfo.localSizeZ;
+
+	VkPipelineLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutInfo.setLayoutCount =
+		static_cast< uint32_t >( computeInfo.descriptorSetLayouts.size() );
+	layoutInfo.pSetLayouts = computeInfo.descriptorSetLayouts.data();
+	layoutInfo.pushConstantRangeCount =
+		static_cast< uint32_t >( computeInfo.pushConstantRanges.size() );
+	layoutInfo.pPushConstantRanges = computeInfo.pushConstantRanges.data();
+
+	if ( vkCreatePipelineLayout( m_Device.Device(),
+		&layoutInfo, nullptr, &m_PipelineLayout ) != VK_SUCCESS )
+	{
+		throw std::runtime_error( "failed to create compute pipeline layout" );
+	}
+
+	auto compCode = readFile( compFile );
+	createShaderModule( compCode, &m_CompShaderModule );
+
+	VkComputePipelineCreateInfo createPipelineInfo{};
+	createPipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	createPipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	createPipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	createPipelineInfo.stage.module = m_CompShaderModule;
+	createPipelineInfo.stage.pName = "main";
+	createPipelineInfo.layout = m_PipelineLayout;
+	createPipelineInfo.basePipelineIndex = -1;
+	createPipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+	PipelineCache& pipelineCache = m_Device.GetPipelineCache();
+	auto createStart = std::chrono::high_resolution_clock::now();
+	if ( vkCreateComputePipelines(
+		m_Device.Device(),
+		pipelineCache.GetHandle(),
+		1,
+		&createPipelineInfo,
+		nullptr,
+		&m_Pipeline ) != VK_SUCCESS ) {
+		throw std::runtime_error( "failed to create compute pipeline" );
+	}
+	pipelineCache.RecordPipelineCreation( std::chrono::duration<double, std::milli>(
+		std::chrono::high_resolution_clock::now() - createStart ).count() );
 }
 
 void Pipeline::createShaderModule( 
@@ -25,6 +25,17 @@ struct PipelineConfigInfo
 	uint32_t subpass = 0;
 };
 
+struct ComputePipelineConfigInfo
+{
+	std::vector<VkDescriptorSetLayout> descriptorSetLayouts{};
+	std::vector<VkPushConstantRange> pushConstantRanges{};
+
+	//Has to match local_size in the shader, Dispatch rounds the thread count up to whole groups
+	uint32_t localSizeX = 64;
+	uint32_t localSizeY = 1;
+	uint32_t localSizeZ = 1;
+};
+
 class Pipeline
 {
 public:
@@ -33,6 +44,11 @@ public:
 		const std::string& fragFile, 
 		const PipelineConfigInfo& pipelineInfo );
 
+	//Compute pipeline, creates and owns its own layout
+	Pipeline(EngineDevice& device,
+		const std::string& compFile,
+		const ComputePipelineConfigInfo& computeInfo );
+
 	~Pipeline();
 
 	Pipeline(const Pipeline&) = delete;
@@ -41,6 +57,13 @@ public:
 	static void defaultPipelineConfigInfo(PipelineConfigInfo& configInfo);
 
 	void Bind(VkCommandBuffer commandBuffer);
+	//Number of threads, not groups
+	void Dispatch(VkCommandBuffer commandBuffer,
+		uint32_t threadCountX, uint32_t threadCountY = 1, uint32_t threadCountZ = 1 );
+
+	bool IsCompute() const { return m_BindPoint == VK_PIPELINE_BIND_POINT_COMPUTE; }
+	//Only set for compute pipelines, graphics pipelines use the layout of their config
+	VkPipelineLayout GetPipelineLayout() const { return m_PipelineLayout; }
 
 private:
 	static std::vector<char> readFile(const std::string& file);
@@ -50,12 +73,21 @@ private:
 		const std::string& fragFile,
 		const PipelineConfigInfo& pipelineInfo );
 
+	void createComputePipeline(
+		const std::string& compFile,
+		const ComputePipelineConfigInfo& computeInfo );
+
 	void createShaderModule(
 		const std::vector<char>& code, 
 		VkShaderModule* shaderModule);
 
 	EngineDevice& m_Device;
-	VkPipeline m_GraphicsPipeline;
-	VkShaderModule m_VertShaderModule;
-	VkShaderModule m_FragShaderModule;
+	VkPipeline m_Pipeline = VK_NULL_HANDLE;
+	VkPipelineBindPoint m_BindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	VkShaderModule m_VertShaderModule = VK_NULL_HANDLE;
+	VkShaderModule m_FragShaderModule = VK_NULL_HANDLE;
+
+	VkShaderModule m_CompShaderModule = VK_NULL_HANDLE;
+	VkPipelineLayout m_PipelineLayout = VK_NULL_HANDLE;
+	uint32_t m_LocalSize[ 3 ] = { 1, 1, 1 };
 };
\ No newline at end of file
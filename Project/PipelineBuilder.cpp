@@ -0,0 +1,81 @@
+#include "PipelineBuilder.h"
+#include "Profiler.h"
+
+PipelineBuilder::PipelineBuilder( EngineDevice& device, JobSystem& jobSystem )
+    : m_Device{ device },
+    m_JobSystem{ jobSystem }
+{
+}
+
+PipelineBuilder::~PipelineBuilder()
+{
+    WaitIdle();
+}
+
+template<typename Function>
+PipelineFuture PipelineBuilder::SubmitTask( Function&& build )
+{
+    if ( !m_Batch.IsValid() )
+    {
+        m_Batch = m_JobSystem.CreateJob( nullptr );
+    }
+
+    //Jobs have to be copyable, so the promise is shared
+    auto promise = std::make_shared<std::promise<std::unique_ptr<Pipeline>>>();
+    PipelineFuture future = promise->get_future();
+
+    m_JobSystem.Run( m_JobSystem.CreateChildJob( m_Batch, [ promise, build = std::forward<Function>( build ) ]()
+        {
+            PROFILE_SCOPE( "PipelineBuilder::Build" );
+            //Build errors go to the future, not to the batch
+            try
+            {
+                promise->set_value( build() );
+            }
+            catch ( ... )
+            {
+                promise->set_exception( std::current_exception() );
+            }
+        } ) );
+    return future;
+}
+
+PipelineFuture PipelineBuilder::Submit( const std::string& vertFile, const std::string& fragFile,
+    ConfigureFunction configure )
+{
+    return SubmitTask( [ this, vertFile, fragFile, configure = std::move( configure ) ]()
+        {
+            PipelineConfigInfo pipelineConfig{};
+            Pipeline::defaultPipelineConfigInfo( pipelineConfig );
+            configure( pipelineConfig );
+            return std::make_unique<Pipeline>( m_Device, vertFile, fragFile, pipelineConfig );
+        } );
+}
+
+PipelineFuture PipelineBuilder::SubmitCompute( const std::string& compFile, ComputePipelineConfigInfo computeInfo )
+{
+    return SubmitTask( [ this, compFile, computeInfo = std::move( computeInfo ) ]()
+        {
+            return std::make_unique<Pipeline>( m_Device, compFile, computeInfo );
+        } );
+}
+
+void PipelineBuilder::WaitIdle()
+{
+    if ( !m_Batch.IsValid() )
+    {
+        return;
+    }
+
+    m_JobSystem.Run( m_Batch );
+    m_JobSystem.Wait( m_Batch );
+    m_Batch = JobSystem::JobHandle{};
+}
+
+void PipelineBuilder::Resolve( PipelineFuture& future, std::unique_ptr<Pipeline>& pipeline )
+{
+    if ( future.valid() )
+    {
+        pipeline = future.get();
+    }
+}
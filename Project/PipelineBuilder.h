@@ -0,0 +1,45 @@
+#pragma once
+#include <string>
+#include <memory>
+#include <future>
+#include <functional>
+#include "Pipeline.h"
+#include "JobSystem.h"
+
+using PipelineFuture = std::future<std::unique_ptr<Pipeline>>;
+
+//Builds pipelines as jobs: SPIR-V reading, shader modules and vkCreate*Pipelines all run off the main thread.
+//Vulkan allows concurrent pipeline creation and the device pipeline cache synchronizes itself,
+//so startup stays close to the slowest single pipeline instead of the sum of all of them.
+//Submit and WaitIdle are meant for one thread, the builds themselves run on the engine JobSystem.
+class PipelineBuilder
+{
+public:
+    //Runs on the worker after defaultPipelineConfigInfo, PipelineConfigInfo points into itself so it can't be passed by value
+    using ConfigureFunction = std::function<void( PipelineConfigInfo& )>;
+
+    explicit PipelineBuilder( EngineDevice& device, JobSystem& jobSystem = JobSystem::Get() );
+    ~PipelineBuilder();
+
+    PipelineBuilder( const PipelineBuilder& ) = delete;
+    PipelineBuilder& operator=( const PipelineBuilder& ) = delete;
+
+    PipelineFuture Submit( const std::string& vertFile, const std::string& fragFile, ConfigureFunction configure );
+    PipelineFuture SubmitCompute( const std::string& compFile, ComputePipelineConfigInfo computeInfo );
+
+    //Helps building until everything submitted so far is done
+    void WaitIdle();
+
+    //Takes the pipeline out of the future the first time, blocking if it is still being built. Rethrows build errors
+    static void Resolve( PipelineFuture& future, std::unique_ptr<Pipeline>& pipeline );
+
+private:
+    template<typename Function>
+    PipelineFuture SubmitTask( Function&& build );
+
+    EngineDevice& m_Device;
+    JobSystem& m_JobSystem;
+
+    //Every build is a child of this job, it only runs once WaitIdle waits on it
+    JobSystem::JobHandle m_Batch;
+};
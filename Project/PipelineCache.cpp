@@ -0,0 +1,137 @@
+#include "PipelineCache.h"
+#include "EngineDevice.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <stdexcept>
+
+//Layout of the header every driver puts in front of its cache data (VK_PIPELINE_CACHE_HEADER_VERSION_ONE)
+struct PipelineCacheHeader
+{
+    uint32_t headerSize;
+    uint32_t headerVersion;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint8_t pipelineCacheUUID[ VK_UUID_SIZE ];
+};
+
+PipelineCache::PipelineCache( EngineDevice& device, const std::string& file )
+    : m_Device{ device },
+    m_File{ file }
+{
+    std::vector<char> data;
+    {
+        std::ifstream fileStream{ m_File, std::ios::ate | std::ios::binary };
+        if ( fileStream.is_open() )
+        {
+            data.resize( static_cast< size_t >( fileStream.tellg() ) );
+            fileStream.seekg( 0 );
+            fileStream.read( data.data(), data.size() );
+            if ( !fileStream.good() )
+            {
+                data.clear();
+            }
+        }
+    }
+
+    if ( !data.empty() && !IsCompatible( data ) )
+    {
+        std::cout << "Pipeline cache " << m_File << " is from another driver or device, starting cold" << std::endl;
+        data.clear();
+    }
+
+    VkPipelineCacheCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.initialDataSize = data.size();
+    createInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+    if ( vkCreatePipelineCache( m_Device.Device(), &createInfo, nullptr, &m_Cache ) != VK_SUCCESS )
+    {
+        //The driver can still refuse data that passed the header check, retry without it
+        createInfo.initialDataSize = 0;
+        createInfo.pInitialData = nullptr;
+        data.clear();
+        if ( vkCreatePipelineCache( m_Device.Device(), &createInfo, nullptr, &m_Cache ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to create pipeline cache!" );
+        }
+    }
+
+    m_Stats.warmStart = !data.empty();
+    m_Stats.loadedBytes = data.size();
+}
+
+PipelineCache::~PipelineCache()
+{
+    Save();
+    vkDestroyPipelineCache( m_Device.Device(), m_Cache, nullptr );
+}
+
+bool PipelineCache::IsCompatible( const std::vector<char>& data ) const
+{
+    if ( data.size() < sizeof( PipelineCacheHeader ) )
+    {
+        return false;
+    }
+
+    PipelineCacheHeader header;
+    std::memcpy( &header, data.data(), sizeof( PipelineCacheHeader ) );
+
+    const VkPhysicalDeviceProperties& properties = m_Device.properties;
+    return header.headerSize >= sizeof( PipelineCacheHeader ) &&
+        header.headerSize <= data.size() &&
+        header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+        header.vendorID == properties.vendorID &&
+        header.deviceID == properties.deviceID &&
+        std::memcmp( header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE ) == 0;
+}
+
+bool PipelineCache::Save() const
+{
+    size_t size = 0;
+    if ( vkGetPipelineCacheData( m_Device.Device(), m_Cache, &size, nullptr ) != VK_SUCCESS || size == 0 )
+    {
+        return false;
+    }
+
+    std::vector<char> data( size );
+    if ( vkGetPipelineCacheData( m_Device.Device(), m_Cache, &size, data.data() ) != VK_SUCCESS )
+    {
+        return false;
+    }
+
+    //Same as the mesh cache: never leave a half written file behind
+    const std::string tempFile = m_File + ".tmp";
+    {
+        std::ofstream file{ tempFile, std::ios::binary | std::ios::trunc };
+        file.write( data.data(), size );
+        if ( !file.good() )
+        {
+            std::cout << "Could not write pipeline cache: " << m_File << std::endl;
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename( tempFile, m_File, error );
+    if ( error )
+    {
+        std::filesystem::remove( tempFile, error );
+        return false;
+    }
+    return true;
+}
+
+void PipelineCache::RecordPipelineCreation( double milliseconds )
+{
+    std::lock_guard<std::mutex> lock{ m_StatsMutex };
+    m_Stats.pipelineCount++;
+    m_Stats.creationTime += milliseconds;
+}
+
+PipelineCache::Stats PipelineCache::GetStats() const
+{
+    std::lock_guard<std::mutex> lock{ m_StatsMutex };
+    return m_Stats;
+}
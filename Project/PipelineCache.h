@@ -0,0 +1,48 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <string>
+#include <vector>
+#include <mutex>
+
+class EngineDevice;
+
+//Device wide VkPipelineCache, loaded from disk on startup and written back when it is destroyed.
+//A file from another driver or gpu is thrown away, the header has to match vendorID, deviceID and pipelineCacheUUID.
+class PipelineCache
+{
+public:
+    static constexpr const char* DEFAULT_FILE = "pipeline_cache.bin";
+
+    struct Stats
+    {
+        bool warmStart = false;         //A valid cache file was found
+        size_t loadedBytes = 0;
+        uint32_t pipelineCount = 0;
+        double creationTime = 0.0;      //ms spent in vkCreate*Pipelines since startup
+    };
+
+    explicit PipelineCache( EngineDevice& device, const std::string& file = DEFAULT_FILE );
+    ~PipelineCache();
+
+    PipelineCache( const PipelineCache& ) = delete;
+    PipelineCache& operator=( const PipelineCache& ) = delete;
+
+    VkPipelineCache GetHandle() const { return m_Cache; }
+
+    //Writes the current contents to disk, also done by the destructor
+    bool Save() const;
+
+    //Pipelines report how long their creation took, can be called from any thread
+    void RecordPipelineCreation( double milliseconds );
+    Stats GetStats() const;
+
+private:
+    bool IsCompatible( const std::vector<char>& data ) const;
+
+    EngineDevice& m_Device;
+    const std::string m_File;
+    VkPipelineCache m_Cache = VK_NULL_HANDLE;
+
+    mutable std::mutex m_StatsMutex;
+    Stats m_Stats;
+};
@@ -0,0 +1,113 @@
+#include "Profiler.h"
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+static const std::chrono::steady_clock::time_point g_ProfilerEpoch = std::chrono::steady_clock::now();
+
+Profiler& Profiler::Get()
+{
+    static Profiler profiler{};
+    return profiler;
+}
+
+uint64_t Profiler::Now()
+{
+    return static_cast< uint64_t >( std::chrono::duration_cast< std::chrono::nanoseconds >(
+        std::chrono::steady_clock::now() - g_ProfilerEpoch ).count() );
+}
+
+void Profiler::Record( const char* name, uint64_t startNs, uint64_t durationNs )
+{
+    ThreadBuffer& buffer = GetThreadBuffer();
+
+    const uint32_t index = buffer.count.load( std::memory_order_relaxed );
+    const uint32_t chunk = index / EVENTS_PER_CHUNK;
+    if ( chunk >= MAX_CHUNKS_PER_THREAD )
+    {
+        m_DroppedEvents.fetch_add( 1, std::memory_order_relaxed );
+        return;
+    }
+    if ( !buffer.chunks[ chunk ] )
+    {
+        buffer.chunks[ chunk ].reset( new Event[ EVENTS_PER_CHUNK ] );
+    }
+
+    buffer.chunks[ chunk ][ index % EVENTS_PER_CHUNK ] = Event{ name, startNs, durationNs };
+    buffer.count.store( index + 1, std::memory_order_release );
+}
+
+void Profiler::SetThreadName( const std::string& name )
+{
+    ThreadBuffer& buffer = GetThreadBuffer();
+    std::lock_guard<std::mutex> lock{ m_RegisterMutex };
+    buffer.threadName = name;
+}
+
+Profiler::ThreadBuffer& Profiler::GetThreadBuffer()
+{
+    //Buffers are never freed, so the cached pointer stays valid for the whole thread
+    thread_local ThreadBuffer* threadBuffer = nullptr;
+    if ( threadBuffer == nullptr )
+    {
+        std::lock_guard<std::mutex> lock{ m_RegisterMutex };
+        m_Buffers.push_back( std::make_unique<ThreadBuffer>() );
+        threadBuffer = m_Buffers.back().get();
+        threadBuffer->threadId = static_cast< uint32_t >( m_Buffers.size() );
+    }
+    return *threadBuffer;
+}
+
+void Profiler::WriteChromeTrace( const std::string& file )
+{
+    std::ofstream output{ file };
+    if ( !output.is_open() )
+    {
+        throw std::runtime_error( "Failed to write profiler trace: " + file );
+    }
+
+    std::lock_guard<std::mutex> lock{ m_RegisterMutex };
+
+    //Complete ("X") events in microseconds, the viewer nests them by time per thread
+    output << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    size_t eventCount = 0;
+    for ( const auto& buffer : m_Buffers )
+    {
+        if ( !buffer->threadName.empty() )
+        {
+            output << ( first ? "" : "," ) << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+                << buffer->threadId << ",\"args\":{\"name\":\"" << buffer->threadName << "\"}}";
+            first = false;
+        }
+
+        const uint32_t count = buffer->count.load( std::memory_order_acquire );
+        for ( uint32_t i = 0; i < count; i++ )
+        {
+            const Event& event = buffer->chunks[ i / EVENTS_PER_CHUNK ][ i % EVENTS_PER_CHUNK ];
+            output << ( first ? "" : "," ) << "\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+                << buffer->threadId << ",\"ts\":" << event.startNs / 1000 << "." << event.startNs % 1000 / 100
+                << ",\"dur\":" << event.durationNs / 1000 << "." << event.durationNs % 1000 / 100 << "}";
+            first = false;
+        }
+        eventCount += count;
+    }
+    output << "\n]}" << std::endl;
+
+    std::cout << "profiler: wrote " << eventCount << " events to " << file;
+    if ( GetDroppedEventCount() > 0 )
+    {
+        std::cout << ", " << GetDroppedEventCount() << " events were dropped";
+    }
+    std::cout << std::endl;
+}
+
+void Profiler::Clear()
+{
+    std::lock_guard<std::mutex> lock{ m_RegisterMutex };
+    for ( auto& buffer : m_Buffers )
+    {
+        buffer->count.store( 0, std::memory_order_relaxed );
+    }
+    m_DroppedEvents.store( 0, std::memory_order_relaxed );
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//Hierarchical cpu timings for the frame loop, written out as a chrome://tracing / Perfetto json.
+//Every thread records into its own buffer, so a scope costs two clock reads and one store, no locks.
+//Build with ENABLE_PROFILER to get the PROFILE_ macros, without it they expand to nothing.
+class Profiler
+{
+public:
+    //Buffers grow a chunk at a time, so short lived loader threads stay cheap.
+    //Events past the last chunk are dropped, long runs should dump or Clear in between
+    static constexpr uint32_t EVENTS_PER_CHUNK = 4096;
+    static constexpr uint32_t MAX_CHUNKS_PER_THREAD = 64;
+
+    struct Event
+    {
+        const char* name;       //Has to outlive the profiler, string literals and __FUNCTION__ do
+        uint64_t startNs;
+        uint64_t durationNs;
+    };
+
+    //Records the time between its construction and destruction
+    class ScopedEvent
+    {
+    public:
+        explicit ScopedEvent( const char* name ) : m_Name{ name }, m_Start{ Now() } {}
+        ~ScopedEvent() { Get().Record( m_Name, m_Start, Now() - m_Start ); }
+
+        ScopedEvent( const ScopedEvent& ) = delete;
+        ScopedEvent& operator=( const ScopedEvent& ) = delete;
+
+    private:
+        const char* m_Name;
+        uint64_t m_Start;
+    };
+
+    static Profiler& Get();
+
+    //Nanoseconds since the profiler was created
+    static uint64_t Now();
+
+    void Record( const char* name, uint64_t startNs, uint64_t durationNs );
+    //Shows up as the thread name in the trace viewer
+    void SetThreadName( const std::string& name );
+
+    //Only call when no other thread is recording
+    void WriteChromeTrace( const std::string& file );
+    void Clear();
+
+    uint64_t GetDroppedEventCount() const { return m_DroppedEvents.load( std::memory_order_relaxed ); }
+
+private:
+    struct ThreadBuffer
+    {
+        uint32_t threadId = 0;
+        std::string threadName;
+        std::unique_ptr<Event[]> chunks[ MAX_CHUNKS_PER_THREAD ];
+        //Only the owning thread writes it, release so a dump sees the events it counts
+        std::atomic<uint32_t> count{ 0 };
+    };
+
+    Profiler() = default;
+    ThreadBuffer& GetThreadBuffer();
+
+    std::mutex m_RegisterMutex;     //Only taken the first time a thread records
+    std::vector<std::unique_ptr<ThreadBuffer>> m_Buffers;
+    std::atomic<uint64_t> m_DroppedEvents{ 0 };
+};
+
+#if defined( ENABLE_PROFILER )
+    #define PROFILE_CONCAT_INNER( a, b ) a##b
+    #define PROFILE_CONCAT( a, b ) PROFILE_CONCAT_INNER( a, b )
+    #define PROFILE_SCOPE( name ) Profiler::ScopedEvent PROFILE_CONCAT( profileScope, __LINE__ ){ name }
+    #define PROFILE_FUNCTION() PROFILE_SCOPE( __FUNCTION__ )
+    #define PROFILE_THREAD_NAME( name ) Profiler::Get().SetThreadName( name )
+#else
+    #define PROFILE_SCOPE( name )
+    #define PROFILE_FUNCTION()
+    #define PROFILE_THREAD_NAME( name )
+#endif
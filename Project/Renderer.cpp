@@ -4,22 +4,61 @@
 #include <array>
 #include "Window.h"
 #include <iostream>
-#include "GameObject.h"
 #include <glm/gtc/constants.hpp>
+#include "Profiler.h"
 
 Renderer::Renderer( Window& window, EngineDevice& engineDevice )
 	: m_Window{ window }, m_EngineDevice{ engineDevice }
 {
-	RecreateSwapChain();
+	if ( m_Window.IsHeadless() )
+	{
+		m_Offscreen = std::make_unique<OffscreenTarget>( m_EngineDevice, m_Window.GetExtent() );
+	}
+	else
+	{
+		RecreateSwapChain();
+	}
 	CreateCommandBuffers();
+	m_GpuProfiler = std::make_unique<GpuProfiler>( m_EngineDevice );
 }
 
 
 Renderer::~Renderer()
 {
+	//Lets the offscreen target write out the captures that are still in flight
+	vkDeviceWaitIdle( m_EngineDevice.Device() );
+	m_Offscreen.reset();
+
+	m_ParallelRecorder.reset();
+	m_GpuProfiler.reset();
 	FreeCommandBuffers();
 }
 
+void Renderer::CaptureFrame( const std::string& file )
+{
+	assert( m_FrameStarted && "Cannot capture a frame that is not in progress" );
+	if ( !m_Offscreen )
+	{
+		std::cout << "Frame captures are only supported in headless mode" << std::endl;
+		return;
+	}
+	m_PendingCapture = file;
+}
+
+ParallelRecorder& Renderer::GetParallelRecorder()
+{
+	if ( !m_ParallelRecorder )
+	{
+		m_ParallelRecorder = std::make_unique<ParallelRecorder>( m_EngineDevice );
+	}
+	return *m_ParallelRecorder;
+}
+
+VkExtent2D Renderer::GetRenderExtent() const
+{
+	return m_Offscreen ? m_Offscreen->GetExtent() : m_SwapChain->getSwapChainExtent();
+}
+
 void Renderer::RecreateSwapChain()
 {
 	auto extend = m_Window.GetExtent();
@@ -78,19 +117,29 @@ void Renderer::FreeCommandBuffers()
 
 VkCommandBuffer Renderer::BeginFrame()
 {
+	PROFILE_FUNCTION();
 	assert( !m_FrameStarted && "Cannot call BeginFrame while frame is in progress" );
-	
-	auto result = m_SwapChain->acquireNextImage( 
-		&m_CurrentImageIndex );
 
-	if ( result == VK_ERROR_OUT_OF_DATE_KHR || result != VK_SUCCESS )
+	if ( m_Offscreen )
 	{
-		RecreateSwapChain();
-		return nullptr;
+		//One image per frame in flight, waiting on it is the only thing acquiring does
+		m_Offscreen->AcquireFrame( m_CurrentFrameIndex );
+		m_CurrentImageIndex = static_cast< uint32_t >( m_CurrentFrameIndex );
 	}
+	else
+	{
+		auto result = m_SwapChain->acquireNextImage( 
+			&m_CurrentImageIndex );
+
+		if ( result == VK_ERROR_OUT_OF_DATE_KHR || result != VK_SUCCESS )
+		{
+			RecreateSwapChain();
+			return nullptr;
+		}
 
-	if ( result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR ) {
-		throw std::runtime_error( "failed to acquire swap chain image!" );
+		if ( result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR ) {
+			throw std::runtime_error( "failed to acquire swap chain image!" );
+		}
 	}
 
 	m_FrameStarted = true;
@@ -106,20 +155,49 @@ VkCommandBuffer Renderer::BeginFrame()
 		throw std::runtime_error( "Failed to begin recording command buffer!" );
 	}
 
+	//The fence of this frame was waited on while acquiring, so its old timestamps are in
+	m_GpuProfiler->BeginFrame( commandBuffer, m_CurrentFrameIndex );
+	m_FrameScope = m_GpuProfiler->BeginScope( commandBuffer, "Frame" );
+
 	return commandBuffer;
 }
 
 void Renderer::EndFrame()
 {
+	PROFILE_FUNCTION();
 	assert( m_FrameStarted && "Cannot call EndFrame while frame is not in progress" );
 	
 	auto commandBuffer = GetCurrentCommandBuffer();
 
+	if ( m_Offscreen && !m_PendingCapture.empty() )
+	{
+		m_Offscreen->RecordReadback( commandBuffer, m_CurrentFrameIndex, m_PendingCapture );
+		m_PendingCapture.clear();
+	}
+
+	m_GpuProfiler->EndScope( commandBuffer, m_FrameScope );
+
 	if ( vkEndCommandBuffer( commandBuffer ) != VK_SUCCESS )
 	{
 		throw std::runtime_error( "Failed to record command buffer!" );
 	}
 
+	//Uploads recorded this frame have to reach the queue before the draws that use them
+	m_EngineDevice.GetUploadQueue().Submit();
+
+	if ( m_Offscreen )
+	{
+		if ( m_Offscreen->Submit( commandBuffer, m_CurrentFrameIndex ) != VK_SUCCESS )
+		{
+			throw std::runtime_error( "Failed to submit command buffer!" );
+		}
+
+		m_FrameStarted = false;
+		m_CurrentFrameIndex = ( m_CurrentFrameIndex + 1 ) 
+			% SwapChain::MAX_FRAMES_IN_FLIGHT;
+		return;
+	}
+
 	auto result = m_SwapChain->submitCommandBuffers(
 		&commandBuffer, &m_CurrentImageIndex );
 
@@ -140,7 +218,7 @@ void Renderer::EndFrame()
 		% SwapChain::MAX_FRAMES_IN_FLIGHT;
 }
 
-void Renderer::BeginSwapChainRenderPass( VkCommandBuffer commandBuffer )
+void Renderer::BeginSwapChainRenderPass( VkCommandBuffer commandBuffer, VkSubpassContents contents )
 {
 	assert( m_FrameStarted && 
 		"Cannot begin render pass when frame not started" );
@@ -149,10 +227,12 @@ void Renderer::BeginSwapChainRenderPass( VkCommandBuffer commandBuffer )
 
 	VkRenderPassBeginInfo renderPassInfo{};
 	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-	renderPassInfo.renderPass = m_SwapChain->getRenderPass();
-	renderPassInfo.framebuffer = m_SwapChain->getFrameBuffer( m_CurrentImageIndex );
+	renderPassInfo.renderPass = GetSwapChainRenderPass();
+	renderPassInfo.framebuffer = m_Offscreen ? 
+		m_Offscreen->GetFrameBuffer( m_CurrentFrameIndex ) : 
+		m_SwapChain->getFrameBuffer( m_CurrentImageIndex );
 	renderPassInfo.renderArea.offset = { 0, 0 };
-	renderPassInfo.renderArea.extent = m_SwapChain->getSwapChainExtent();
+	renderPassInfo.renderArea.extent = GetRenderExtent();
 
 	std::array<VkClearValue, 2> clearValues{};
 	clearValues[ 0 ].color = { 0.0118f, 0.5412f, 1.0f, 1.0f };
@@ -160,19 +240,27 @@ void Renderer::BeginSwapChainRenderPass( VkCommandBuffer commandBuffer )
 	renderPassInfo.clearValueCount = static_cast< uint32_t >( clearValues.size() );
 	renderPassInfo.pClearValues = clearValues.data();
 
+	m_RenderPassScope = m_GpuProfiler->BeginScope( commandBuffer, "RenderPass" );
 	vkCmdBeginRenderPass( commandBuffer, &renderPassInfo,
-		VK_SUBPASS_CONTENTS_INLINE );
+		contents );
+
+	if ( contents == VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS )
+	{
+		//The primary may only execute secondaries now, they set their own viewport and scissor
+		GetParallelRecorder().BeginRenderPass( m_CurrentFrameIndex,
+			renderPassInfo.renderPass, renderPassInfo.framebuffer, renderPassInfo.renderArea.extent );
+		return;
+	}
 
 	VkViewport viewport{};
 	viewport.x = 0.0f;
 	viewport.y = 0.0f;
-	viewport.width = static_cast< float >
-		( m_SwapChain->getSwapChainExtent().width );
-	viewport.height = static_cast< float >
-		( m_SwapChain->getSwapChainExtent().height );
+	const VkExtent2D extent = GetRenderExtent();
+	viewport.width = static_cast< float >( extent.width );
+	viewport.height = static_cast< float >( extent.height );
 	viewport.minDepth = 0.0f;
 	viewport.maxDepth = 1.0f;
-	VkRect2D scissor{ {0,0},m_SwapChain->getSwapChainExtent() };
+	VkRect2D scissor{ {0,0},extent };
 
 	vkCmdSetViewport( commandBuffer, 0, 1, &viewport );
 	vkCmdSetScissor( commandBuffer, 0, 1, &scissor );
@@ -186,6 +274,7 @@ void Renderer::EndSwapChainRenderPass( VkCommandBuffer commandBuffer )
 		commandBuffer == GetCurrentCommandBuffer() &&
 		"Can't end render pass on command buffer from a different frame" );
 	vkCmdEndRenderPass( commandBuffer );
+	m_GpuProfiler->EndScope( commandBuffer, m_RenderPassScope );
 }
 
 
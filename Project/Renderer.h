@@ -4,6 +4,9 @@
 #include "Window.h"
 #include "EngineDevice.h"
 #include "SwapChain.h"
+#include "OffscreenTarget.h"
+#include "GpuProfiler.h"
+#include "ParallelRecorder.h"
 #include "Model.h"
 #include <cassert>
 
@@ -31,13 +34,33 @@ public:
         return m_CommandBuffers[ m_CurrentFrameIndex ];
     }
 
-    VkRenderPass GetSwapChainRenderPass() const { return m_SwapChain->getRenderPass(); }
-    float GetAspectRatio() const { return m_SwapChain->extentAspectRatio(); }
+    VkRenderPass GetSwapChainRenderPass() const 
+    { 
+        return m_Offscreen ? m_Offscreen->GetRenderPass() : m_SwapChain->getRenderPass(); 
+    }
+    float GetAspectRatio() const 
+    { 
+        return m_Offscreen ? m_Offscreen->GetAspectRatio() : m_SwapChain->extentAspectRatio(); 
+    }
+    bool IsHeadless() const { return m_Offscreen != nullptr; }
+
+    //Copies the current frame to a ppm file once it is done rendering, headless only
+    void CaptureFrame( const std::string& file );
+
+    GpuProfiler& GetGpuProfiler() { return *m_GpuProfiler; }
+    //Gpu time of the last frame that was read back in ms, stays 0 when the queue has no timestamps
+    float GetGpuFrameTime() const { return m_GpuProfiler->GetLatest( "Frame" ); }
+
+    //Created on first use, so runs that record inline don't start its threads
+    ParallelRecorder& GetParallelRecorder();
 
     VkCommandBuffer BeginFrame();
     void EndFrame();
+    //With VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS everything inside the pass goes through GetParallelRecorder,
+    //and its Execute has to be called before EndSwapChainRenderPass
     void BeginSwapChainRenderPass( 
-        VkCommandBuffer commandBuffer );
+        VkCommandBuffer commandBuffer,
+        VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE );
     void EndSwapChainRenderPass(
         VkCommandBuffer commandBuffer );
 
@@ -45,13 +68,22 @@ private:
     void CreateCommandBuffers();
     void FreeCommandBuffers();
     void RecreateSwapChain();
+    VkExtent2D GetRenderExtent() const;
 
     Window& m_Window;
     EngineDevice& m_EngineDevice;
     std::unique_ptr < SwapChain> m_SwapChain;
+    //Takes the place of the swap chain when the window is headless
+    std::unique_ptr<OffscreenTarget> m_Offscreen;
+    std::string m_PendingCapture;
 
     std::vector<VkCommandBuffer> m_CommandBuffers;
 
+    std::unique_ptr<GpuProfiler> m_GpuProfiler;
+    std::unique_ptr<ParallelRecorder> m_ParallelRecorder;
+    uint32_t m_FrameScope = GpuProfiler::INVALID_QUERY;
+    uint32_t m_RenderPassScope = GpuProfiler::INVALID_QUERY;
+
     uint32_t m_CurrentImageIndex;
     int m_CurrentFrameIndex = 0;
     bool m_FrameStarted = false;
@@ -0,0 +1,421 @@
+#include "Scene.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <stdexcept>
+#include <glm/gtc/matrix_inverse.hpp>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+    #include <emmintrin.h>
+    #define SCENE_USE_SSE 1
+#endif
+
+//Below this the transform update isn't worth handing to other threads
+static constexpr uint32_t MIN_TRANSFORMS_PER_JOB = 512;
+
+#if defined( SCENE_USE_SSE )
+//Four sines and cosines at once, Cephes style: reduce to [-pi/4, pi/4] around the nearest multiple of pi/2,
+//evaluate both polynomials and pick/negate per quadrant. Within a few ulp of std::sin/cos for game sized angles
+static void SinCos4( __m128 x, __m128& sine, __m128& cosine )
+{
+    const __m128i quadrant = _mm_cvtps_epi32( _mm_mul_ps( x, _mm_set1_ps( 0.636619772367581f ) ) );
+    const __m128 q = _mm_cvtepi32_ps( quadrant );
+
+    //pi/2 in three parts, so the subtraction stays exact for larger angles
+    __m128 r = _mm_sub_ps( x, _mm_mul_ps( q, _mm_set1_ps( 1.5703125f ) ) );
+    r = _mm_sub_ps( r, _mm_mul_ps( q, _mm_set1_ps( 4.837512969970703125e-4f ) ) );
+    r = _mm_sub_ps( r, _mm_mul_ps( q, _mm_set1_ps( 7.54978995489188216e-8f ) ) );
+    const __m128 r2 = _mm_mul_ps( r, r );
+
+    __m128 s = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( -1.9515295891e-4f ), r2 ), _mm_set1_ps( 8.3321608736e-3f ) );
+    s = _mm_add_ps( _mm_mul_ps( s, r2 ), _mm_set1_ps( -1.6666654611e-1f ) );
+    s = _mm_add_ps( _mm_mul_ps( _mm_mul_ps( s, r2 ), r ), r );
+
+    __m128 c = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( 2.443315711809948e-5f ), r2 ), _mm_set1_ps( -1.388731625493765e-3f ) );
+    c = _mm_add_ps( _mm_mul_ps( c, r2 ), _mm_set1_ps( 4.166664568298827e-2f ) );
+    c = _mm_add_ps( _mm_mul_ps( _mm_mul_ps( c, r2 ), r2 ), _mm_sub_ps( _mm_set1_ps( 1.f ), _mm_mul_ps( r2, _mm_set1_ps( 0.5f ) ) ) );
+
+    //Odd quadrants swap sine and cosine, quadrants 2 and 3 negate the sine, 1 and 2 the cosine
+    const __m128 swap = _mm_castsi128_ps( _mm_cmpeq_epi32( _mm_and_si128( quadrant, _mm_set1_epi32( 1 ) ), _mm_set1_epi32( 1 ) ) );
+    const __m128 sineSign = _mm_castsi128_ps( _mm_slli_epi32( _mm_and_si128( quadrant, _mm_set1_epi32( 2 ) ), 30 ) );
+    const __m128 cosineSign = _mm_castsi128_ps( _mm_slli_epi32(
+        _mm_and_si128( _mm_add_epi32( quadrant, _mm_set1_epi32( 1 ) ), _mm_set1_epi32( 2 ) ), 30 ) );
+
+    sine = _mm_xor_ps( _mm_or_ps( _mm_and_ps( swap, c ), _mm_andnot_ps( swap, s ) ), sineSign );
+    cosine = _mm_xor_ps( _mm_or_ps( _mm_and_ps( swap, s ), _mm_andnot_ps( swap, c ) ), cosineSign );
+}
+
+//TransformComponent::mat4 and normalMatrix for four transforms, the inputs are gathered into SoA registers
+static void ComputeMatrices4( const TransformComponent* transforms[ 4 ], glm::mat4* localMatrices[ 4 ], glm::mat4* normalMatrices[ 4 ] )
+{
+    auto gather = [ & ]( size_t offset )
+        {
+            auto component = [ & ]( int lane )
+                {
+                    return *( reinterpret_cast< const float* >( transforms[ lane ] ) + offset );
+                };
+            return _mm_setr_ps( component( 0 ), component( 1 ), component( 2 ), component( 3 ) );
+        };
+    const size_t translation = offsetof( TransformComponent, translation ) / sizeof( float );
+    const size_t scale = offsetof( TransformComponent, scale ) / sizeof( float );
+    const size_t rotation = offsetof( TransformComponent, rotation ) / sizeof( float );
+
+    __m128 s1, c1, s2, c2, s3, c3;
+    SinCos4( gather( rotation + 1 ), s1, c1 );
+    SinCos4( gather( rotation + 0 ), s2, c2 );
+    SinCos4( gather( rotation + 2 ), s3, c3 );
+
+    //Rotation part, column major, same terms as TransformComponent::mat4
+    __m128 rotationTerms[ 9 ];
+    rotationTerms[ 0 ] = _mm_add_ps( _mm_mul_ps( c1, c3 ), _mm_mul_ps( _mm_mul_ps( s1, s2 ), s3 ) );
+    rotationTerms[ 1 ] = _mm_mul_ps( c2, s3 );
+    rotationTerms[ 2 ] = _mm_sub_ps( _mm_mul_ps( _mm_mul_ps( c1, s2 ), s3 ), _mm_mul_ps( c3, s1 ) );
+    rotationTerms[ 3 ] = _mm_sub_ps( _mm_mul_ps( _mm_mul_ps( c3, s1 ), s2 ), _mm_mul_ps( c1, s3 ) );
+    rotationTerms[ 4 ] = _mm_mul_ps( c2, c3 );
+    rotationTerms[ 5 ] = _mm_add_ps( _mm_mul_ps( _mm_mul_ps( c1, c3 ), s2 ), _mm_mul_ps( s1, s3 ) );
+    rotationTerms[ 6 ] = _mm_mul_ps( c2, s1 );
+    rotationTerms[ 7 ] = _mm_sub_ps( _mm_setzero_ps(), s2 );
+    rotationTerms[ 8 ] = _mm_mul_ps( c1, c2 );
+
+    alignas( 16 ) float local[ 9 ][ 4 ];
+    alignas( 16 ) float normal[ 9 ][ 4 ];
+    alignas( 16 ) float translations[ 3 ][ 4 ];
+    for ( int column = 0; column < 3; column++ )
+    {
+        const __m128 columnScale = gather( scale + column );
+        const __m128 inverseScale = _mm_div_ps( _mm_set1_ps( 1.f ), columnScale );
+        for ( int row = 0; row < 3; row++ )
+        {
+            _mm_store_ps( local[ column * 3 + row ], _mm_mul_ps( rotationTerms[ column * 3 + row ], columnScale ) );
+            _mm_store_ps( normal[ column * 3 + row ], _mm_mul_ps( rotationTerms[ column * 3 + row ], inverseScale ) );
+        }
+        _mm_store_ps( translations[ column ], gather( translation + column ) );
+    }
+
+    for ( int lane = 0; lane < 4; lane++ )
+    {
+        glm::mat4& localMatrix = *localMatrices[ lane ];
+        glm::mat4& normalMatrix = *normalMatrices[ lane ];
+        for ( int column = 0; column < 3; column++ )
+        {
+            localMatrix[ column ] = glm::vec4( local[ column * 3 ][ lane ], local[ column * 3 + 1 ][ lane ], local[ column * 3 + 2 ][ lane ], 0.f );
+            normalMatrix[ column ] = glm::vec4( normal[ column * 3 ][ lane ], normal[ column * 3 + 1 ][ lane ], normal[ column * 3 + 2 ][ lane ], 0.f );
+        }
+        localMatrix[ 3 ] = glm::vec4( translations[ 0 ][ lane ], translations[ 1 ][ lane ], translations[ 2 ][ lane ], 1.f );
+        normalMatrix[ 3 ] = glm::vec4( 0.f, 0.f, 0.f, 1.f );
+    }
+}
+#endif
+
+Entity Scene::CreateEntity( ModelHandle model, const TransformComponent& transform )
+{
+    Entity entity{};
+    if ( !m_FreeIndices.empty() )
+    {
+        entity.index = m_FreeIndices.back();
+        m_FreeIndices.pop_back();
+    }
+    else
+    {
+        entity.index = static_cast< uint32_t >( m_Sparse.size() );
+        m_Sparse.push_back( Entity::INVALID_INDEX );
+        m_Generations.push_back( 0 );
+    }
+    entity.generation = m_Generations[ entity.index ];
+
+    const uint32_t denseIndex = static_cast< uint32_t >( m_Entities.size() );
+    m_Sparse[ entity.index ] = denseIndex;
+    m_Entities.push_back( entity );
+    m_Transforms.push_back( transform );
+    m_Models.push_back( INVALID_MODEL );
+    m_Colors.push_back( glm::vec3{ 1.0f } );
+    m_LocalBounds.push_back( BoundingBox{} );
+    m_Parents.push_back( Entity{} );
+    m_LocalMatrices.push_back( glm::mat4{ 1.f } );
+    m_WorldMatrices.push_back( glm::mat4{ 1.f } );
+    m_NormalMatrices.push_back( glm::mat4{ 1.f } );
+    m_Dirty.push_back( 0 );
+    MarkDirty( denseIndex );
+
+    if ( model != INVALID_MODEL )
+    {
+        SetModel( entity, model );
+    }
+    return entity;
+}
+
+void Scene::DestroyEntity( Entity entity )
+{
+    if ( !IsAlive( entity ) )
+    {
+        return;
+    }
+
+    //Children keep their local transform, it now counts as world space
+    for ( uint32_t i = 0; i < GetEntityCount(); i++ )
+    {
+        if ( m_Parents[ i ] == entity )
+        {
+            m_Parents[ i ] = Entity{};
+            MarkDirty( i );
+            m_HierarchyChanged = true;
+        }
+    }
+    if ( m_Parents[ m_Sparse[ entity.index ] ].IsValid() )
+    {
+        m_HierarchyChanged = true;
+    }
+
+    //Move the last entity into the hole so the arrays stay dense
+    const uint32_t denseIndex = m_Sparse[ entity.index ];
+    const uint32_t lastIndex = GetEntityCount() - 1;
+    if ( denseIndex != lastIndex )
+    {
+        m_Entities[ denseIndex ] = m_Entities[ lastIndex ];
+        m_Transforms[ denseIndex ] = m_Transforms[ lastIndex ];
+        m_Models[ denseIndex ] = m_Models[ lastIndex ];
+        m_Colors[ denseIndex ] = m_Colors[ lastIndex ];
+        m_LocalBounds[ denseIndex ] = m_LocalBounds[ lastIndex ];
+        m_Parents[ denseIndex ] = m_Parents[ lastIndex ];
+        m_LocalMatrices[ denseIndex ] = m_LocalMatrices[ lastIndex ];
+        m_WorldMatrices[ denseIndex ] = m_WorldMatrices[ lastIndex ];
+        m_NormalMatrices[ denseIndex ] = m_NormalMatrices[ lastIndex ];
+        m_Dirty[ denseIndex ] = m_Dirty[ lastIndex ];
+        m_Sparse[ m_Entities[ denseIndex ].index ] = denseIndex;
+    }
+
+    m_Entities.pop_back();
+    m_Transforms.pop_back();
+    m_Models.pop_back();
+    m_Colors.pop_back();
+    m_LocalBounds.pop_back();
+    m_Parents.pop_back();
+    m_LocalMatrices.pop_back();
+    m_WorldMatrices.pop_back();
+    m_NormalMatrices.pop_back();
+    m_Dirty.pop_back();
+
+    m_Sparse[ entity.index ] = Entity::INVALID_INDEX;
+    m_Generations[ entity.index ]++;
+    m_FreeIndices.push_back( entity.index );
+
+    //The world box of the moved entity is still at the old index
+    if ( denseIndex != lastIndex )
+    {
+        MarkDirty( denseIndex );
+    }
+}
+
+bool Scene::IsAlive( Entity entity ) const
+{
+    return entity.index < m_Sparse.size() &&
+        m_Sparse[ entity.index ] != Entity::INVALID_INDEX &&
+        m_Generations[ entity.index ] == entity.generation;
+}
+
+void Scene::Clear()
+{
+    //Generations survive, so old handles stay dead
+    for ( const Entity& entity : m_Entities )
+    {
+        m_Sparse[ entity.index ] = Entity::INVALID_INDEX;
+        m_Generations[ entity.index ]++;
+        m_FreeIndices.push_back( entity.index );
+    }
+
+    m_Entities.clear();
+    m_Transforms.clear();
+    m_Models.clear();
+    m_Colors.clear();
+    m_LocalBounds.clear();
+    m_Parents.clear();
+    m_LocalMatrices.clear();
+    m_WorldMatrices.clear();
+    m_NormalMatrices.clear();
+    m_WorldBounds.Clear();
+    m_Dirty.clear();
+    m_DirtyEntities.clear();
+    m_HierarchyOrder.clear();
+    m_HierarchyChanged = false;
+    m_ModelTable.clear();
+    m_ModelHandles.clear();
+}
+
+uint32_t Scene::GetDenseIndex( Entity entity ) const
+{
+    if ( !IsAlive( entity ) )
+    {
+        throw std::runtime_error( "Entity is not alive!" );
+    }
+    return m_Sparse[ entity.index ];
+}
+
+ModelHandle Scene::AddModel( const std::shared_ptr<Model>& model )
+{
+    if ( model == nullptr )
+    {
+        return INVALID_MODEL;
+    }
+
+    auto [it, inserted] = m_ModelHandles.try_emplace( model.get(), static_cast< ModelHandle >( m_ModelTable.size() ) );
+    if ( inserted )
+    {
+        m_ModelTable.push_back( model );
+    }
+    return it->second;
+}
+
+void Scene::SetModel( Entity entity, ModelHandle model )
+{
+    const uint32_t denseIndex = GetDenseIndex( entity );
+    m_Models[ denseIndex ] = model;
+    m_LocalBounds[ denseIndex ] = model == INVALID_MODEL ? BoundingBox{} : m_ModelTable[ model ]->GetBoundingBox();
+    MarkDirty( denseIndex );
+}
+
+TransformComponent& Scene::EditTransform( Entity entity )
+{
+    const uint32_t denseIndex = GetDenseIndex( entity );
+    MarkDirty( denseIndex );
+    return m_Transforms[ denseIndex ];
+}
+
+void Scene::SetParent( Entity child, Entity parent )
+{
+    const uint32_t childIndex = GetDenseIndex( child );
+    if ( parent.IsValid() )
+    {
+        //Walking up from the new parent must never reach the child
+        for ( Entity ancestor = parent; ancestor.IsValid(); ancestor = m_Parents[ GetDenseIndex( ancestor ) ] )
+        {
+            if ( ancestor == child )
+            {
+                throw std::runtime_error( "Entity can't be its own ancestor!" );
+            }
+        }
+    }
+
+    m_Parents[ childIndex ] = parent;
+    m_HierarchyChanged = true;
+    MarkDirty( childIndex );
+}
+
+void Scene::MarkDirty( uint32_t denseIndex )
+{
+    if ( !m_Dirty[ denseIndex ] )
+    {
+        m_Dirty[ denseIndex ] = 1;
+        m_DirtyEntities.push_back( m_Entities[ denseIndex ] );
+    }
+}
+
+void Scene::RebuildHierarchyOrder()
+{
+    std::vector<std::pair<uint32_t, Entity>> children;
+    for ( uint32_t i = 0; i < GetEntityCount(); i++ )
+    {
+        if ( !m_Parents[ i ].IsValid() ) continue;
+
+        uint32_t depth = 0;
+        for ( Entity ancestor = m_Parents[ i ]; ancestor.IsValid(); ancestor = m_Parents[ m_Sparse[ ancestor.index ] ] )
+        {
+            depth++;
+        }
+        children.push_back( { depth, m_Entities[ i ] } );
+    }
+    std::stable_sort( children.begin(), children.end(),
+        []( const auto& a, const auto& b ) { return a.first < b.first; } );
+
+    m_HierarchyOrder.clear();
+    for ( const auto& child : children )
+    {
+        m_HierarchyOrder.push_back( child.second );
+    }
+    m_HierarchyChanged = false;
+}
+
+void Scene::UpdateTransforms()
+{
+    PROFILE_FUNCTION();
+    m_WorldBounds.Resize( m_Entities.size() );
+    if ( m_HierarchyChanged )
+    {
+        RebuildHierarchyOrder();
+    }
+
+    m_UpdateList.clear();
+    for ( Entity entity : m_DirtyEntities )
+    {
+        if ( IsAlive( entity ) )
+        {
+            m_UpdateList.push_back( m_Sparse[ entity.index ] );
+        }
+    }
+    m_DirtyEntities.clear();
+
+    //Local matrices of everything that changed, roots are done right away
+    JobSystem::Get().ParallelFor( static_cast< uint32_t >( m_UpdateList.size() ), MIN_TRANSFORMS_PER_JOB,
+        [ this ]( uint32_t begin, uint32_t end )
+        {
+            auto finish = [ this ]( uint32_t denseIndex, const glm::mat4& normalMatrix )
+                {
+                    if ( m_Parents[ denseIndex ].IsValid() ) return;
+
+                    m_WorldMatrices[ denseIndex ] = m_LocalMatrices[ denseIndex ];
+                    m_NormalMatrices[ denseIndex ] = normalMatrix;
+                    m_WorldBounds.Set( denseIndex, m_LocalBounds[ denseIndex ], m_WorldMatrices[ denseIndex ] );
+                };
+
+            uint32_t i = begin;
+#if defined( SCENE_USE_SSE )
+            for ( ; i + 4 <= end; i += 4 )
+            {
+                const TransformComponent* transforms[ 4 ];
+                glm::mat4* localMatrices[ 4 ];
+                glm::mat4 normalMatrices[ 4 ];
+                glm::mat4* normalTargets[ 4 ];
+                for ( int lane = 0; lane < 4; lane++ )
+                {
+                    transforms[ lane ] = &m_Transforms[ m_UpdateList[ i + lane ] ];
+                    localMatrices[ lane ] = &m_LocalMatrices[ m_UpdateList[ i + lane ] ];
+                    normalTargets[ lane ] = &normalMatrices[ lane ];
+                }
+                ComputeMatrices4( transforms, localMatrices, normalTargets );
+                for ( int lane = 0; lane < 4; lane++ )
+                {
+                    finish( m_UpdateList[ i + lane ], normalMatrices[ lane ] );
+                }
+            }
+#endif
+            //Whatever doesn't fill a full batch, or everything without sse
+            for ( ; i < end; i++ )
+            {
+                const uint32_t denseIndex = m_UpdateList[ i ];
+                m_LocalMatrices[ denseIndex ] = m_Transforms[ denseIndex ].mat4();
+                finish( denseIndex, glm::mat4( m_Transforms[ denseIndex ].normalMatrix() ) );
+            }
+        } );
+
+    //Parents before children, a child is redone when it or its parent changed
+    for ( Entity child : m_HierarchyOrder )
+    {
+        const uint32_t childIndex = m_Sparse[ child.index ];
+        const uint32_t parentIndex = m_Sparse[ m_Parents[ childIndex ].index ];
+        if ( !m_Dirty[ childIndex ] && !m_Dirty[ parentIndex ] ) continue;
+
+        if ( !m_Dirty[ childIndex ] )
+        {
+            m_Dirty[ childIndex ] = 1;
+            m_UpdateList.push_back( childIndex );
+        }
+        m_WorldMatrices[ childIndex ] = m_WorldMatrices[ parentIndex ] * m_LocalMatrices[ childIndex ];
+        m_NormalMatrices[ childIndex ] = glm::mat4( glm::inverseTranspose( glm::mat3( m_WorldMatrices[ childIndex ] ) ) );
+        m_WorldBounds.Set( childIndex, m_LocalBounds[ childIndex ], m_WorldMatrices[ childIndex ] );
+    }
+
+    for ( uint32_t denseIndex : m_UpdateList )
+    {
+        m_Dirty[ denseIndex ] = 0;
+    }
+    m_LastUpdateCount = static_cast< uint32_t >( m_UpdateList.size() );
+}
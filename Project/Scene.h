@@ -0,0 +1,137 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "Model.h"
+#include "FrameInfo.h"
+#include "Frustum.h"
+
+//Stable reference to an entity, stays valid while the entity moves around in the dense arrays.
+//The generation tells a destroyed entity apart from a newer one that reuses its slot
+struct Entity
+{
+    static constexpr uint32_t INVALID_INDEX = ~0u;
+
+    uint32_t index = INVALID_INDEX;
+    uint32_t generation = 0;
+
+    bool IsValid() const { return index != INVALID_INDEX; }
+    bool operator==( const Entity& other ) const { return index == other.index && generation == other.generation; }
+    bool operator!=( const Entity& other ) const { return !( *this == other ); }
+};
+
+//Index into the model table of a scene, systems compare and group on it instead of chasing shared_ptrs
+using ModelHandle = uint32_t;
+static constexpr ModelHandle INVALID_MODEL = ~0u;
+
+//Pointer + size view on one component array
+template<typename T>
+class ComponentSpan
+{
+public:
+    ComponentSpan( T* data, size_t size ) : m_Data{ data }, m_Size{ size } {}
+
+    T* begin() const { return m_Data; }
+    T* end() const { return m_Data + m_Size; }
+    T& operator[]( size_t index ) const { return m_Data[ index ]; }
+    T* data() const { return m_Data; }
+    size_t size() const { return m_Size; }
+    bool empty() const { return m_Size == 0; }
+
+private:
+    T* m_Data;
+    size_t m_Size;
+};
+
+//Entity component storage as a sparse set: every component lives in its own dense array (SoA),
+//index i of every array belongs to the same entity, so systems walk plain contiguous memory.
+//Destroying swaps the last entity into the hole, dense indices change but Entity handles don't.
+//World matrices are cached, only transforms edited through EditTransform (or whose parent moved)
+//are recomputed by UpdateTransforms.
+class Scene
+{
+public:
+    Scene() = default;
+
+    Scene( const Scene& ) = delete;
+    Scene& operator=( const Scene& ) = delete;
+
+    //Entities without a model only have a transform and a color, renderers skip them
+    Entity CreateEntity( ModelHandle model = INVALID_MODEL, const TransformComponent& transform = TransformComponent{} );
+    void DestroyEntity( Entity entity );
+    bool IsAlive( Entity entity ) const;
+    void Clear();
+
+    uint32_t GetEntityCount() const { return static_cast< uint32_t >( m_Entities.size() ); }
+    //Only valid until the next Create or Destroy
+    uint32_t GetDenseIndex( Entity entity ) const;
+    Entity GetEntity( uint32_t denseIndex ) const { return m_Entities[ denseIndex ]; }
+
+    //Returns the existing handle when the model was added before
+    ModelHandle AddModel( const std::shared_ptr<Model>& model );
+    Model* GetModel( ModelHandle handle ) const { return handle == INVALID_MODEL ? nullptr : m_ModelTable[ handle ].get(); }
+    uint32_t GetModelCount() const { return static_cast< uint32_t >( m_ModelTable.size() ); }
+
+    void SetModel( Entity entity, ModelHandle model );
+    const TransformComponent& GetTransform( Entity entity ) const { return m_Transforms[ GetDenseIndex( entity ) ]; }
+    //Marks the transform as changed, its matrices and world box follow in the next UpdateTransforms
+    TransformComponent& EditTransform( Entity entity );
+    glm::vec3& GetColor( Entity entity ) { return m_Colors[ GetDenseIndex( entity ) ]; }
+
+    //The child's transform becomes relative to the parent, an invalid parent detaches it again
+    void SetParent( Entity child, Entity parent );
+    Entity GetParent( Entity entity ) const { return m_Parents[ GetDenseIndex( entity ) ]; }
+
+    //Dense component arrays, all GetEntityCount() long
+    ComponentSpan<const Entity> GetEntities() const { return { m_Entities.data(), m_Entities.size() }; }
+    ComponentSpan<const TransformComponent> GetTransforms() const { return { m_Transforms.data(), m_Transforms.size() }; }
+    ComponentSpan<const ModelHandle> GetModels() const { return { m_Models.data(), m_Models.size() }; }
+    ComponentSpan<glm::vec3> GetColors() { return { m_Colors.data(), m_Colors.size() }; }
+    //Model space boxes, copied from the model so culling never touches it
+    ComponentSpan<const BoundingBox> GetLocalBounds() const { return { m_LocalBounds.data(), m_LocalBounds.size() }; }
+
+    //As of the last UpdateTransforms, the normal matrix is the inverse transpose of the world matrix
+    ComponentSpan<const glm::mat4> GetWorldMatrices() const { return { m_WorldMatrices.data(), m_WorldMatrices.size() }; }
+    ComponentSpan<const glm::mat4> GetNormalMatrices() const { return { m_NormalMatrices.data(), m_NormalMatrices.size() }; }
+    //World space boxes of every entity, in dense order, as of the last UpdateTransforms
+    const BoundingBoxBatch& GetWorldBounds() const { return m_WorldBounds; }
+
+    //Recomputes the matrices and world boxes of every changed entity and everything attached to it
+    void UpdateTransforms();
+    //How many entities the last UpdateTransforms recomputed
+    uint32_t GetLastUpdateCount() const { return m_LastUpdateCount; }
+
+private:
+    void MarkDirty( uint32_t denseIndex );
+    //Children sorted by depth, so every parent is done before its children
+    void RebuildHierarchyOrder();
+
+    //Entity index -> dense index, INVALID_INDEX for free slots
+    std::vector<uint32_t> m_Sparse;
+    std::vector<uint32_t> m_Generations;
+    std::vector<uint32_t> m_FreeIndices;
+
+    std::vector<Entity> m_Entities;
+    std::vector<TransformComponent> m_Transforms;
+    std::vector<ModelHandle> m_Models;
+    std::vector<glm::vec3> m_Colors;
+    std::vector<BoundingBox> m_LocalBounds;
+    std::vector<Entity> m_Parents;
+    std::vector<glm::mat4> m_LocalMatrices;
+    std::vector<glm::mat4> m_WorldMatrices;
+    std::vector<glm::mat4> m_NormalMatrices;
+    BoundingBoxBatch m_WorldBounds;
+
+    //Set while an entity waits for UpdateTransforms, m_DirtyEntities lists each of them once
+    std::vector<uint8_t> m_Dirty;
+    std::vector<Entity> m_DirtyEntities;
+    std::vector<uint32_t> m_UpdateList;
+    uint32_t m_LastUpdateCount = 0;
+
+    std::vector<Entity> m_HierarchyOrder;
+    bool m_HierarchyChanged = false;
+
+    std::vector<std::shared_ptr<Model>> m_ModelTable;
+    std::unordered_map<Model*, ModelHandle> m_ModelHandles;
+};
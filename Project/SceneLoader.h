@@ -1,11 +1,15 @@
 #pragma once
 #include <vector>
-#include <GameObject.h>
 #include "Model.h"
 #include "EngineDevice.h"
 #include "json.hpp"
+#include "Profiler.h"
 #include <fstream>
 #include <random>
+#include <unordered_map>
+#include "JobSystem.h"
+#include "ModelCache.h"
+#include "Scene.h"
 #define M_PI       3.14159265358979323846
 
 using json = nlohmann::json;
@@ -13,7 +17,12 @@ using json = nlohmann::json;
 class SceneLoader
 {
 public:
-    std::vector<GameObject>& LoadGameObjects( EngineDevice& device, const std::string& filename )
+    //Game objects without a "vertex_layout" entry get their model in defaultLayout
+    explicit SceneLoader( ModelCache& modelCache, VertexLayout defaultLayout = VertexLayout::Full )
+        : m_ModelCache{ modelCache }, m_DefaultLayout{ defaultLayout } {}
+
+    //Adds one entity per game object entry of the json file to the scene
+    void LoadScene( EngineDevice& device, const std::string& filename, Scene& scene )
     {
         std::ifstream file( filename );
         if ( !file.is_open() ) {
@@ -24,39 +33,52 @@ public:
         file >> jsonData;
         int numGameObjects = jsonData[ "num_game_objects" ];
         int instancedGameObjects = jsonData[ "instanced_game_objects" ];
-        m_GameObjects.reserve( numGameObjects * instancedGameObjects );
 
         if( instancedGameObjects > 1)
 		{
-			return LoadInstancedGameObjects( device, filename, instancedGameObjects );
+			LoadInstancedScene( device, filename, scene, instancedGameObjects );
+			device.GetUploadQueue().Submit();
+			return;
 		}
-        else 
-        {
 
-            for ( int i = 0; i < numGameObjects; i++ )
-            {
-                std::string objFilePath = jsonData[ "game_objects" ][ i ][ "obj_file_path" ].get<std::string>();
-                glm::vec3 location = glm::vec3(
-                    jsonData[ "game_objects" ][ i ][ "location" ][ 0 ].get<float>(),
-                    jsonData[ "game_objects" ][ i ][ "location" ][ 1 ].get<float>(),
-                    jsonData[ "game_objects" ][ i ][ "location" ][ 2 ].get<float>()
-                );
-                float scale = jsonData[ "game_objects" ][ i ][ "scale" ].get<float>();
+        std::vector<ModelHandle> models = AddModels( scene, LoadModels( jsonData, numGameObjects ) );
+        std::vector<Entity> entities( numGameObjects );
 
-                std::shared_ptr<Model> model = Model::CreateModelFromFile( device, objFilePath );
-                auto gameObject = GameObject::Create();
+        for ( int i = 0; i < numGameObjects; i++ )
+        {
+            glm::vec3 location = glm::vec3(
+                jsonData[ "game_objects" ][ i ][ "location" ][ 0 ].get<float>(),
+                jsonData[ "game_objects" ][ i ][ "location" ][ 1 ].get<float>(),
+                jsonData[ "game_objects" ][ i ][ "location" ][ 2 ].get<float>()
+            );
+            float scale = jsonData[ "game_objects" ][ i ][ "scale" ].get<float>();
+
+            TransformComponent transform{};
+            transform.translation = location;
+            transform.scale = glm::vec3( scale );
+
+            entities[ i ] = scene.CreateEntity( models[ i ], transform );
+        }
 
-                gameObject.m_Model = model;
-                gameObject.m_Transform.translation = location;
-                gameObject.m_Transform.scale = glm::vec3( scale );
+        //"parent" is the index of another game object, location and scale then are relative to it
+        for ( int i = 0; i < numGameObjects; i++ )
+        {
+            const json& gameObject = jsonData[ "game_objects" ][ i ];
+            if ( !gameObject.contains( "parent" ) ) continue;
 
-                m_GameObjects.emplace_back( std::move( gameObject ) );
+            const int parent = gameObject[ "parent" ].get<int>();
+            if ( parent < 0 || parent >= numGameObjects )
+            {
+                throw std::runtime_error( "Invalid parent index " + std::to_string( parent ) + " in " + filename );
             }
-            return m_GameObjects;
+            scene.SetParent( entities[ i ], entities[ parent ] );
         }
+
+        //Every mesh of the scene goes to the gpu in one submission
+        device.GetUploadQueue().Submit();
     }
 
-    std::vector<GameObject>& LoadInstancedGameObjects( EngineDevice& device, const std::string& filename, int howmany = 1 )
+    void LoadInstancedScene( EngineDevice& device, const std::string& filename, Scene& scene, int howmany = 1 )
     {
         std::ifstream file( filename );
         if ( !file.is_open() ) {
@@ -67,12 +89,17 @@ public:
         file >> jsonData;
 
         int numGameObjects = jsonData[ "num_game_objects" ];
-        m_GameObjects.reserve( numGameObjects * howmany );
+
+        //Every copy shares the same model, only the transform differs
+        std::vector<ModelHandle> models = AddModels( scene, LoadModels( jsonData, numGameObjects ) );
 
         float spacing = 5.0f;
         float layerHeight = 10.0f;
         int gridSize = 10;
 
+        std::random_device rd;
+        std::mt19937 gen( rd() );
+        std::uniform_real_distribution<float> scaleDistribution( 0.2f, 1.5f );
 
         for ( int j = 0; j < howmany; j++ )
         {
@@ -83,42 +110,115 @@ public:
 
             for ( int i = 0; i < numGameObjects; i++ )
             {
-                std::string objFilePath = jsonData[ "game_objects" ][ i ][ "obj_file_path" ].get<std::string>();
                 glm::vec3 location = glm::vec3(
                     jsonData[ "game_objects" ][ i ][ "location" ][ 0 ].get<float>(),
                     jsonData[ "game_objects" ][ i ][ "location" ][ 1 ].get<float>(),
                     jsonData[ "game_objects" ][ i ][ "location" ][ 2 ].get<float>()
                 );
-                float scale = jsonData[ "game_objects" ][ i ][ "scale" ].get<float>();
-
-                std::shared_ptr<Model> model = Model::CreateModelFromFile( device, objFilePath );
-                auto gameObject = GameObject::Create();
-                gameObject.m_Model = model;
 
-
-                gameObject.m_Transform.translation = location;
-                gameObject.m_Transform.translation.x += xIndex * spacing;
-                gameObject.m_Transform.translation.z += zIndex * spacing;
-                gameObject.m_Transform.translation.y += layer * layerHeight;
+                TransformComponent transform{};
+                transform.translation = location;
+                transform.translation.x += xIndex * spacing;
+                transform.translation.z += zIndex * spacing;
+                transform.translation.y += layer * layerHeight;
 
                 //random scale:
-                std::random_device rd;
-                std::mt19937 gen( rd() );
-                std::uniform_real_distribution<float> scaleDistribution( 0.2f, 1.5f );
                 float randomScale = scaleDistribution( gen );
-                gameObject.m_Transform.scale = glm::vec3( randomScale );
+                transform.scale = glm::vec3( randomScale );
 
                 //random rotation:
                 float randomAngle = ( ( float ) rand() / ( float ) RAND_MAX ) * 2.0f * M_PI;
-                gameObject.m_Transform.rotation = glm::vec3( randomAngle, randomAngle, randomAngle );
+                transform.rotation = glm::vec3( randomAngle, randomAngle, randomAngle );
 
-                m_GameObjects.emplace_back( std::move( gameObject ) );
+                scene.CreateEntity( models[ i ], transform );
             }
         }
-
-        return m_GameObjects;
     }
 
+    //Files the loads so far imported from source instead of the mesh cache, with their vertex cache stats
+    const std::vector<Model::ImportStats>& GetImportStats() const { return m_ImportStats; }
+
 private:
-	std::vector<GameObject> m_GameObjects;
+    //Scene model handles for the loaded models, entries that share a file share the handle
+    static std::vector<ModelHandle> AddModels( Scene& scene, const std::vector<std::shared_ptr<Model>>& models )
+    {
+        std::vector<ModelHandle> handles( models.size() );
+        for ( size_t i = 0; i < models.size(); i++ )
+        {
+            handles[ i ] = scene.AddModel( models[ i ] );
+        }
+        return handles;
+    }
+
+    //One model per game object entry, files the cache doesn't have yet are parsed as jobs, one per file
+    std::vector<std::shared_ptr<Model>> LoadModels( const json& jsonData, int numGameObjects )
+    {
+        std::vector<std::shared_ptr<Model>> models( numGameObjects );
+        std::vector<VertexLayout> layouts( numGameObjects );
+        std::vector<std::string> missingFiles;
+        std::unordered_map<std::string, std::vector<int>> missingIndices;
+
+        for ( int i = 0; i < numGameObjects; i++ )
+        {
+            const json& gameObject = jsonData[ "game_objects" ][ i ];
+            std::string objFilePath = gameObject[ "obj_file_path" ].get<std::string>();
+            layouts[ i ] = gameObject.contains( "vertex_layout" )
+                ? ParseVertexLayout( gameObject[ "vertex_layout" ].get<std::string>() )
+                : m_DefaultLayout;
+
+            models[ i ] = m_ModelCache.Find( objFilePath, layouts[ i ] );
+            if ( models[ i ] )
+            {
+                continue;
+            }
+
+            auto& indices = missingIndices[ objFilePath ];
+            if ( indices.empty() )
+            {
+                missingFiles.push_back( objFilePath );
+            }
+            indices.push_back( i );
+        }
+
+        if ( missingFiles.empty() )
+        {
+            return models;
+        }
+
+        //One child job per file under a single root, so Wait only returns (or rethrows) once every job
+        //stopped writing into loadedData. The main thread helps loading while it waits
+        JobSystem& jobSystem = JobSystem::Get();
+        std::vector<Model::ModelData> loadedData( missingFiles.size() );
+        JobSystem::JobHandle loadJob = jobSystem.CreateJob( nullptr );
+
+        for ( size_t i = 0; i < missingFiles.size(); i++ )
+        {
+            jobSystem.Run( jobSystem.CreateChildJob( loadJob, [ &file = missingFiles[ i ], &modelData = loadedData[ i ] ]()
+                {
+                    PROFILE_SCOPE( "ModelData::LoadFromFile" );
+                    modelData.LoadFromFile( file );
+                } ) );
+        }
+        jobSystem.Run( loadJob );
+        jobSystem.Wait( loadJob );
+
+        //GPU uploads stay on the main thread.
+        //A file is parsed once, the cache hands out one model per layout it is asked in
+        for ( size_t i = 0; i < missingFiles.size(); i++ )
+        {
+            if ( !loadedData[ i ].importStats.filename.empty() )
+            {
+                m_ImportStats.push_back( loadedData[ i ].importStats );
+            }
+            for ( int index : missingIndices[ missingFiles[ i ] ] )
+            {
+                models[ index ] = m_ModelCache.Add( missingFiles[ i ], loadedData[ i ], layouts[ index ] );
+            }
+        }
+        return models;
+    }
+
+    ModelCache& m_ModelCache;
+    VertexLayout m_DefaultLayout;
+    std::vector<Model::ImportStats> m_ImportStats;
 };
\ No newline at end of file
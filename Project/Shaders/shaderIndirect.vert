@@ -0,0 +1,44 @@
+#version 450
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+layout(location = 2) in vec3 normal;
+layout(location = 3) in vec2 uv;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragPosWorld;
+layout(location = 2) out vec3 fragNormalWorld;
+
+layout(set = 0, binding = 0) uniform GlobalUbo
+{
+	mat4 projection;
+	mat4 view;
+	vec4 ambientLightColor;
+    vec3 lightPosition;
+    vec4 lightColor;
+} ubo;
+
+struct ObjectData
+{
+    mat4 modelMatrix;
+    mat4 normalMatrix;
+    vec4 boundsCenter;
+    vec4 boundsExtent;
+};
+
+//Same buffer the cull pass read, firstInstance of every draw is the object index
+layout(std430, set = 1, binding = 0) readonly buffer Objects
+{
+    ObjectData objects[];
+};
+
+void main() 
+{
+    ObjectData object = objects[gl_InstanceIndex];
+    vec4 positionWorldSpace = object.modelMatrix * vec4(position, 1.0);
+
+    gl_Position = ubo.projection * ubo.view * positionWorldSpace;
+    fragNormalWorld = -normalize(mat3(object.normalMatrix) * normal);
+    fragPosWorld = positionWorldSpace.xyz;
+    fragColor = color;
+}
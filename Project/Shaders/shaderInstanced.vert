@@ -0,0 +1,33 @@
+#version 450
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+layout(location = 2) in vec3 normal;
+layout(location = 3) in vec2 uv;
+
+//Per instance, binding 1 (a mat4 takes 4 locations)
+layout(location = 4) in mat4 instanceModelMatrix;
+layout(location = 8) in mat4 instanceNormalMatrix;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragPosWorld;
+layout(location = 2) out vec3 fragNormalWorld;
+
+layout(set = 0, binding = 0) uniform GlobalUbo
+{
+	mat4 projection;
+	mat4 view;
+	vec4 ambientLightColor;
+    vec3 lightPosition;
+    vec4 lightColor;
+} ubo;
+
+void main() 
+{
+    vec4 positionWorldSpace = instanceModelMatrix * vec4(position, 1.0);
+
+    gl_Position = ubo.projection * ubo.view * positionWorldSpace;
+    fragNormalWorld = -normalize(mat3(instanceNormalMatrix) * normal);
+    fragPosWorld = positionWorldSpace.xyz;
+    fragColor = color;
+}
@@ -0,0 +1,43 @@
+#version 450
+
+//Model::CompactVertex, the formats already turn everything into floats
+layout(location = 0) in vec4 position;  //snorm16, dequantized by the instance model matrix
+layout(location = 1) in vec4 color;     //unorm8
+layout(location = 2) in vec2 normal;    //octahedral snorm16
+layout(location = 3) in vec2 uv;        //half
+
+//Per instance, binding 1 (a mat4 takes 4 locations)
+layout(location = 4) in mat4 instanceModelMatrix;
+layout(location = 8) in mat4 instanceNormalMatrix;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragPosWorld;
+layout(location = 2) out vec3 fragNormalWorld;
+
+layout(set = 0, binding = 0) uniform GlobalUbo
+{
+	mat4 projection;
+	mat4 view;
+	vec4 ambientLightColor;
+    vec3 lightPosition;
+    vec4 lightColor;
+} ubo;
+
+vec3 octahedralDecode(vec2 encoded)
+{
+    vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+void main() 
+{
+    vec4 positionWorldSpace = instanceModelMatrix * vec4(position.xyz, 1.0);
+
+    gl_Position = ubo.projection * ubo.view * positionWorldSpace;
+    fragNormalWorld = -normalize(mat3(instanceNormalMatrix) * octahedralDecode(normal));
+    fragPosWorld = positionWorldSpace.xyz;
+    fragColor = color.rgb;
+}
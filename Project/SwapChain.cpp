@@ -8,6 +8,7 @@
 #include <stdexcept>
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
+#include "Profiler.h"
 
 SwapChain::SwapChain(EngineDevice &deviceRef, VkExtent2D extent)
     : m_Device{deviceRef}, m_WindowExtent{extent} 
@@ -48,7 +49,7 @@ SwapChain::~SwapChain() {
   for (int i = 0; i < m_DepthImages.size(); i++) {
     vkDestroyImageView(m_Device.Device(), m_DepthImageViews[i], nullptr);
     vkDestroyImage(m_Device.Device(), m_DepthImages[i], nullptr);
-    vkFreeMemory(m_Device.Device(), m_DepthImageMemorys[i], nullptr);
+    m_Device.FreeMemory(m_DepthImageMemorys[i]);
   }
 
   for (auto framebuffer : m_SwapChainFramebuffers) {
@@ -66,12 +67,16 @@ SwapChain::~SwapChain() {
 }
 
 VkResult SwapChain::acquireNextImage(uint32_t *imageIndex) {
-  vkWaitForFences(
-      m_Device.Device(),
-      1,
-      &m_InFlightFences[m_CurrentFrame],
-      VK_TRUE,
-      std::numeric_limits<uint64_t>::max());
+  PROFILE_FUNCTION();
+  {
+    PROFILE_SCOPE("SwapChain::WaitForFrameFence");
+    vkWaitForFences(
+        m_Device.Device(),
+        1,
+        &m_InFlightFences[m_CurrentFrame],
+        VK_TRUE,
+        std::numeric_limits<uint64_t>::max());
+  }
 
   VkResult result = vkAcquireNextImageKHR(
       m_Device.Device(),
@@ -86,7 +91,9 @@ VkResult SwapChain::acquireNextImage(uint32_t *imageIndex) {
 
 VkResult SwapChain::submitCommandBuffers(
     const VkCommandBuffer *buffers, uint32_t *imageIndex) {
+  PROFILE_FUNCTION();
   if (m_ImagesInFlight[*imageIndex] != VK_NULL_HANDLE) {
+    PROFILE_SCOPE("SwapChain::WaitForImageFence");
     vkWaitForFences(m_Device.Device(), 1, &m_ImagesInFlight[*imageIndex], VK_TRUE, UINT64_MAX);
   }
   m_ImagesInFlight[*imageIndex] = m_InFlightFences[m_CurrentFrame];
@@ -125,7 +132,11 @@ VkResult SwapChain::submitCommandBuffers(
 
   presentInfo.pImageIndices = imageIndex;
 
-  auto result = vkQueuePresentKHR(m_Device.PresentQueue(), &presentInfo);
+  VkResult result;
+  {
+    PROFILE_SCOPE("vkQueuePresentKHR");
+    result = vkQueuePresentKHR(m_Device.PresentQueue(), &presentInfo);
+  }
 
   m_CurrentFrame = (m_CurrentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
 
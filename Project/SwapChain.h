@@ -64,7 +64,7 @@ class SwapChain {
   VkRenderPass m_RenderPass;
 
   std::vector<VkImage> m_DepthImages;
-  std::vector<VkDeviceMemory> m_DepthImageMemorys;
+  std::vector<MemoryAllocation> m_DepthImageMemorys;
   std::vector<VkImageView> m_DepthImageViews;
   std::vector<VkImage> m_SwapChainImages;
   std::vector<VkImageView> m_SwapChainImageViews;
@@ -0,0 +1,468 @@
+#include "IndirectRenderSystem.h"
+
+#include <stdexcept>
+#include <array>
+#include <algorithm>
+#include <numeric>
+#include "Frustum.h"
+#include "MeshletBuilder.h"
+#include "GpuProfiler.h"
+#include "Profiler.h"
+
+//Matches the push block of cullObjects.comp
+struct CullPushConstantData
+{
+	glm::vec4 frustumPlanes[ 6 ];
+	glm::vec4 cameraPosition{ 0.f };
+	uint32_t clusterCount = 0;
+	uint32_t compact = 0;
+	uint32_t coneCulling = 0;
+};
+
+static constexpr uint32_t CULL_GROUP_SIZE = 64;
+
+IndirectRenderSystem::IndirectRenderSystem( EngineDevice& device,
+	VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout,
+	PipelineBuilder& pipelineBuilder )
+	:m_EngineDevice{ device }
+{
+	CreateDescriptorLayouts();
+	CreatePipelineLayout( globalSetLayout );
+	CreatePipelines( renderPass, pipelineBuilder );
+}
+
+IndirectRenderSystem::~IndirectRenderSystem()
+{
+	vkDestroyPipelineLayout( m_EngineDevice.Device(), m_PipelineLayout, nullptr );
+}
+
+bool IndirectRenderSystem::IsSupported( EngineDevice& device )
+{
+	return device.enabledFeatures.drawIndirectFirstInstance == VK_TRUE;
+}
+
+void IndirectRenderSystem::CreateDescriptorLayouts()
+{
+	m_CullSetLayout = DescriptorSetLayout::Builder( m_EngineDevice )
+		.addBinding( 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT )
+		.addBinding( 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT )
+		.addBinding( 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT )
+		.addBinding( 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT )
+		.addBinding( 4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT )
+		.build();
+
+	m_ObjectSetLayout = DescriptorSetLayout::Builder( m_EngineDevice )
+		.addBinding( 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT )
+		.build();
+
+	m_DescriptorPool = DescriptorPool::Builder( m_EngineDevice )
+		.setMaxSets( SwapChain::MAX_FRAMES_IN_FLIGHT * 2 )
+		.addPoolSize( VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, SwapChain::MAX_FRAMES_IN_FLIGHT * 6 )
+		.build();
+}
+
+void IndirectRenderSystem::CreatePipelineLayout( VkDescriptorSetLayout globalSetLayout )
+{
+	//shader.frag still declares the push block of the simple pipeline, so the range has to exist
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags =
+		VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof( glm::mat4 ) * 2;
+
+	std::vector<VkDescriptorSetLayout> descriptorSetLayouts =
+		{ globalSetLayout, m_ObjectSetLayout->getDescriptorSetLayout() };
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = static_cast< uint32_t >( descriptorSetLayouts.size() );
+	pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if ( vkCreatePipelineLayout( m_EngineDevice.Device(),
+		&pipelineLayoutInfo, nullptr, &m_PipelineLayout ) != VK_SUCCESS )
+	{
+		throw std::runtime_error( "Failed to create indirect pipeline layout!" );
+	}
+}
+
+void IndirectRenderSystem::CreatePipelines( VkRenderPass renderPass, PipelineBuilder& pipelineBuilder )
+{
+	VkPipelineLayout pipelineLayout = m_PipelineLayout;
+	m_PipelineFuture = pipelineBuilder.Submit(
+		"shaders/shaderIndirect.vert.spv",
+		"shaders/shader.frag.spv",
+		[ renderPass, pipelineLayout ]( PipelineConfigInfo& pipelineConfig )
+		{
+			pipelineConfig.renderPass = renderPass;
+			pipelineConfig.pipelineLayout = pipelineLayout;
+		} );
+
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof( CullPushConstantData );
+
+	ComputePipelineConfigInfo computeConfig{};
+	computeConfig.descriptorSetLayouts = { m_CullSetLayout->getDescriptorSetLayout() };
+	computeConfig.pushConstantRanges = { pushConstantRange };
+	computeConfig.localSizeX = CULL_GROUP_SIZE;
+	m_CullPipelineFuture = pipelineBuilder.SubmitCompute(
+		"shaders/cullObjects.comp.spv",
+		computeConfig );
+}
+
+void IndirectRenderSystem::SetScene( const Scene& scene )
+{
+	PROFILE_FUNCTION();
+	vkDeviceWaitIdle( m_EngineDevice.Device() );
+
+	UploadMeshes( scene );
+
+	m_Objects.clear();
+	m_ObjectEntities.clear();
+	m_ClusterInstances.clear();
+	const ComponentSpan<const ModelHandle> models = scene.GetModels();
+	for ( uint32_t i = 0; i < models.size(); i++ )
+	{
+		if ( models[ i ] == INVALID_MODEL ) continue;
+
+		const uint32_t objectIndex = GetObjectCount();
+		const MeshRange& range = m_MeshRanges[ models[ i ] ];
+		for ( uint32_t cluster = 0; cluster < range.clusterCount; cluster++ )
+		{
+			m_ClusterInstances.push_back( { objectIndex, range.firstCluster + cluster } );
+		}
+
+		ObjectData object{};
+		WriteObject( scene, i, object );
+		m_Objects.push_back( object );
+		m_ObjectEntities.push_back( scene.GetEntity( i ) );
+	}
+
+	FindDynamicObjects( scene );
+	UploadClusterInstances();
+	CreateFrameResources();
+}
+
+void IndirectRenderSystem::MarkDynamic( const Scene& scene, Entity entity )
+{
+	m_DynamicEntities.push_back( entity );
+	FindDynamicObjects( scene );
+}
+
+void IndirectRenderSystem::FindDynamicObjects( const Scene& scene )
+{
+	m_DynamicObjects.clear();
+	for ( uint32_t objectIndex = 0; objectIndex < m_ObjectEntities.size(); objectIndex++ )
+	{
+		const Entity entity = m_ObjectEntities[ objectIndex ];
+		if ( scene.IsAlive( entity ) && IsDynamic( scene, entity ) )
+		{
+			m_DynamicObjects.push_back( objectIndex );
+		}
+	}
+}
+
+bool IndirectRenderSystem::IsDynamic( const Scene& scene, Entity entity ) const
+{
+	//Children move with their parent, so they are rewritten with it
+	for ( ; entity.IsValid(); entity = scene.GetParent( entity ) )
+	{
+		if ( std::find( m_DynamicEntities.begin(), m_DynamicEntities.end(), entity ) != m_DynamicEntities.end() )
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void IndirectRenderSystem::UploadMeshes( const Scene& scene )
+{
+	std::vector<Model::Vertex> vertices;
+	std::vector<uint32_t> indices;
+	std::vector<ClusterData> clusters;
+	bool fitsUint16 = true;
+	m_MeshRanges.assign( scene.GetModelCount(), MeshRange{} );
+
+	//Every model of the table once, entities only point into it
+	for ( ModelHandle handle = 0; handle < scene.GetModelCount(); handle++ )
+	{
+		Model::ModelData modelData = scene.GetModel( handle )->GetModelData();
+		if ( modelData.indices.empty() )
+		{
+			//Everything goes through indexed draws, give unindexed meshes the trivial index list
+			modelData.indices.resize( modelData.vertices.size() );
+			std::iota( modelData.indices.begin(), modelData.indices.end(), 0u );
+			modelData.meshlets.clear();
+		}
+		//Meshes built in code never went through LoadModel, they are cut here
+		if ( modelData.meshlets.empty() )
+		{
+			MeshletBuilder::Build( modelData );
+		}
+
+		MeshRange range{};
+		range.firstCluster = static_cast< uint32_t >( clusters.size() );
+		const uint32_t meshVertexOffset = static_cast< uint32_t >( vertices.size() );
+		vertices.insert( vertices.end(), modelData.vertices.begin(), modelData.vertices.end() );
+
+		for ( const Model::Meshlet& meshlet : modelData.meshlets )
+		{
+			if ( meshlet.indexCount == 0 ) continue;
+
+			//Rebased on the meshlet's lowest vertex, the fetch optimized order keeps the rest close to it
+			const auto first = modelData.indices.begin() + meshlet.firstIndex;
+			const auto last = first + meshlet.indexCount;
+			const auto [ minIndex, maxIndex ] = std::minmax_element( first, last );
+			const uint32_t baseVertex = *minIndex;
+			fitsUint16 = fitsUint16 && *maxIndex - baseVertex < Model::MAX_UINT16_VERTICES;
+
+			ClusterData cluster{};
+			cluster.sphere = glm::vec4( meshlet.center, meshlet.radius );
+			cluster.cone = glm::vec4( meshlet.coneAxis, meshlet.coneCutoff );
+			cluster.indexCount = meshlet.indexCount;
+			cluster.firstIndex = static_cast< uint32_t >( indices.size() );
+			cluster.vertexOffset = static_cast< int32_t >( meshVertexOffset + baseVertex );
+			for ( auto index = first; index != last; ++index )
+			{
+				indices.push_back( *index - baseVertex );
+			}
+			clusters.push_back( cluster );
+		}
+		range.clusterCount = static_cast< uint32_t >( clusters.size() ) - range.firstCluster;
+
+		m_MeshRanges[ handle ] = range;
+	}
+
+	if ( vertices.empty() || clusters.empty() )
+	{
+		return;
+	}
+
+	m_ClusterBuffer = std::make_unique<Buffer>( m_EngineDevice, sizeof( ClusterData ),
+		static_cast< uint32_t >( clusters.size() ),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT );
+	m_EngineDevice.GetUploadQueue().Upload( m_ClusterBuffer->getBuffer(), clusters.data(),
+		sizeof( ClusterData ) * clusters.size() );
+
+	const VkDeviceSize vertexBufferSize = sizeof( Model::Vertex ) * vertices.size();
+	m_VertexBuffer = std::make_unique<Buffer>( m_EngineDevice, sizeof( Model::Vertex ),
+		static_cast< uint32_t >( vertices.size() ),
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT );
+	m_EngineDevice.GetUploadQueue().Upload( m_VertexBuffer->getBuffer(), vertices.data(), vertexBufferSize );
+
+	//Every meshlet draws with its own vertexOffset, so only a meshlet spanning more than the 16 bit limit needs 32 bit indices
+	const void* indexData = indices.data();
+	std::vector<uint16_t> narrowIndices;
+	uint32_t indexSize = sizeof( uint32_t );
+	m_IndexType = fitsUint16 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+	if ( fitsUint16 )
+	{
+		narrowIndices.assign( indices.begin(), indices.end() );
+		indexData = narrowIndices.data();
+		indexSize = sizeof( uint16_t );
+	}
+
+	const VkDeviceSize indexBufferSize = static_cast< VkDeviceSize >( indexSize ) * indices.size();
+	m_IndexBuffer = std::make_unique<Buffer>( m_EngineDevice, indexSize,
+		static_cast< uint32_t >( indices.size() ),
+		VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT );
+	m_EngineDevice.GetUploadQueue().Upload( m_IndexBuffer->getBuffer(), indexData, indexBufferSize );
+}
+
+void IndirectRenderSystem::UploadClusterInstances()
+{
+	m_ClusterInstanceBuffer.reset();
+	if ( m_ClusterInstances.empty() )
+	{
+		return;
+	}
+
+	m_ClusterInstanceBuffer = std::make_unique<Buffer>( m_EngineDevice, sizeof( ClusterInstance ), GetClusterCount(),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT );
+	m_EngineDevice.GetUploadQueue().Upload( m_ClusterInstanceBuffer->getBuffer(), m_ClusterInstances.data(),
+		sizeof( ClusterInstance ) * m_ClusterInstances.size() );
+}
+
+void IndirectRenderSystem::CreateFrameResources()
+{
+	if ( !m_Frames.empty() )
+	{
+		m_DescriptorPool->resetPool();
+	}
+	m_Frames.clear();
+
+	if ( m_Objects.empty() || m_ClusterInstances.empty() )
+	{
+		return;
+	}
+
+	const uint32_t objectCount = GetObjectCount();
+	auto clusterInfo = m_ClusterBuffer->descriptorInfo();
+	auto clusterInstanceInfo = m_ClusterInstanceBuffer->descriptorInfo();
+	m_Frames.resize( SwapChain::MAX_FRAMES_IN_FLIGHT );
+	for ( auto& frame : m_Frames )
+	{
+		//Host visible so dynamic objects can be rewritten in place every frame
+		frame.objectBuffer = std::make_unique<Buffer>( m_EngineDevice, sizeof( ObjectData ), objectCount,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT );
+		frame.objectBuffer->map();
+		frame.objectBuffer->writeToBuffer( m_Objects.data() );
+		frame.objectBuffer->flush();
+
+		frame.drawBuffer = std::make_unique<Buffer>( m_EngineDevice, sizeof( VkDrawIndexedIndirectCommand ), GetClusterCount(),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT );
+
+		frame.countBuffer = std::make_unique<Buffer>( m_EngineDevice, sizeof( uint32_t ), 1,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT );
+
+		auto objectInfo = frame.objectBuffer->descriptorInfo();
+		auto drawInfo = frame.drawBuffer->descriptorInfo();
+		auto countInfo = frame.countBuffer->descriptorInfo();
+
+		DescriptorWriter( *m_CullSetLayout, *m_DescriptorPool )
+			.writeBuffer( 0, &objectInfo )
+			.writeBuffer( 1, &drawInfo )
+			.writeBuffer( 2, &countInfo )
+			.writeBuffer( 3, &clusterInfo )
+			.writeBuffer( 4, &clusterInstanceInfo )
+			.build( frame.cullSet );
+
+		DescriptorWriter( *m_ObjectSetLayout, *m_DescriptorPool )
+			.writeBuffer( 0, &objectInfo )
+			.build( frame.objectSet );
+	}
+}
+
+void IndirectRenderSystem::WriteObject( const Scene& scene, uint32_t denseIndex, ObjectData& object )
+{
+	object.modelMatrix = scene.GetWorldMatrices()[ denseIndex ];
+	object.normalMatrix = scene.GetNormalMatrices()[ denseIndex ];
+
+	const BoundingBox& bounds = scene.GetLocalBounds()[ denseIndex ];
+	object.boundsCenter = glm::vec4( bounds.GetCenter(), 0.f );
+	object.boundsExtent = glm::vec4( bounds.GetExtent(), 0.f );
+}
+
+void IndirectRenderSystem::Cull( FrameInfo& frameinfo, const Scene& scene )
+{
+	PROFILE_FUNCTION();
+	if ( m_Frames.empty() )
+	{
+		return;
+	}
+
+	GpuProfiler::Scope gpuScope{ frameinfo.gpuProfiler, frameinfo.commandBuffer, "GpuCulling" };
+	PipelineBuilder::Resolve( m_CullPipelineFuture, m_CullPipeline );
+	FrameResources& frame = m_Frames[ frameinfo.frameIndex ];
+
+	//Static objects were written once in SetScene, only the moving ones cost cpu time
+	if ( !m_DynamicObjects.empty() )
+	{
+		auto* objects = static_cast< ObjectData* >( frame.objectBuffer->getMappedMemory() );
+		for ( uint32_t objectIndex : m_DynamicObjects )
+		{
+			const Entity entity = m_ObjectEntities[ objectIndex ];
+			if ( scene.IsAlive( entity ) )
+			{
+				WriteObject( scene, scene.GetDenseIndex( entity ), objects[ objectIndex ] );
+			}
+		}
+		frame.objectBuffer->flush();
+	}
+
+	VkCommandBuffer commandBuffer = frameinfo.commandBuffer;
+	const bool compact = m_EngineDevice.cmdDrawIndexedIndirectCount != nullptr;
+
+	vkCmdFillBuffer( commandBuffer, frame.countBuffer->getBuffer(), 0, sizeof( uint32_t ), 0 );
+
+	VkMemoryBarrier clearBarrier{};
+	clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, 1, &clearBarrier, 0, nullptr, 0, nullptr );
+
+	CullPushConstantData push{};
+	const Frustum frustum{ frameinfo.camera.GetViewProjectionMatrix() };
+	for ( int i = 0; i < 6; i++ )
+	{
+		push.frustumPlanes[ i ] = frustum.GetPlanes()[ i ];
+	}
+	push.cameraPosition = glm::vec4( frameinfo.camera.GetPosition(), 1.f );
+	push.clusterCount = GetClusterCount();
+	push.compact = compact ? 1 : 0;
+	push.coneCulling = m_ConeCullingEnabled ? 1 : 0;
+
+	m_CullPipeline->Bind( commandBuffer );
+	vkCmdBindDescriptorSets( commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+		m_CullPipeline->GetPipelineLayout(), 0, 1, &frame.cullSet, 0, nullptr );
+	vkCmdPushConstants( commandBuffer, m_CullPipeline->GetPipelineLayout(), VK_SHADER_STAGE_COMPUTE_BIT,
+		0, sizeof( CullPushConstantData ), &push );
+	m_CullPipeline->Dispatch( commandBuffer, push.clusterCount );
+
+	VkMemoryBarrier drawBarrier{};
+	drawBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	drawBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	drawBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+	vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+		0, 1, &drawBarrier, 0, nullptr, 0, nullptr );
+}
+
+void IndirectRenderSystem::Render( FrameInfo& frameinfo )
+{
+	PROFILE_FUNCTION();
+	if ( m_Frames.empty() || m_VertexBuffer == nullptr )
+	{
+		return;
+	}
+
+	GpuProfiler::Scope gpuScope{ frameinfo.gpuProfiler, frameinfo.commandBuffer, "IndirectRenderSystem" };
+	PipelineBuilder::Resolve( m_PipelineFuture, m_Pipeline );
+	FrameResources& frame = m_Frames[ frameinfo.frameIndex ];
+	VkCommandBuffer commandBuffer = frameinfo.commandBuffer;
+
+	m_Pipeline->Bind( commandBuffer );
+
+	std::array<VkDescriptorSet, 2> descriptorSets = { frameinfo.globalDescriptorSet, frame.objectSet };
+	vkCmdBindDescriptorSets( commandBuffer,
+		VK_PIPELINE_BIND_POINT_GRAPHICS,
+		m_PipelineLayout, 0, static_cast< uint32_t >( descriptorSets.size() ),
+		descriptorSets.data(), 0, nullptr );
+
+	VkBuffer buffers[] = { m_VertexBuffer->getBuffer() };
+	VkDeviceSize offsets[] = { 0 };
+	vkCmdBindVertexBuffers( commandBuffer, 0, 1, buffers, offsets );
+	vkCmdBindIndexBuffer( commandBuffer, m_IndexBuffer->getBuffer(), 0, m_IndexType );
+
+	const uint32_t stride = sizeof( VkDrawIndexedIndirectCommand );
+	if ( m_EngineDevice.cmdDrawIndexedIndirectCount != nullptr )
+	{
+		m_EngineDevice.cmdDrawIndexedIndirectCount( commandBuffer, frame.drawBuffer->getBuffer(), 0,
+			frame.countBuffer->getBuffer(), 0, GetClusterCount(), stride );
+		frameinfo.drawCallCount++;
+	}
+	else if ( m_EngineDevice.enabledFeatures.multiDrawIndirect )
+	{
+		//One slot per cluster, the culled ones have instanceCount 0
+		vkCmdDrawIndexedIndirect( commandBuffer, frame.drawBuffer->getBuffer(), 0, GetClusterCount(), stride );
+		frameinfo.drawCallCount++;
+	}
+	else
+	{
+		for ( uint32_t i = 0; i < GetClusterCount(); i++ )
+		{
+			vkCmdDrawIndexedIndirect( commandBuffer, frame.drawBuffer->getBuffer(), i * stride, 1, stride );
+		}
+		frameinfo.drawCallCount += GetClusterCount();
+	}
+}
@@ -0,0 +1,131 @@
+#pragma once
+#include <memory>
+#include <vector>
+
+#include "Pipeline.h"
+#include "PipelineBuilder.h"
+#include "EngineDevice.h"
+#include "SwapChain.h"
+#include "Scene.h"
+#include "FrameInfo.h"
+#include "Buffer.h"
+#include "Descriptors.h"
+
+//Gpu driven alternative to SimpleRenderSystem: a compute pass frustum (and optionally normal cone) culls every meshlet
+//of every object and writes one indexed indirect draw per visible meshlet, the cpu only records a dispatch
+//and one indirect draw. All meshes of the scene are packed into one vertex and one index buffer so a single
+//bind covers every draw.
+class IndirectRenderSystem
+{
+public:
+    IndirectRenderSystem( EngineDevice& device,
+        VkRenderPass renderPass,
+        VkDescriptorSetLayout globalSetLayout,
+        PipelineBuilder& pipelineBuilder );
+    ~IndirectRenderSystem();
+
+    IndirectRenderSystem( const IndirectRenderSystem& ) = delete;
+    IndirectRenderSystem& operator=( const IndirectRenderSystem& ) = delete;
+
+    //Needs drawIndirectFirstInstance, the vertex shader finds its object through gl_InstanceIndex
+    static bool IsSupported( EngineDevice& device );
+
+    //Uploads the packed meshes and the object buffer, call again when entities are added or removed
+    //or parents change. Reads the scene's cached matrices, so UpdateTransforms has to run first
+    void SetScene( const Scene& scene );
+    //Entities whose transform changes at runtime, they and their children get rewritten every frame
+    void MarkDynamic( const Scene& scene, Entity entity );
+
+    //Has to be recorded outside of the render pass
+    void Cull( FrameInfo& frameinfo, const Scene& scene );
+    void Render( FrameInfo& frameinfo );
+
+    //The pipelines draw both faces, so a cluster facing away is only hidden when the mesh around it is closed.
+    //Culling those isn't conservative for open meshes seen from behind, so it's off unless asked for
+    void SetConeCullingEnabled( bool enabled ) { m_ConeCullingEnabled = enabled; }
+
+    uint32_t GetObjectCount() const { return static_cast< uint32_t >( m_Objects.size() ); }
+    //Meshlets of all objects, the most draws the cull pass can write
+    uint32_t GetClusterCount() const { return static_cast< uint32_t >( m_ClusterInstances.size() ); }
+
+    //Matches ObjectData in cullObjects.comp and shaderIndirect.vert (std430)
+    struct ObjectData
+    {
+        glm::mat4 modelMatrix{ 1.f };
+        glm::mat4 normalMatrix{ 1.f };
+        glm::vec4 boundsCenter{ 0.f };
+        glm::vec4 boundsExtent{ 0.f };
+    };
+
+    //Matches ClusterData in cullObjects.comp, one per meshlet of the packed meshes
+    struct ClusterData
+    {
+        glm::vec4 sphere{ 0.f };    //Local center, radius
+        glm::vec4 cone{ 0.f };      //Local axis, cutoff
+        uint32_t indexCount = 0;
+        uint32_t firstIndex = 0;
+        int32_t vertexOffset = 0;   //The meshlet's lowest vertex, its indices are relative to it
+        uint32_t padding = 0;
+    };
+
+    //One invocation of the cull pass
+    struct ClusterInstance
+    {
+        uint32_t objectIndex = 0;
+        uint32_t clusterIndex = 0;
+    };
+
+private:
+    struct MeshRange
+    {
+        uint32_t firstCluster = 0;
+        uint32_t clusterCount = 0;
+    };
+
+    struct FrameResources
+    {
+        std::unique_ptr<Buffer> objectBuffer;
+        std::unique_ptr<Buffer> drawBuffer;
+        std::unique_ptr<Buffer> countBuffer;
+        VkDescriptorSet cullSet = VK_NULL_HANDLE;
+        VkDescriptorSet objectSet = VK_NULL_HANDLE;
+    };
+
+    void CreateDescriptorLayouts();
+    void CreatePipelineLayout( VkDescriptorSetLayout globalSetLayout );
+    void CreatePipelines( VkRenderPass renderPass, PipelineBuilder& pipelineBuilder );
+    void UploadMeshes( const Scene& scene );
+    void UploadClusterInstances();
+    void CreateFrameResources();
+    void WriteObject( const Scene& scene, uint32_t denseIndex, ObjectData& object );
+    bool IsDynamic( const Scene& scene, Entity entity ) const;
+    //Object slots of the dynamic entities and everything attached to them, so Cull only visits those
+    void FindDynamicObjects( const Scene& scene );
+
+    EngineDevice& m_EngineDevice;
+
+    std::unique_ptr<DescriptorSetLayout> m_CullSetLayout;
+    std::unique_ptr<DescriptorSetLayout> m_ObjectSetLayout;
+    std::unique_ptr<DescriptorPool> m_DescriptorPool;
+
+    VkPipelineLayout m_PipelineLayout = VK_NULL_HANDLE;
+    std::unique_ptr<Pipeline> m_Pipeline;
+    std::unique_ptr<Pipeline> m_CullPipeline;
+    PipelineFuture m_PipelineFuture;
+    PipelineFuture m_CullPipelineFuture;
+
+    std::unique_ptr<Buffer> m_VertexBuffer;
+    std::unique_ptr<Buffer> m_IndexBuffer;
+    VkIndexType m_IndexType = VK_INDEX_TYPE_UINT32; //16 bit when every meshlet fits, indices are relative to vertexOffset
+    std::unique_ptr<Buffer> m_ClusterBuffer;
+    std::vector<MeshRange> m_MeshRanges;            //Indexed by model handle
+    std::unique_ptr<Buffer> m_ClusterInstanceBuffer;
+    std::vector<ClusterInstance> m_ClusterInstances;
+    bool m_ConeCullingEnabled = false;
+
+    std::vector<ObjectData> m_Objects;
+    std::vector<Entity> m_ObjectEntities;           //Entity behind every entry of m_Objects
+    std::vector<Entity> m_DynamicEntities;
+    std::vector<uint32_t> m_DynamicObjects;         //Indices into m_Objects
+    std::vector<FrameResources> m_Frames;
+};
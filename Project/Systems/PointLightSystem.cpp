@@ -6,17 +6,18 @@
 #include <array>
 #include "Window.h"
 #include <iostream>
-#include "GameObject.h"
 #include <glm/gtc/constants.hpp>
 #include "Renderer.h"
 #include "Camera.h"
+#include "Profiler.h"
 
 PointLightSystem::PointLightSystem( EngineDevice& device,
-	VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout )
+	VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout,
+	PipelineBuilder& pipelineBuilder )
 :m_EngineDevice{ device }
 {
 	CreatePipelineLayout( globalSetLayout );
-	CreatePipeline( renderPass );
+	CreatePipeline( renderPass, pipelineBuilder );
 }
 
 PointLightSystem::~PointLightSystem()
@@ -49,26 +50,30 @@ void PointLightSystem::CreatePipelineLayout( VkDescriptorSetLayout globalSetLayo
 	}
 }
 
-void PointLightSystem::CreatePipeline( VkRenderPass renderPass )
+void PointLightSystem::CreatePipeline( VkRenderPass renderPass, PipelineBuilder& pipelineBuilder )
 {
 	assert( m_PipelineLayout != nullptr && "Cannot create pipeline before pipeline layout" );
 
-	PipelineConfigInfo pipelineConfig{};
-	Pipeline::defaultPipelineConfigInfo( pipelineConfig );
-	pipelineConfig.attributeDescriptions.clear();
-	pipelineConfig.bindingDescriptions.clear();
-
-	pipelineConfig.renderPass = renderPass;
-	pipelineConfig.pipelineLayout = m_PipelineLayout;
-	m_Pipeline = std::make_unique<Pipeline>(
-		m_EngineDevice,
+	VkPipelineLayout pipelineLayout = m_PipelineLayout;
+	m_PipelineFuture = pipelineBuilder.Submit(
 		"shaders/pointLight.vert.spv",
 		"shaders/pointLight.frag.spv",
-		pipelineConfig );
+		[ renderPass, pipelineLayout ]( PipelineConfigInfo& pipelineConfig )
+		{
+			pipelineConfig.attributeDescriptions.clear();
+			pipelineConfig.bindingDescriptions.clear();
+
+			pipelineConfig.renderPass = renderPass;
+			pipelineConfig.pipelineLayout = pipelineLayout;
+		} );
 }
 
 void PointLightSystem::Render( FrameInfo& frameinfo)
 {
+	PROFILE_FUNCTION();
+	GpuProfiler::Scope gpuScope{ frameinfo.gpuProfiler, frameinfo.commandBuffer, "PointLightSystem" };
+	PipelineBuilder::Resolve( m_PipelineFuture, m_Pipeline );
+
 	m_Pipeline->Bind( frameinfo.commandBuffer );
 
 	vkCmdBindDescriptorSets( frameinfo.commandBuffer,
@@ -78,10 +83,12 @@ void PointLightSystem::Render( FrameInfo& frameinfo)
 		0, nullptr );
 
 	vkCmdDraw( frameinfo.commandBuffer, 6, 1, 0, 0 );
+	frameinfo.drawCallCount++;
 }
 
 void PointLightSystem::Update( FrameInfo& frameinfo, GlobalUbo& ubo )
 {
+	PROFILE_FUNCTION();
 	auto currentTime = std::chrono::high_resolution_clock::now();
 	std::chrono::duration<float> elapsedTime = currentTime - lastTime;
 	frameinfo.deltaTime = elapsedTime.count();
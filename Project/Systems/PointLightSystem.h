@@ -3,9 +3,9 @@
 #include <vector>
 
 #include "Pipeline.h"
+#include "PipelineBuilder.h"
 #include "EngineDevice.h"
 #include "SwapChain.h"
-#include "GameObject.h"
 #include "Camera.h"
 #include "FrameInfo.h"
 
@@ -14,7 +14,8 @@ class PointLightSystem
 public:
     PointLightSystem( EngineDevice& device,
     VkRenderPass renderPass,
-        VkDescriptorSetLayout globalSetLayout );
+        VkDescriptorSetLayout globalSetLayout,
+        PipelineBuilder& pipelineBuilder );
     ~PointLightSystem();
 
     PointLightSystem( const PointLightSystem& ) = delete;
@@ -25,11 +26,12 @@ public:
 
 private:
     void CreatePipelineLayout( VkDescriptorSetLayout globalSetLayout );
-    void CreatePipeline( VkRenderPass renderPass );
+    void CreatePipeline( VkRenderPass renderPass, PipelineBuilder& pipelineBuilder );
 
     EngineDevice& m_EngineDevice;
 
     std::unique_ptr<Pipeline> m_Pipeline;
+    PipelineFuture m_PipelineFuture;
     VkPipelineLayout m_PipelineLayout;
 
     float timeAccumulator{};
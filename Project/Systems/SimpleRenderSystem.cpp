@@ -4,12 +4,15 @@
 
 #include <stdexcept>
 #include <array>
+#include <algorithm>
+#include <cmath>
 #include "Window.h"
 #include <iostream>
-#include "GameObject.h"
+#include "Scene.h"
 #include <glm/gtc/constants.hpp>
 #include "Renderer.h"
 #include "Camera.h"
+#include "Profiler.h"
 
 struct SimplePushConstantData
 {
@@ -18,11 +21,12 @@ struct SimplePushConstantData
 };
 
 SimpleRenderSystem::SimpleRenderSystem( EngineDevice& device,
-	VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout )
+	VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout,
+	PipelineBuilder& pipelineBuilder )
 :m_EngineDevice{ device }
 {
 	CreatePipelineLayout( globalSetLayout );
-	CreatePipeline( renderPass );
+	CreatePipeline( renderPass, pipelineBuilder );
 }
 
 SimpleRenderSystem::~SimpleRenderSystem()
@@ -55,45 +59,392 @@ void SimpleRenderSystem::CreatePipelineLayout( VkDescriptorSetLayout globalSetLa
 	}
 }
 
-void SimpleRenderSystem::CreatePipeline( VkRenderPass renderPass )
+void SimpleRenderSystem::CreatePipeline( VkRenderPass renderPass, PipelineBuilder& pipelineBuilder )
 {
 	assert( m_PipelineLayout != nullptr && "Cannot create pipeline before pipeline layout" );
 
-	PipelineConfigInfo pipelineConfig{};
-	Pipeline::defaultPipelineConfigInfo( pipelineConfig );
-	pipelineConfig.renderPass = renderPass;
-	pipelineConfig.pipelineLayout = m_PipelineLayout;
-	m_Pipeline = std::make_unique<Pipeline>(
-		m_EngineDevice,
-		"shaders/shader.vert.spv",
+	CreateLayoutPipelines<Model::Vertex>( renderPass, pipelineBuilder,
+		"shaders/shader.vert.spv", "shaders/shaderInstanced.vert.spv" );
+	CreateLayoutPipelines<Model::CompactVertex>( renderPass, pipelineBuilder,
+		"shaders/shaderCompact.vert.spv", "shaders/shaderInstancedCompact.vert.spv" );
+}
+
+template<typename VertexType>
+void SimpleRenderSystem::CreateLayoutPipelines( VkRenderPass renderPass, PipelineBuilder& pipelineBuilder,
+	const std::string& vertFile, const std::string& instancedVertFile )
+{
+	const uint32_t layout = static_cast< uint32_t >( VertexType::LAYOUT );
+	VkPipelineLayout pipelineLayout = m_PipelineLayout;
+	m_PipelineFutures[ layout ] = pipelineBuilder.Submit(
+		vertFile,
+		"shaders/shader.frag.spv",
+		[ renderPass, pipelineLayout ]( PipelineConfigInfo& pipelineConfig )
+		{
+			pipelineConfig.renderPass = renderPass;
+			pipelineConfig.pipelineLayout = pipelineLayout;
+			pipelineConfig.bindingDescriptions = VertexType::GetBindingDescriptions();
+			pipelineConfig.attributeDescriptions = VertexType::GetAttributeDescriptions();
+		} );
+
+	//Same state, plus the per instance matrices on binding 1
+	m_InstancedPipelineFutures[ layout ] = pipelineBuilder.Submit(
+		instancedVertFile,
 		"shaders/shader.frag.spv",
-		pipelineConfig );
+		[ renderPass, pipelineLayout ]( PipelineConfigInfo& pipelineConfig )
+		{
+			pipelineConfig.renderPass = renderPass;
+			pipelineConfig.pipelineLayout = pipelineLayout;
+			pipelineConfig.bindingDescriptions = VertexType::GetBindingDescriptions();
+			pipelineConfig.attributeDescriptions = VertexType::GetAttributeDescriptions();
+
+			auto instanceBindings = InstanceData::GetBindingDescriptions();
+			auto instanceAttributes = InstanceData::GetAttributeDescriptions();
+			pipelineConfig.bindingDescriptions.insert( pipelineConfig.bindingDescriptions.end(),
+				instanceBindings.begin(), instanceBindings.end() );
+			pipelineConfig.attributeDescriptions.insert( pipelineConfig.attributeDescriptions.end(),
+				instanceAttributes.begin(), instanceAttributes.end() );
+		} );
+}
+
+std::vector<VkVertexInputBindingDescription>
+SimpleRenderSystem::InstanceData::GetBindingDescriptions()
+{
+	std::vector<VkVertexInputBindingDescription>
+		bindingDescriptions( 1 );
+	bindingDescriptions[ 0 ].binding = 1;
+	bindingDescriptions[ 0 ].stride = sizeof( InstanceData );
+	bindingDescriptions[ 0 ].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+	return bindingDescriptions;
+}
+
+std::vector<VkVertexInputAttributeDescription>
+SimpleRenderSystem::InstanceData::GetAttributeDescriptions()
+{
+	std::vector<VkVertexInputAttributeDescription>
+		attributeDescriptions;
+
+	//A mat4 attribute is 4 vec4 locations
+	for ( uint32_t column = 0; column < 4; column++ )
+	{
+		attributeDescriptions.push_back(
+			{ 4 + column, 1, VK_FORMAT_R32G32B32A32_SFLOAT,
+			static_cast< uint32_t >( offsetof( InstanceData, modelMatrix ) + column * sizeof( glm::vec4 ) ) } );
+	}
+	for ( uint32_t column = 0; column < 4; column++ )
+	{
+		attributeDescriptions.push_back(
+			{ 8 + column, 1, VK_FORMAT_R32G32B32A32_SFLOAT,
+			static_cast< uint32_t >( offsetof( InstanceData, normalMatrix ) + column * sizeof( glm::vec4 ) ) } );
+	}
+
+	return attributeDescriptions;
+}
+
+void SimpleRenderSystem::RenderScene( FrameInfo& frameinfo, const Scene& scene )
+{
+	PROFILE_FUNCTION();
+	GpuProfiler::Scope gpuScope{ frameinfo.gpuProfiler, frameinfo.commandBuffer, "SimpleRenderSystem" };
+	for ( uint32_t layout = 0; layout < VERTEX_LAYOUT_COUNT; layout++ )
+	{
+		PipelineBuilder::Resolve( m_PipelineFutures[ layout ], m_Pipelines[ layout ] );
+		PipelineBuilder::Resolve( m_InstancedPipelineFutures[ layout ], m_InstancedPipelines[ layout ] );
+	}
+
+	CullScene( frameinfo, scene );
+
+	if ( m_InstancingEnabled )
+	{
+		PrepareInstances( frameinfo );
+		RenderInstanceGroups( frameinfo, 0, static_cast< uint32_t >( m_InstanceGroups.size() ) );
+	}
+	else
+	{
+		RenderPerObject( frameinfo, 0, static_cast< uint32_t >( m_VisibleObjects.size() ) );
+	}
+}
+
+void SimpleRenderSystem::RenderScene( FrameInfo& frameinfo, const Scene& scene, ParallelRecorder& recorder )
+{
+	PROFILE_FUNCTION();
+	for ( uint32_t layout = 0; layout < VERTEX_LAYOUT_COUNT; layout++ )
+	{
+		PipelineBuilder::Resolve( m_PipelineFutures[ layout ], m_Pipelines[ layout ] );
+		PipelineBuilder::Resolve( m_InstancedPipelineFutures[ layout ], m_InstancedPipelines[ layout ] );
+	}
+
+	CullScene( frameinfo, scene );
+
+	//Culling and the instance buffer stay on this thread, only the draw recording is split
+	if ( m_InstancingEnabled )
+	{
+		PrepareInstances( frameinfo );
+		recorder.Record( frameinfo, static_cast< uint32_t >( m_InstanceGroups.size() ), MIN_GROUPS_PER_RANGE,
+			[ this ]( FrameInfo& rangeInfo, uint32_t begin, uint32_t end )
+			{
+				RenderInstanceGroups( rangeInfo, begin, end );
+			} );
+	}
+	else
+	{
+		recorder.Record( frameinfo, static_cast< uint32_t >( m_VisibleObjects.size() ), MIN_OBJECTS_PER_RANGE,
+			[ this ]( FrameInfo& rangeInfo, uint32_t begin, uint32_t end )
+			{
+				RenderPerObject( rangeInfo, begin, end );
+			} );
+	}
+}
+
+void SimpleRenderSystem::CullScene( FrameInfo& frameinfo, const Scene& scene )
+{
+	PROFILE_FUNCTION();
+	m_Scene = &scene;
+	m_VisibleObjects.clear();
+
+	const ComponentSpan<const ModelHandle> models = scene.GetModels();
+	uint32_t candidateCount = 0;
+
+	if ( m_FrustumCullingEnabled )
+	{
+		const Frustum frustum{ frameinfo.camera.GetViewProjectionMatrix() };
+		frustum.TestBoxes( scene.GetWorldBounds(), m_Visibility );
+	}
+
+	for ( uint32_t i = 0; i < models.size(); i++ )
+	{
+		if ( models[ i ] == INVALID_MODEL ) continue;
+
+		candidateCount++;
+		if ( !m_FrustumCullingEnabled || m_Visibility[ i ] )
+		{
+			m_VisibleObjects.push_back( i );
+		}
+	}
+
+	m_CullingStats.visibleCount = static_cast< uint32_t >( m_VisibleObjects.size() );
+	m_CullingStats.culledCount = candidateCount - m_CullingStats.visibleCount;
+
+	SelectLods( frameinfo, scene );
+}
+
+void SimpleRenderSystem::SelectLods( FrameInfo& frameinfo, const Scene& scene )
+{
+	PROFILE_FUNCTION();
+	m_VisibleLods.assign( m_VisibleObjects.size(), 0 );
+	m_CullingStats.lodCounts.fill( 0 );
+
+	if ( !m_LodEnabled )
+	{
+		m_CullingStats.lodCounts[ 0 ] = static_cast< uint32_t >( m_VisibleObjects.size() );
+		return;
+	}
+
+	//Pixels a mesh unit covers at distance 1 from the camera
+	const float pixelsPerUnit = frameinfo.camera.GetProjectionMatrix()[ 1 ][ 1 ] * 0.5f * static_cast< float >( m_ViewportHeight );
+	const glm::vec3 cameraPosition = frameinfo.camera.GetPosition();
+	const BoundingBoxBatch& bounds = scene.GetWorldBounds();
+	const ComponentSpan<const glm::mat4> worldMatrices = scene.GetWorldMatrices();
+	const ComponentSpan<const ModelHandle> models = scene.GetModels();
+	const ComponentSpan<const Entity> entities = scene.GetEntities();
+
+	for ( size_t i = 0; i < m_VisibleObjects.size(); i++ )
+	{
+		const uint32_t object = m_VisibleObjects[ i ];
+		const Model* model = scene.GetModel( models[ object ] );
+		const uint32_t lodCount = model->GetLodCount();
+		if ( lodCount <= 1 )
+		{
+			m_CullingStats.lodCounts[ 0 ]++;
+			continue;
+		}
+
+		//Distance to the nearest point of the bounding sphere, the largest axis scale stretches the error the most
+		const glm::vec3 center{ bounds.centerX[ object ], bounds.centerY[ object ], bounds.centerZ[ object ] };
+		const glm::vec3 extent{ bounds.extentX[ object ], bounds.extentY[ object ], bounds.extentZ[ object ] };
+		const float distance = std::max( glm::length( center - cameraPosition ) - glm::length( extent ), 1e-3f );
+		const glm::mat4& world = worldMatrices[ object ];
+		const float scale = std::sqrt( std::max( { glm::dot( glm::vec3( world[ 0 ] ), glm::vec3( world[ 0 ] ) ),
+			glm::dot( glm::vec3( world[ 1 ] ), glm::vec3( world[ 1 ] ) ),
+			glm::dot( glm::vec3( world[ 2 ] ), glm::vec3( world[ 2 ] ) ) } ) );
+		const float errorToPixels = scale * pixelsPerUnit / distance;
+
+		const uint32_t entityIndex = entities[ object ].index;
+		if ( entityIndex >= m_EntityLods.size() )
+		{
+			m_EntityLods.resize( entityIndex + 1, 0 );
+		}
+
+		uint32_t lod = std::min<uint32_t>( m_EntityLods[ entityIndex ], lodCount - 1 );
+		while ( lod > 0 && model->GetLodError( lod ) * errorToPixels > LOD_ERROR_PIXELS * ( 1.f + LOD_HYSTERESIS ) )
+		{
+			lod--;
+		}
+		while ( lod + 1 < lodCount && model->GetLodError( lod + 1 ) * errorToPixels <= LOD_ERROR_PIXELS * ( 1.f - LOD_HYSTERESIS ) )
+		{
+			lod++;
+		}
+
+		m_EntityLods[ entityIndex ] = static_cast< uint8_t >( lod );
+		m_VisibleLods[ i ] = static_cast< uint8_t >( lod );
+		m_CullingStats.lodCounts[ lod ]++;
+	}
 }
 
-void SimpleRenderSystem::RenderGameObjects( 
-	FrameInfo& frameinfo,
-	std::vector<GameObject>& gameObjects )
+void SimpleRenderSystem::RenderPerObject( FrameInfo& frameinfo, uint32_t begin, uint32_t end )
 {
-	m_Pipeline->Bind( frameinfo.commandBuffer );
+	if ( begin == end )
+	{
+		return;
+	}
 
+	//The pipelines share one layout, so the descriptor set stays bound across switches
 	vkCmdBindDescriptorSets( frameinfo.commandBuffer,
 				VK_PIPELINE_BIND_POINT_GRAPHICS,
 				m_PipelineLayout, 0, 1,
 		&frameinfo.globalDescriptorSet, 
 		0, nullptr );
 
-	for ( auto& obj : gameObjects )
+	const ComponentSpan<const glm::mat4> worldMatrices = m_Scene->GetWorldMatrices();
+	const ComponentSpan<const glm::mat4> normalMatrices = m_Scene->GetNormalMatrices();
+	const ComponentSpan<const ModelHandle> models = m_Scene->GetModels();
+	Pipeline* boundPipeline = nullptr;
+	for ( uint32_t i = begin; i < end; i++ )
 	{
+		const uint32_t object = m_VisibleObjects[ i ];
+		Model* model = m_Scene->GetModel( models[ object ] );
+
+		Pipeline* pipeline = m_Pipelines[ static_cast< uint32_t >( model->GetVertexLayout() ) ].get();
+		if ( pipeline != boundPipeline )
+		{
+			pipeline->Bind( frameinfo.commandBuffer );
+			boundPipeline = pipeline;
+		}
+
 		SimplePushConstantData push{};
 
-		push.modelMatrix = obj.m_Transform.mat4();
-		push.normalMatrix = obj.m_Transform.normalMatrix();
+		push.modelMatrix = model->GetDrawMatrix( worldMatrices[ object ] );
+		push.normalMatrix = normalMatrices[ object ];
 
 		vkCmdPushConstants( frameinfo.commandBuffer, m_PipelineLayout,
 			VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
 			0, sizeof( SimplePushConstantData ), &push );
 
-		obj.m_Model->Bind( frameinfo.commandBuffer );
-		obj.m_Model->Draw( frameinfo.commandBuffer );
+		model->Bind( frameinfo.commandBuffer );
+		frameinfo.drawCallCount += model->Draw( frameinfo.commandBuffer, 1, 0, m_VisibleLods[ i ] );
+	}
+}
+
+void SimpleRenderSystem::PrepareInstances( FrameInfo& frameinfo )
+{
+	//Count the instances of every model lod, then give each of them a contiguous range
+	m_InstanceGroups.clear();
+	m_GroupIndices.assign( m_Scene->GetModelCount() * Model::MAX_LODS, INVALID_GROUP );
+	m_CurrentInstanceBuffer = VK_NULL_HANDLE;
+
+	const ComponentSpan<const ModelHandle> models = m_Scene->GetModels();
+	for ( size_t i = 0; i < m_VisibleObjects.size(); i++ )
+	{
+		const ModelHandle handle = models[ m_VisibleObjects[ i ] ];
+		const uint32_t lod = m_VisibleLods[ i ];
+		uint32_t& groupIndex = m_GroupIndices[ handle * Model::MAX_LODS + lod ];
+		if ( groupIndex == INVALID_GROUP )
+		{
+			groupIndex = static_cast< uint32_t >( m_InstanceGroups.size() );
+			m_InstanceGroups.push_back( { handle, lod, m_Scene->GetModel( handle ), 0, 0 } );
+		}
+		m_InstanceGroups[ groupIndex ].instanceCount++;
+	}
+
+	if ( m_InstanceGroups.empty() )
+	{
+		return;
+	}
+
+	//Groups of one vertex layout next to each other, a range then switches pipeline at most once per layout
+	std::stable_sort( m_InstanceGroups.begin(), m_InstanceGroups.end(),
+		[]( const InstanceGroup& a, const InstanceGroup& b )
+		{
+			return a.model->GetVertexLayout() < b.model->GetVertexLayout();
+		} );
+	for ( uint32_t i = 0; i < m_InstanceGroups.size(); i++ )
+	{
+		m_GroupIndices[ m_InstanceGroups[ i ].handle * Model::MAX_LODS + m_InstanceGroups[ i ].lod ] = i;
+	}
+
+	uint32_t totalInstances = 0;
+	for ( auto& group : m_InstanceGroups )
+	{
+		group.firstInstance = totalInstances;
+		totalInstances += group.instanceCount;
+		group.instanceCount = 0;
+	}
+
+	Buffer& instanceBuffer = GetInstanceBuffer( frameinfo.frameIndex, totalInstances );
+	auto* instances = static_cast< InstanceData* >( instanceBuffer.getMappedMemory() );
+	const ComponentSpan<const glm::mat4> worldMatrices = m_Scene->GetWorldMatrices();
+	const ComponentSpan<const glm::mat4> normalMatrices = m_Scene->GetNormalMatrices();
+	for ( size_t i = 0; i < m_VisibleObjects.size(); i++ )
+	{
+		const uint32_t object = m_VisibleObjects[ i ];
+		InstanceGroup& group = m_InstanceGroups[ m_GroupIndices[ models[ object ] * Model::MAX_LODS + m_VisibleLods[ i ] ] ];
+		InstanceData& instance = instances[ group.firstInstance + group.instanceCount++ ];
+		instance.modelMatrix = group.model->GetDrawMatrix( worldMatrices[ object ] );
+		instance.normalMatrix = normalMatrices[ object ];
+	}
+	instanceBuffer.flush();
+	m_CurrentInstanceBuffer = instanceBuffer.getBuffer();
+}
+
+void SimpleRenderSystem::RenderInstanceGroups( FrameInfo& frameinfo, uint32_t begin, uint32_t end )
+{
+	if ( begin == end )
+	{
+		return;
 	}
-}
\ No newline at end of file
+
+	vkCmdBindDescriptorSets( frameinfo.commandBuffer,
+				VK_PIPELINE_BIND_POINT_GRAPHICS,
+				m_PipelineLayout, 0, 1,
+		&frameinfo.globalDescriptorSet, 
+		0, nullptr );
+
+	VkBuffer buffers[] = { m_CurrentInstanceBuffer };
+	VkDeviceSize offsets[] = { 0 };
+	vkCmdBindVertexBuffers( frameinfo.commandBuffer, 1, 1, buffers, offsets );
+
+	Pipeline* boundPipeline = nullptr;
+	for ( uint32_t i = begin; i < end; i++ )
+	{
+		const InstanceGroup& group = m_InstanceGroups[ i ];
+
+		Pipeline* pipeline = m_InstancedPipelines[ static_cast< uint32_t >( group.model->GetVertexLayout() ) ].get();
+		if ( pipeline != boundPipeline )
+		{
+			pipeline->Bind( frameinfo.commandBuffer );
+			boundPipeline = pipeline;
+		}
+
+		group.model->Bind( frameinfo.commandBuffer );
+		frameinfo.drawCallCount += group.model->Draw( frameinfo.commandBuffer, group.instanceCount, group.firstInstance, group.lod );
+	}
+}
+
+Buffer& SimpleRenderSystem::GetInstanceBuffer( int frameIndex, uint32_t instanceCount )
+{
+	if ( m_InstanceBuffers.empty() )
+	{
+		m_InstanceBuffers.resize( SwapChain::MAX_FRAMES_IN_FLIGHT );
+	}
+
+	//Safe to replace, the fence of this frame index was waited on before recording
+	auto& instanceBuffer = m_InstanceBuffers[ frameIndex ];
+	if ( instanceBuffer == nullptr || instanceBuffer->getInstanceCount() < instanceCount )
+	{
+		uint32_t capacity = std::max( instanceCount, instanceBuffer ? instanceBuffer->getInstanceCount() * 2 : 64u );
+
+		instanceBuffer = std::make_unique<Buffer>( m_EngineDevice, sizeof( InstanceData ), capacity,
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT );
+		instanceBuffer->map();
+	}
+	return *instanceBuffer;
+}
@@ -1,34 +1,131 @@
 #pragma once
 #include <memory>
 #include <vector>
+#include <array>
 
 #include "Pipeline.h"
+#include "PipelineBuilder.h"
 #include "EngineDevice.h"
 #include "SwapChain.h"
-#include "GameObject.h"
+#include "Scene.h"
 #include "Camera.h"
 #include "FrameInfo.h"
+#include "Buffer.h"
+#include "Frustum.h"
+#include "ParallelRecorder.h"
 
 class SimpleRenderSystem
 {
 public:
+    //The pipelines are built on the builder's threads, the first RenderScene waits for them
     SimpleRenderSystem( EngineDevice& device,
     VkRenderPass renderPass,
-        VkDescriptorSetLayout globalSetLayout );
+        VkDescriptorSetLayout globalSetLayout,
+        PipelineBuilder& pipelineBuilder );
     ~SimpleRenderSystem();
 
     SimpleRenderSystem( const SimpleRenderSystem& ) = delete;
     SimpleRenderSystem( SimpleRenderSystem&& ) = delete;
 
-    void RenderGameObjects( FrameInfo& frameinfo,
-    std::vector<GameObject>& gameObjects);
+    //Per instance data for the instanced pipeline, read through vertex binding 1
+    struct InstanceData
+    {
+        glm::mat4 modelMatrix{ 1.f };
+        glm::mat4 normalMatrix{ 1.f };
+
+        static std::vector<VkVertexInputBindingDescription> GetBindingDescriptions();
+        static std::vector<VkVertexInputAttributeDescription> GetAttributeDescriptions();
+    };
+
+    //Reads the matrices and world bounds of the last Scene::UpdateTransforms
+    void RenderScene( FrameInfo& frameinfo, const Scene& scene );
+    //Same draws, recorded into secondary command buffers over object ranges in parallel
+    void RenderScene( FrameInfo& frameinfo, const Scene& scene, ParallelRecorder& recorder );
+
+    //Instanced: one draw per unique model, otherwise one push constant + draw per object
+    void SetInstancingEnabled( bool enabled ) { m_InstancingEnabled = enabled; }
+    bool IsInstancingEnabled() const { return m_InstancingEnabled; }
+
+    struct CullingStats
+    {
+        uint32_t visibleCount = 0;
+        uint32_t culledCount = 0;
+        //Visible objects per lod
+        std::array<uint32_t, Model::MAX_LODS> lodCounts{};
+    };
+    //Objects outside the camera frustum are skipped before any draw is recorded
+    void SetFrustumCullingEnabled( bool enabled ) { m_FrustumCullingEnabled = enabled; }
+    //Counts of the last RenderScene call
+    const CullingStats& GetCullingStats() const { return m_CullingStats; }
+
+    //Every visible object draws the coarsest lod whose error stays under LOD_ERROR_PIXELS on screen
+    void SetLodEnabled( bool enabled ) { m_LodEnabled = enabled; }
+    //Render target height in pixels, turns the projected lod errors into pixels
+    void SetViewportHeight( uint32_t height ) { m_ViewportHeight = height; }
 
 private:
+    //Below this a range costs more in hand off than it saves in recording
+    static constexpr uint32_t MIN_OBJECTS_PER_RANGE = 256;
+    static constexpr uint32_t MIN_GROUPS_PER_RANGE = 32;
+
+    static constexpr float LOD_ERROR_PIXELS = 1.f;
+    //An object only goes coarser once the next lod is this much under the limit, and finer once
+    //its lod is this much over it, so objects near a switch distance don't flip every frame
+    static constexpr float LOD_HYSTERESIS = 0.25f;
+
+    struct InstanceGroup
+    {
+        ModelHandle handle = INVALID_MODEL;
+        uint32_t lod = 0;
+        Model* model = nullptr;
+        uint32_t firstInstance = 0;
+        uint32_t instanceCount = 0;
+    };
+
     void CreatePipelineLayout( VkDescriptorSetLayout globalSetLayout );
-    void CreatePipeline( VkRenderPass renderPass );
+    void CreatePipeline( VkRenderPass renderPass, PipelineBuilder& pipelineBuilder );
+    //Both pipelines of one vertex layout, the vertex struct supplies binding 0
+    template<typename VertexType>
+    void CreateLayoutPipelines( VkRenderPass renderPass, PipelineBuilder& pipelineBuilder,
+        const std::string& vertFile, const std::string& instancedVertFile );
+
+    //Fills m_VisibleObjects with the dense index of every entity that has a model and touches the frustum
+    void CullScene( FrameInfo& frameinfo, const Scene& scene );
+    //Fills m_VisibleLods, starting from the lod every entity had last frame
+    void SelectLods( FrameInfo& frameinfo, const Scene& scene );
+    void RenderPerObject( FrameInfo& frameinfo, uint32_t begin, uint32_t end );
+    //Groups the visible objects per model and writes their matrices to this frame's instance buffer
+    void PrepareInstances( FrameInfo& frameinfo );
+    void RenderInstanceGroups( FrameInfo& frameinfo, uint32_t begin, uint32_t end );
+    Buffer& GetInstanceBuffer( int frameIndex, uint32_t instanceCount );
 
     EngineDevice& m_EngineDevice;
 
-    std::unique_ptr<Pipeline> m_Pipeline;
+    //One per VertexLayout, draws switch pipeline only where the layout changes
+    std::array<std::unique_ptr<Pipeline>, VERTEX_LAYOUT_COUNT> m_Pipelines;
+    std::array<std::unique_ptr<Pipeline>, VERTEX_LAYOUT_COUNT> m_InstancedPipelines;
+    std::array<PipelineFuture, VERTEX_LAYOUT_COUNT> m_PipelineFutures;
+    std::array<PipelineFuture, VERTEX_LAYOUT_COUNT> m_InstancedPipelineFutures;
     VkPipelineLayout m_PipelineLayout;
+
+    bool m_InstancingEnabled = true;
+    bool m_FrustumCullingEnabled = true;
+    bool m_LodEnabled = true;
+    uint32_t m_ViewportHeight = 600;
+
+    CullingStats m_CullingStats{};
+    //Scene of the current RenderScene call, the range functions read its components
+    const Scene* m_Scene = nullptr;
+    std::vector<uint32_t> m_VisibleObjects;
+    std::vector<uint8_t> m_VisibleLods;         //Lod of every entry of m_VisibleObjects
+    std::vector<uint8_t> m_EntityLods;          //Entity index -> lod of its last frame
+    std::vector<uint8_t> m_Visibility;
+
+    //One per frame in flight, so the cpu never writes what the gpu is still reading
+    std::vector<std::unique_ptr<Buffer>> m_InstanceBuffers;
+    std::vector<InstanceGroup> m_InstanceGroups;
+    VkBuffer m_CurrentInstanceBuffer = VK_NULL_HANDLE;
+    //Model handle * MAX_LODS + lod -> instance group, INVALID_GROUP for lods without visible instances
+    static constexpr uint32_t INVALID_GROUP = ~0u;
+    std::vector<uint32_t> m_GroupIndices;
 };
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+#include <iostream>
+#include <functional>
+#include <string>
+#include <vector>
+
+//Minimal assertions for the cpu only test executables, a failed check marks its test as failed and keeps going
+inline int& GetFailedCheckCount()
+{
+    static int failedChecks = 0;
+    return failedChecks;
+}
+
+#define CHECK( condition ) \
+    do \
+    { \
+        if ( !( condition ) ) \
+        { \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK( " #condition " ) failed" << std::endl; \
+            GetFailedCheckCount()++; \
+        } \
+    } while ( false )
+
+struct TestCase
+{
+    const char* name;
+    std::function<void()> run;
+};
+
+//Runs every test, returns the process exit code ctest reads
+inline int RunTests( const std::vector<TestCase>& tests )
+{
+    int failedTests = 0;
+    for ( const TestCase& test : tests )
+    {
+        const int failedBefore = GetFailedCheckCount();
+        try
+        {
+            test.run();
+        }
+        catch ( const std::exception& exception )
+        {
+            std::cerr << test.name << ": unexpected exception: " << exception.what() << std::endl;
+            GetFailedCheckCount()++;
+        }
+
+        const bool passed = GetFailedCheckCount() == failedBefore;
+        failedTests += passed ? 0 : 1;
+        std::cerr << ( passed ? "[pass] " : "[FAIL] " ) << test.name << std::endl;
+    }
+    return failedTests == 0 ? 0 : 1;
+}
@@ -0,0 +1,65 @@
+#include "JobSystem.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+//Throughput of tiny jobs and the speedup of ParallelFor over a serial loop, on the engine's shared job system
+int main()
+{
+    using Clock = std::chrono::high_resolution_clock;
+    auto milliseconds = []( Clock::time_point start )
+        {
+            return std::chrono::duration<double, std::milli>( Clock::now() - start ).count();
+        };
+
+    JobSystem& jobs = JobSystem::Get();
+    std::cout << "job system: " << jobs.GetWorkerCount() << " workers" << std::endl;
+
+    {
+        constexpr uint32_t jobCount = 200000;
+        std::atomic<uint32_t> counter{ 0 };
+        auto start = Clock::now();
+        JobSystem::JobHandle parent = jobs.CreateJob( nullptr );
+        jobs.Run( jobs.CreateChildJob( parent, [ & ]()
+            {
+                //Spawned from a worker, so they go through its deque and get stolen
+                for ( uint32_t i = 0; i < jobCount; i++ )
+                {
+                    jobs.Run( jobs.CreateChildJob( parent, [ & ]() { counter.fetch_add( 1, std::memory_order_relaxed ); } ) );
+                }
+            } ) );
+        jobs.Run( parent );
+        jobs.Wait( parent );
+        const double elapsed = milliseconds( start );
+        std::cout << jobCount << " tiny jobs in " << elapsed << " ms, "
+            << jobCount / elapsed * 1000.0 / 1e6 << " M jobs/s" << std::endl;
+    }
+
+    {
+        constexpr uint32_t count = 1 << 22;
+        std::vector<float> values( count );
+        auto work = [ & ]( uint32_t begin, uint32_t end )
+            {
+                for ( uint32_t i = begin; i < end; i++ )
+                {
+                    const float x = static_cast< float >( i ) * 0.001f;
+                    values[ i ] = std::sqrt( x ) * std::sin( x ) + std::cos( x * 0.5f );
+                }
+            };
+
+        auto start = Clock::now();
+        work( 0, count );
+        const double serial = milliseconds( start );
+
+        start = Clock::now();
+        jobs.ParallelFor( count, 4096, work );
+        const double parallel = milliseconds( start );
+
+        std::cout << "ParallelFor over " << count << " elements: serial " << serial << " ms, parallel "
+            << parallel << " ms, " << serial / parallel << "x" << std::endl;
+    }
+    return 0;
+}
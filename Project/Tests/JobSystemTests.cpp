@@ -0,0 +1,192 @@
+#include "JobSystem.h"
+#include "Check.h"
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+
+//A fixed worker count, so the results don't depend on the machine running the tests
+static constexpr uint32_t WORKER_COUNT = 4;
+
+static void TestParallelForCoversEveryIndex()
+{
+    JobSystem jobs{ WORKER_COUNT };
+    constexpr uint32_t count = 1000003;
+    std::vector<uint32_t> visits( count, 0 );
+    jobs.ParallelFor( count, 1, [ & ]( uint32_t begin, uint32_t end )
+        {
+            for ( uint32_t i = begin; i < end; i++ ) visits[ i ]++;
+        } );
+    CHECK( std::all_of( visits.begin(), visits.end(), []( uint32_t v ) { return v == 1; } ) );
+
+    //Empty and single batch ranges
+    uint32_t calls = 0;
+    jobs.ParallelFor( 0, 16, [ & ]( uint32_t, uint32_t ) { calls++; } );
+    CHECK( calls == 0 );
+    jobs.ParallelFor( 10, 16, [ & ]( uint32_t begin, uint32_t end ) { calls++; CHECK( begin == 0 && end == 10 ); } );
+    CHECK( calls == 1 );
+}
+
+static void TestParentWaitsForChildren()
+{
+    JobSystem jobs{ WORKER_COUNT };
+    std::atomic<uint32_t> childRuns{ 0 };
+    std::atomic<bool> parentRan{ false };
+    JobSystem::JobHandle parent = jobs.CreateJob( [ & ]() { parentRan = true; } );
+    for ( uint32_t i = 0; i < 1000; i++ )
+    {
+        jobs.Run( jobs.CreateChildJob( parent, [ & ]() { childRuns++; } ) );
+    }
+    jobs.Run( parent );
+    jobs.Wait( parent );
+    CHECK( parentRan );
+    CHECK( childRuns == 1000 );
+    CHECK( jobs.IsFinished( parent ) );
+}
+
+static void TestNestedWaits()
+{
+    //Jobs that spawn and wait on jobs, only works if waiting threads keep executing
+    JobSystem jobs{ WORKER_COUNT };
+    std::function<uint64_t( uint32_t )> fibonacci = [ & ]( uint32_t n ) -> uint64_t
+        {
+            if ( n < 12 )
+            {
+                uint64_t a = 0, b = 1;
+                for ( uint32_t i = 0; i < n; i++ ) { uint64_t next = a + b; a = b; b = next; }
+                return a;
+            }
+            uint64_t left = 0;
+            JobSystem::JobHandle job = jobs.CreateJob( [ & ]() { left = fibonacci( n - 1 ); } );
+            jobs.Run( job );
+            const uint64_t right = fibonacci( n - 2 );
+            jobs.Wait( job );
+            return left + right;
+        };
+    CHECK( fibonacci( 27 ) == 196418 );
+}
+
+static void TestExceptionsReachTheWaitingThread()
+{
+    JobSystem jobs{ WORKER_COUNT };
+    bool rethrown = false;
+    try
+    {
+        jobs.ParallelFor( 1000, 10, []( uint32_t begin, uint32_t end )
+            {
+                if ( begin <= 500 && 500 < end ) throw std::runtime_error( "expected" );
+            } );
+    }
+    catch ( const std::runtime_error& )
+    {
+        rethrown = true;
+    }
+    CHECK( rethrown );
+
+    //A failed child fails its parent, but only once every sibling is done
+    std::atomic<uint32_t> siblingRuns{ 0 };
+    JobSystem::JobHandle parent = jobs.CreateJob( nullptr );
+    jobs.Run( jobs.CreateChildJob( parent, []() { throw std::runtime_error( "expected" ); } ) );
+    for ( uint32_t i = 0; i < 100; i++ )
+    {
+        jobs.Run( jobs.CreateChildJob( parent, [ & ]()
+            {
+                std::this_thread::yield();
+                siblingRuns++;
+            } ) );
+    }
+    jobs.Run( parent );
+    rethrown = false;
+    try
+    {
+        jobs.Wait( parent );
+    }
+    catch ( const std::runtime_error& )
+    {
+        rethrown = true;
+    }
+    CHECK( rethrown );
+    CHECK( siblingRuns == 100 );
+}
+
+static void TestSeveralSubmittingThreads()
+{
+    //Several non worker threads at once, like loaders next to the main thread
+    JobSystem jobs{ WORKER_COUNT };
+    std::atomic<uint64_t> total{ 0 };
+    std::vector<std::thread> threads;
+    for ( uint32_t t = 0; t < 4; t++ )
+    {
+        threads.emplace_back( [ & ]()
+            {
+                jobs.ParallelFor( 100000, 64, [ & ]( uint32_t begin, uint32_t end ) { total += end - begin; } );
+            } );
+    }
+    for ( auto& thread : threads ) thread.join();
+    CHECK( total == 400000 );
+}
+
+static void TestDequeOverflow()
+{
+    //More jobs from one worker than its deque holds, the rest runs inline
+    JobSystem jobs{ WORKER_COUNT };
+    constexpr uint32_t jobCount = JobSystem::DEQUE_CAPACITY * 3;
+    std::atomic<uint32_t> counter{ 0 };
+    std::atomic<bool> spawnedFromWorker{ false };
+    //Run from the main thread but not helped by it, so a worker picks the spawning job
+    JobSystem::JobHandle parent = jobs.CreateJob( nullptr );
+    jobs.Run( jobs.CreateChildJob( parent, [ & ]()
+        {
+            spawnedFromWorker = jobs.GetCurrentWorkerIndex() != JobSystem::INVALID_WORKER;
+            for ( uint32_t i = 0; i < jobCount; i++ )
+            {
+                jobs.Run( jobs.CreateChildJob( parent, [ & ]() { counter.fetch_add( 1, std::memory_order_relaxed ); } ) );
+            }
+        } ) );
+    jobs.Run( parent );
+    while ( !jobs.IsFinished( parent ) )
+    {
+        std::this_thread::yield();
+    }
+    jobs.Wait( parent );
+    CHECK( spawnedFromWorker );
+    CHECK( counter == jobCount );
+}
+
+static void TestWorkerIndices()
+{
+    JobSystem jobs{ WORKER_COUNT };
+    CHECK( jobs.GetWorkerCount() == WORKER_COUNT );
+    CHECK( jobs.GetCurrentWorkerIndex() == JobSystem::INVALID_WORKER );
+
+    //The waiting main thread helps and reports INVALID_WORKER, every other range runs on a worker
+    std::atomic<bool> validIndices{ true };
+    jobs.ParallelFor( 100000, 1, [ & ]( uint32_t, uint32_t )
+        {
+            const uint32_t index = jobs.GetCurrentWorkerIndex();
+            if ( index != JobSystem::INVALID_WORKER && index >= WORKER_COUNT ) validIndices = false;
+        } );
+    CHECK( validIndices );
+
+    //A worker of one system is a plain thread to another
+    JobSystem other{ 1 };
+    std::atomic<uint32_t> indexInOther{ 0 };
+    JobSystem::JobHandle job = jobs.CreateJob( [ & ]() { indexInOther = other.GetCurrentWorkerIndex(); } );
+    jobs.Run( job );
+    jobs.Wait( job );
+    CHECK( indexInOther == JobSystem::INVALID_WORKER );
+}
+
+int main()
+{
+    return RunTests( {
+        { "ParallelForCoversEveryIndex", TestParallelForCoversEveryIndex },
+        { "ParentWaitsForChildren", TestParentWaitsForChildren },
+        { "NestedWaits", TestNestedWaits },
+        { "ExceptionsReachTheWaitingThread", TestExceptionsReachTheWaitingThread },
+        { "SeveralSubmittingThreads", TestSeveralSubmittingThreads },
+        { "DequeOverflow", TestDequeOverflow },
+        { "WorkerIndices", TestWorkerIndices },
+    } );
+}
@@ -0,0 +1,325 @@
+#include "MemoryAllocator.h"
+#include "Check.h"
+
+#include <map>
+#include <stdexcept>
+
+//Hands out host memory behind fake handles and counts every call, no device needed
+class FakeMemoryBackend final : public MemoryBackend
+{
+public:
+    VkDeviceMemory AllocateMemory( uint32_t memoryTypeIndex, VkDeviceSize size ) override
+    {
+        allocateCalls++;
+        if ( failAllocations )
+        {
+            return VK_NULL_HANDLE;
+        }
+
+        const VkDeviceMemory memory = ( VkDeviceMemory )( m_NextHandle++ );
+        m_Allocations[ memory ] = { memoryTypeIndex, std::vector<uint8_t>( static_cast< size_t >( size ) ) };
+        return memory;
+    }
+
+    void FreeMemory( VkDeviceMemory memory ) override
+    {
+        freeCalls++;
+        CHECK( m_Allocations.erase( memory ) == 1 );
+    }
+
+    void* MapMemory( VkDeviceMemory memory ) override
+    {
+        mapCalls++;
+        return m_Allocations.at( memory ).data.data();
+    }
+
+    void UnmapMemory( VkDeviceMemory memory ) override
+    {
+        unmapCalls++;
+        CHECK( m_Allocations.count( memory ) == 1 );
+    }
+
+    size_t GetLiveCount() const { return m_Allocations.size(); }
+    uint32_t GetMemoryType( VkDeviceMemory memory ) const { return m_Allocations.at( memory ).memoryTypeIndex; }
+    uint8_t* GetData( VkDeviceMemory memory ) { return m_Allocations.at( memory ).data.data(); }
+
+    int allocateCalls = 0;
+    int freeCalls = 0;
+    int mapCalls = 0;
+    int unmapCalls = 0;
+    bool failAllocations = false;
+
+private:
+    struct Allocation
+    {
+        uint32_t memoryTypeIndex = 0;
+        std::vector<uint8_t> data;
+    };
+
+    uint64_t m_NextHandle = 1;
+    std::map<VkDeviceMemory, Allocation> m_Allocations;
+};
+
+static constexpr VkDeviceSize BLOCK_SIZE = 64 * 1024;
+
+static VkMemoryRequirements Requirements( VkDeviceSize size, VkDeviceSize alignment )
+{
+    VkMemoryRequirements requirements{};
+    requirements.size = size;
+    requirements.alignment = alignment;
+    requirements.memoryTypeBits = ~0u;
+    return requirements;
+}
+
+static void TestAlignment()
+{
+    FakeMemoryBackend backend;
+    MemoryAllocator allocator{ backend, BLOCK_SIZE };
+
+    MemoryAllocation first = allocator.Allocate( Requirements( 100, 16 ), 0, false, MemoryAllocator::ResourceType::Buffer );
+    MemoryAllocation second = allocator.Allocate( Requirements( 100, 256 ), 0, false, MemoryAllocator::ResourceType::Buffer );
+
+    CHECK( backend.allocateCalls == 1 );
+    CHECK( first.memory == second.memory );
+    CHECK( first.offset % 16 == 0 );
+    CHECK( second.offset % 256 == 0 );
+    CHECK( second.offset >= first.offset + first.size );
+    CHECK( first.mapped == nullptr );
+
+    //The padding in front of the aligned offset stays usable
+    MemoryAllocation padding = allocator.Allocate( Requirements( 16, 16 ), 0, false, MemoryAllocator::ResourceType::Buffer );
+    CHECK( padding.offset >= first.offset + first.size );
+    CHECK( padding.offset + padding.size <= second.offset );
+
+    allocator.Free( first );
+    allocator.Free( second );
+    allocator.Free( padding );
+    CHECK( !first.IsValid() );
+}
+
+static void TestHostVisibleAtoms()
+{
+    FakeMemoryBackend backend;
+    MemoryAllocator allocator{ backend, BLOCK_SIZE, 64 };
+
+    MemoryAllocation first = allocator.Allocate( Requirements( 10, 4 ), 1, true, MemoryAllocator::ResourceType::Buffer );
+    MemoryAllocation second = allocator.Allocate( Requirements( 10, 4 ), 1, true, MemoryAllocator::ResourceType::Buffer );
+
+    //Non coherent ranges are padded to whole atoms, so flushing one never touches the other
+    CHECK( first.size == 64 );
+    CHECK( first.offset % 64 == 0 );
+    CHECK( second.offset % 64 == 0 );
+    CHECK( backend.mapCalls == 1 );
+    CHECK( first.mapped == backend.GetData( first.memory ) + first.offset );
+    CHECK( second.mapped == backend.GetData( second.memory ) + second.offset );
+    CHECK( backend.GetMemoryType( first.memory ) == 1 );
+
+    allocator.Free( first );
+    allocator.Free( second );
+}
+
+static void TestPoolsAreSeparate()
+{
+    FakeMemoryBackend backend;
+    MemoryAllocator allocator{ backend, BLOCK_SIZE };
+
+    MemoryAllocation buffer = allocator.Allocate( Requirements( 256, 256 ), 0, false, MemoryAllocator::ResourceType::Buffer );
+    MemoryAllocation image = allocator.Allocate( Requirements( 256, 256 ), 0, false, MemoryAllocator::ResourceType::Image );
+    MemoryAllocation otherType = allocator.Allocate( Requirements( 256, 256 ), 2, false, MemoryAllocator::ResourceType::Buffer );
+
+    CHECK( backend.allocateCalls == 3 );
+    CHECK( buffer.memory != image.memory );
+    CHECK( buffer.memory != otherType.memory );
+    CHECK( buffer.poolIndex != image.poolIndex );
+
+    allocator.Free( buffer );
+    allocator.Free( image );
+    allocator.Free( otherType );
+}
+
+static void TestBlockReuse()
+{
+    FakeMemoryBackend backend;
+    MemoryAllocator allocator{ backend, BLOCK_SIZE };
+
+    MemoryAllocation first = allocator.Allocate( Requirements( 1024, 256 ), 0, false, MemoryAllocator::ResourceType::Buffer );
+    const VkDeviceMemory memory = first.memory;
+    const VkDeviceSize offset = first.offset;
+    allocator.Free( first );
+
+    //The last block of a pool survives being emptied
+    CHECK( backend.freeCalls == 0 );
+    CHECK( allocator.GetStats().blockCount == 1 );
+
+    MemoryAllocation second = allocator.Allocate( Requirements( 1024, 256 ), 0, false, MemoryAllocator::ResourceType::Buffer );
+    CHECK( backend.allocateCalls == 1 );
+    CHECK( second.memory == memory );
+    CHECK( second.offset == offset );
+
+    //A full block gets a second one, which is released again once it is empty
+    MemoryAllocation fill = allocator.Allocate( Requirements( BLOCK_SIZE / 2, 256 ), 0, false, MemoryAllocator::ResourceType::Buffer );
+    MemoryAllocation overflow = allocator.Allocate( Requirements( BLOCK_SIZE / 2, 256 ), 0, false, MemoryAllocator::ResourceType::Buffer );
+    CHECK( !fill.dedicated );
+    CHECK( backend.allocateCalls == 2 );
+    CHECK( overflow.memory != memory );
+    CHECK( overflow.blockIndex == 1 );
+    CHECK( allocator.GetStats().blockCount == 2 );
+
+    allocator.Free( overflow );
+    CHECK( backend.freeCalls == 1 );
+    CHECK( allocator.GetStats().blockCount == 1 );
+
+    //The released slot is filled again before the block list grows
+    MemoryAllocation refill = allocator.Allocate( Requirements( BLOCK_SIZE / 2, 256 ), 0, false, MemoryAllocator::ResourceType::Buffer );
+    CHECK( backend.allocateCalls == 3 );
+    CHECK( refill.blockIndex == 1 );
+
+    allocator.Free( second );
+    allocator.Free( fill );
+    allocator.Free( refill );
+}
+
+static void TestCoalescing()
+{
+    FakeMemoryBackend backend;
+    MemoryAllocator allocator{ backend, BLOCK_SIZE };
+
+    MemoryAllocation a = allocator.Allocate( Requirements( 1024, 1024 ), 0, false, MemoryAllocator::ResourceType::Buffer );
+    MemoryAllocation b = allocator.Allocate( Requirements( 1024, 1024 ), 0, false, MemoryAllocator::ResourceType::Buffer );
+    MemoryAllocation c = allocator.Allocate( Requirements( 1024, 1024 ), 0, false, MemoryAllocator::ResourceType::Buffer );
+    MemoryAllocation tail = allocator.Allocate( Requirements( 1024, 1024 ), 0, false, MemoryAllocator::ResourceType::Buffer );
+    CHECK( a.offset == 0 );
+    CHECK( b.offset == 1024 );
+    CHECK( c.offset == 2048 );
+
+    //Freed out of order: c merges with nothing, b merges with both neighbours
+    allocator.Free( a );
+    allocator.Free( c );
+    allocator.Free( b );
+
+    //Only fits at offset 0 if the three ranges became one
+    MemoryAllocation merged = allocator.Allocate( Requirements( 3072, 1024 ), 0, false, MemoryAllocator::ResourceType::Buffer );
+    CHECK( merged.offset == 0 );
+    CHECK( backend.allocateCalls == 1 );
+
+    //Freeing everything leaves one range covering the whole block
+    allocator.Free( merged );
+    allocator.Free( tail );
+    MemoryAllocation whole = allocator.Allocate( Requirements( BLOCK_SIZE / 2, 1024 ), 0, false, MemoryAllocator::ResourceType::Buffer );
+    MemoryAllocation rest = allocator.Allocate( Requirements( BLOCK_SIZE / 2, 1024 ), 0, false, MemoryAllocator::ResourceType::Buffer );
+    CHECK( whole.offset == 0 );
+    CHECK( rest.offset == BLOCK_SIZE / 2 );
+    CHECK( backend.allocateCalls == 1 );
+
+    allocator.Free( whole );
+    allocator.Free( rest );
+}
+
+static void TestDedicated()
+{
+    FakeMemoryBackend backend;
+    MemoryAllocator allocator{ backend, BLOCK_SIZE };
+
+    MemoryAllocation large = allocator.Allocate( Requirements( BLOCK_SIZE, 256 ), 0, true, MemoryAllocator::ResourceType::Image );
+    CHECK( large.dedicated );
+    CHECK( large.offset == 0 );
+    CHECK( large.mapped == backend.GetData( large.memory ) );
+    CHECK( backend.allocateCalls == 1 );
+    CHECK( allocator.GetStats().blockCount == 0 );
+    CHECK( allocator.GetStats().dedicatedAllocationCount == 1 );
+
+    allocator.Free( large );
+    CHECK( backend.unmapCalls == 1 );
+    CHECK( backend.freeCalls == 1 );
+    CHECK( backend.GetLiveCount() == 0 );
+    CHECK( allocator.GetStats().dedicatedAllocationCount == 0 );
+}
+
+static void TestStats()
+{
+    FakeMemoryBackend backend;
+    MemoryAllocator allocator{ backend, BLOCK_SIZE };
+
+    MemoryAllocation small = allocator.Allocate( Requirements( 100, 256 ), 0, false, MemoryAllocator::ResourceType::Buffer );
+    MemoryAllocation other = allocator.Allocate( Requirements( 200, 256 ), 0, false, MemoryAllocator::ResourceType::Buffer );
+    MemoryAllocation large = allocator.Allocate( Requirements( BLOCK_SIZE, 256 ), 0, false, MemoryAllocator::ResourceType::Buffer );
+
+    MemoryStats stats = allocator.GetStats();
+    CHECK( stats.blockCount == 1 );
+    CHECK( stats.dedicatedAllocationCount == 1 );
+    CHECK( stats.allocationCount == 3 );
+    CHECK( stats.GetDeviceAllocationCount() == 2 );
+    CHECK( stats.reservedBytes == BLOCK_SIZE + BLOCK_SIZE );
+    //Alignment padding doesn't count as used
+    CHECK( stats.usedBytes == 100 + 200 + BLOCK_SIZE );
+
+    allocator.Free( small );
+    allocator.Free( large );
+    stats = allocator.GetStats();
+    CHECK( stats.allocationCount == 1 );
+    CHECK( stats.dedicatedAllocationCount == 0 );
+    CHECK( stats.reservedBytes == BLOCK_SIZE );
+    CHECK( stats.usedBytes == 200 );
+
+    allocator.Free( other );
+    CHECK( allocator.GetStats().usedBytes == 0 );
+}
+
+static void TestOutOfMemory()
+{
+    FakeMemoryBackend backend;
+    MemoryAllocator allocator{ backend, BLOCK_SIZE };
+    backend.failAllocations = true;
+
+    bool blockThrew = false;
+    try
+    {
+        allocator.Allocate( Requirements( 100, 16 ), 0, false, MemoryAllocator::ResourceType::Buffer );
+    }
+    catch ( const std::runtime_error& )
+    {
+        blockThrew = true;
+    }
+
+    bool dedicatedThrew = false;
+    try
+    {
+        allocator.Allocate( Requirements( BLOCK_SIZE, 16 ), 0, false, MemoryAllocator::ResourceType::Buffer );
+    }
+    catch ( const std::runtime_error& )
+    {
+        dedicatedThrew = true;
+    }
+
+    CHECK( blockThrew );
+    CHECK( dedicatedThrew );
+    CHECK( allocator.GetStats().allocationCount == 0 );
+    CHECK( allocator.GetStats().reservedBytes == 0 );
+}
+
+static void TestDestructorReleasesBlocks()
+{
+    FakeMemoryBackend backend;
+    {
+        MemoryAllocator allocator{ backend, BLOCK_SIZE };
+        allocator.Allocate( Requirements( 100, 16 ), 0, true, MemoryAllocator::ResourceType::Buffer );
+        allocator.Allocate( Requirements( 100, 16 ), 3, false, MemoryAllocator::ResourceType::Image );
+    }
+    CHECK( backend.GetLiveCount() == 0 );
+    CHECK( backend.unmapCalls == backend.mapCalls );
+}
+
+int main()
+{
+    return RunTests( {
+        { "Alignment", TestAlignment },
+        { "HostVisibleAtoms", TestHostVisibleAtoms },
+        { "PoolsAreSeparate", TestPoolsAreSeparate },
+        { "BlockReuse", TestBlockReuse },
+        { "Coalescing", TestCoalescing },
+        { "Dedicated", TestDedicated },
+        { "Stats", TestStats },
+        { "OutOfMemory", TestOutOfMemory },
+        { "DestructorReleasesBlocks", TestDestructorReleasesBlocks },
+    } );
+}
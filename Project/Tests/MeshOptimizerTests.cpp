@@ -0,0 +1,70 @@
+#include "MeshOptimizer.h"
+#include "TestMeshes.h"
+#include "Check.h"
+
+#include <cmath>
+#include <utility>
+
+static void TestOverdrawPutsOutermostFacesFirst()
+{
+    //Every face is its own cluster, the two far out along x are seen first from most directions
+    TestMesh box = MakeCube( glm::vec3{ 3.f, 1.f, 1.f } );
+    MeshOptimizer::OptimizeOverdraw( box.indices, box.vertices );
+    CHECK( box.indices.size() == 36 );
+    //Two faces, twelve indices. The corners of the other faces reach x = +-3 too, the normals tell them apart
+    for ( size_t i = 0; i < box.indices.size(); i++ )
+    {
+        CHECK( ( i < 12 ) == ( std::abs( box.vertices[ box.indices[ i ] ].normal.x ) == 1.f ) );
+    }
+}
+
+static void TestOverdrawPutsInwardFacesLast()
+{
+    //A room inside a box: the room's faces point at the center, the box's away from it
+    TestMesh box = MakeCube( glm::vec3{ 2.f } );
+    TestMesh room = MakeCube( glm::vec3{ 1.f } );
+    for ( size_t i = 0; i < room.indices.size(); i += 3 )
+    {
+        std::swap( room.indices[ i + 1 ], room.indices[ i + 2 ] );
+    }
+
+    //Room first, so the sort has to move it behind the box
+    const uint32_t roomVertices = static_cast< uint32_t >( box.vertices.size() );
+    box.vertices.insert( box.vertices.end(), room.vertices.begin(), room.vertices.end() );
+    std::vector<uint32_t> indices;
+    for ( uint32_t index : room.indices )
+    {
+        indices.push_back( index + roomVertices );
+    }
+    indices.insert( indices.end(), box.indices.begin(), box.indices.end() );
+
+    MeshOptimizer::OptimizeOverdraw( indices, box.vertices );
+    for ( size_t i = 0; i < indices.size(); i++ )
+    {
+        CHECK( ( i < box.indices.size() ) == ( indices[ i ] < roomVertices ) );
+    }
+}
+
+static void TestOptimizeReportsCacheStats()
+{
+    //Row by row the sphere misses more than the optimized order does
+    TestMesh sphere = MakeSphere( 64, 32 );
+    const MeshOptimizer::OptimizeStats stats = MeshOptimizer::Optimize( sphere.vertices, sphere.indices );
+    const MeshOptimizer::VertexCacheStats after = MeshOptimizer::AnalyzeVertexCache( sphere.indices, sphere.vertices.size() );
+    CHECK( stats.after.acmr == after.acmr && stats.after.atvr == after.atvr );
+    CHECK( stats.after.acmr < stats.before.acmr );
+    CHECK( stats.after.atvr >= 1.f && stats.after.atvr < stats.before.atvr );
+
+    std::vector<Model::Vertex> noVertices;
+    std::vector<uint32_t> noIndices;
+    CHECK( MeshOptimizer::Optimize( noVertices, noIndices ).after.acmr == 0.f );
+}
+
+int main()
+{
+    return RunTests( {
+        { "OverdrawPutsOutermostFacesFirst", TestOverdrawPutsOutermostFacesFirst },
+        { "OverdrawPutsInwardFacesLast", TestOverdrawPutsInwardFacesLast },
+        { "OptimizeReportsCacheStats", TestOptimizeReportsCacheStats },
+    } );
+}
@@ -0,0 +1,66 @@
+#include "MeshletBuilder.h"
+#include "TestMeshes.h"
+#include "Check.h"
+
+static void TestImportedMeshesWindInward()
+{
+    //The reason the import passes flip their normals, if this changes they have to follow
+    CHECK( SignedVolume( MakeSphere( 32, 16 ) ) < 0.f );
+    CHECK( SignedVolume( MakeCube() ) < 0.f );
+}
+
+static void TestConesPointOutward()
+{
+    TestMesh sphere = MakeSphere( 64, 32 );
+    const std::vector<Model::Meshlet> meshlets = MeshletBuilder::Build( sphere.vertices, sphere.indices );
+    CHECK( meshlets.size() > 8 );
+    for ( const Model::Meshlet& meshlet : meshlets )
+    {
+        //Every meshlet of a sphere faces away from its center
+        CHECK( glm::dot( meshlet.coneAxis, meshlet.center ) > 0.f );
+    }
+}
+
+static void TestClustersFacingTheCameraAreKept()
+{
+    TestMesh sphere = MakeSphere( 64, 32 );
+    const std::vector<Model::Meshlet> meshlets = MeshletBuilder::Build( sphere.vertices, sphere.indices );
+
+    for ( const glm::vec3& cameraPosition : { glm::vec3{ 0.f, 0.f, 10.f }, glm::vec3{ 6.f, -8.f, 0.f }, glm::vec3{ 0.f, 3.f, 0.f } } )
+    {
+        const glm::vec3 towardsCamera = glm::normalize( cameraPosition );
+        uint32_t culled = 0;
+        for ( const Model::Meshlet& meshlet : meshlets )
+        {
+            const bool backFacing = MeshletBuilder::IsBackFacing( meshlet, cameraPosition );
+            //A meshlet on the camera's side of the sphere has triangles the camera sees from the front
+            if ( glm::dot( glm::normalize( meshlet.center ), towardsCamera ) > 0.5f )
+            {
+                CHECK( !backFacing );
+            }
+            culled += backFacing ? 1 : 0;
+        }
+        //The far side still gets culled
+        CHECK( culled > 0 );
+    }
+}
+
+static void TestWideClustersAreNeverCulled()
+{
+    //A whole cube in one meshlet faces every way
+    TestMesh cube = MakeCube();
+    const std::vector<Model::Meshlet> meshlets = MeshletBuilder::Build( cube.vertices, cube.indices );
+    CHECK( meshlets.size() == 1 );
+    CHECK( meshlets[ 0 ].coneCutoff == 1.f );
+    CHECK( !MeshletBuilder::IsBackFacing( meshlets[ 0 ], glm::vec3{ 0.f, 0.f, 10.f } ) );
+}
+
+int main()
+{
+    return RunTests( {
+        { "ImportedMeshesWindInward", TestImportedMeshesWindInward },
+        { "ConesPointOutward", TestConesPointOutward },
+        { "ClustersFacingTheCameraAreKept", TestClustersFacingTheCameraAreKept },
+        { "WideClustersAreNeverCulled", TestWideClustersAreNeverCulled },
+    } );
+}
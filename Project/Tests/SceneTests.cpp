@@ -0,0 +1,151 @@
+#include "Scene.h"
+#include "Check.h"
+
+#include <cmath>
+#include <stdexcept>
+
+static bool NearlyEqual( const glm::mat4& a, const glm::mat4& b )
+{
+    for ( int column = 0; column < 4; column++ )
+    {
+        for ( int row = 0; row < 4; row++ )
+        {
+            if ( std::abs( a[ column ][ row ] - b[ column ][ row ] ) > 1e-4f ) return false;
+        }
+    }
+    return true;
+}
+
+static TransformComponent MakeTransform( glm::vec3 translation, glm::vec3 rotation = glm::vec3{ 0.f }, float scale = 1.f )
+{
+    TransformComponent transform{};
+    transform.translation = translation;
+    transform.rotation = rotation;
+    transform.scale = glm::vec3{ scale };
+    return transform;
+}
+
+static glm::mat4 WorldOf( const Scene& scene, Entity entity )
+{
+    return scene.GetWorldMatrices()[ scene.GetDenseIndex( entity ) ];
+}
+
+static void TestParentMovesChildren()
+{
+    Scene scene;
+    TransformComponent parentTransform = MakeTransform( { 1.f, 2.f, 3.f }, { 0.f, 0.5f, 0.f }, 2.f );
+    TransformComponent childTransform = MakeTransform( { 0.f, 1.f, 0.f }, { 0.3f, 0.f, 0.f } );
+    TransformComponent grandchildTransform = MakeTransform( { 0.f, 0.f, 4.f } );
+    const Entity parent = scene.CreateEntity( INVALID_MODEL, parentTransform );
+    const Entity child = scene.CreateEntity( INVALID_MODEL, childTransform );
+    const Entity grandchild = scene.CreateEntity( INVALID_MODEL, grandchildTransform );
+    scene.CreateEntity( INVALID_MODEL, MakeTransform( { 5.f, 0.f, 0.f } ) );
+
+    scene.SetParent( child, parent );
+    scene.SetParent( grandchild, child );
+    CHECK( scene.GetParent( child ) == parent );
+    CHECK( scene.GetParent( grandchild ) == child );
+    scene.UpdateTransforms();
+
+    CHECK( NearlyEqual( WorldOf( scene, child ), parentTransform.mat4() * childTransform.mat4() ) );
+    CHECK( NearlyEqual( WorldOf( scene, grandchild ),
+        parentTransform.mat4() * childTransform.mat4() * grandchildTransform.mat4() ) );
+
+    //Only the moved parent is edited, its whole subtree follows and the unrelated entity is skipped
+    scene.EditTransform( parent ).translation = glm::vec3{ -4.f, 0.f, 1.f };
+    parentTransform.translation = glm::vec3{ -4.f, 0.f, 1.f };
+    scene.UpdateTransforms();
+    CHECK( scene.GetLastUpdateCount() == 3 );
+    CHECK( NearlyEqual( WorldOf( scene, child ), parentTransform.mat4() * childTransform.mat4() ) );
+    CHECK( NearlyEqual( WorldOf( scene, grandchild ),
+        parentTransform.mat4() * childTransform.mat4() * grandchildTransform.mat4() ) );
+
+    //Moving a leaf leaves its parents alone
+    scene.EditTransform( grandchild ).translation = glm::vec3{ 1.f, 1.f, 1.f };
+    grandchildTransform.translation = glm::vec3{ 1.f, 1.f, 1.f };
+    scene.UpdateTransforms();
+    CHECK( scene.GetLastUpdateCount() == 1 );
+    CHECK( NearlyEqual( WorldOf( scene, grandchild ),
+        parentTransform.mat4() * childTransform.mat4() * grandchildTransform.mat4() ) );
+}
+
+static void TestChildCreatedBeforeParent()
+{
+    //Dense order doesn't follow the hierarchy, the update order has to
+    Scene scene;
+    TransformComponent childTransform = MakeTransform( { 0.f, 0.f, 2.f } );
+    TransformComponent parentTransform = MakeTransform( { 3.f, 0.f, 0.f }, { 0.f, 1.f, 0.f } );
+    const Entity child = scene.CreateEntity( INVALID_MODEL, childTransform );
+    const Entity parent = scene.CreateEntity( INVALID_MODEL, parentTransform );
+    scene.SetParent( child, parent );
+    scene.UpdateTransforms();
+    CHECK( NearlyEqual( WorldOf( scene, child ), parentTransform.mat4() * childTransform.mat4() ) );
+}
+
+static void TestDetach()
+{
+    Scene scene;
+    TransformComponent childTransform = MakeTransform( { 0.f, 1.f, 0.f } );
+    const Entity parent = scene.CreateEntity( INVALID_MODEL, MakeTransform( { 10.f, 0.f, 0.f } ) );
+    const Entity child = scene.CreateEntity( INVALID_MODEL, childTransform );
+    const Entity other = scene.CreateEntity( INVALID_MODEL, MakeTransform( { 0.f, 0.f, 7.f } ) );
+    scene.SetParent( child, parent );
+    scene.UpdateTransforms();
+
+    //An invalid parent detaches, the local transform is the world transform again
+    scene.SetParent( child, Entity{} );
+    scene.UpdateTransforms();
+    CHECK( !scene.GetParent( child ).IsValid() );
+    CHECK( NearlyEqual( WorldOf( scene, child ), childTransform.mat4() ) );
+
+    //Destroying the parent does the same to its children
+    scene.SetParent( child, other );
+    scene.DestroyEntity( other );
+    scene.UpdateTransforms();
+    CHECK( scene.IsAlive( child ) && !scene.IsAlive( other ) );
+    CHECK( !scene.GetParent( child ).IsValid() );
+    CHECK( NearlyEqual( WorldOf( scene, child ), childTransform.mat4() ) );
+}
+
+static void TestCyclesAreRejected()
+{
+    Scene scene;
+    const Entity a = scene.CreateEntity();
+    const Entity b = scene.CreateEntity();
+    const Entity c = scene.CreateEntity();
+    scene.SetParent( b, a );
+    scene.SetParent( c, b );
+
+    bool threw = false;
+    try
+    {
+        scene.SetParent( a, c );
+    }
+    catch ( const std::runtime_error& )
+    {
+        threw = true;
+    }
+    CHECK( threw );
+    CHECK( !scene.GetParent( a ).IsValid() );
+
+    threw = false;
+    try
+    {
+        scene.SetParent( a, a );
+    }
+    catch ( const std::runtime_error& )
+    {
+        threw = true;
+    }
+    CHECK( threw );
+}
+
+int main()
+{
+    return RunTests( {
+        { "ParentMovesChildren", TestParentMovesChildren },
+        { "ChildCreatedBeforeParent", TestChildCreatedBeforeParent },
+        { "Detach", TestDetach },
+        { "CyclesAreRejected", TestCyclesAreRejected },
+    } );
+}
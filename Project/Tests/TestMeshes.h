@@ -0,0 +1,105 @@
+#pragma once
+#include "Model.h"
+
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+//Meshes as LoadModel hands them to the import passes: counter clockwise seen from outside like an obj,
+//then y mirrored without touching the winding
+struct TestMesh
+{
+    std::vector<Model::Vertex> vertices;
+    std::vector<uint32_t> indices;
+};
+
+inline void MirrorLikeLoadModel( TestMesh& mesh )
+{
+    for ( Model::Vertex& vertex : mesh.vertices )
+    {
+        vertex.position.y *= -1.0f;
+    }
+}
+
+//Unit sphere around the origin, the poles are shared vertices
+inline TestMesh MakeSphere( uint32_t slices, uint32_t stacks )
+{
+    TestMesh mesh;
+    for ( uint32_t stack = 0; stack <= stacks; stack++ )
+    {
+        for ( uint32_t slice = 0; slice < slices; slice++ )
+        {
+            const float theta = 3.14159265f * stack / stacks;
+            const float phi = 6.28318531f * slice / slices;
+            Model::Vertex vertex{};
+            vertex.position = { std::sin( theta ) * std::cos( phi ), std::cos( theta ), std::sin( theta ) * std::sin( phi ) };
+            vertex.normal = vertex.position;
+            mesh.vertices.push_back( vertex );
+        }
+    }
+
+    auto index = [ & ]( uint32_t slice, uint32_t stack ) { return stack * slices + slice % slices; };
+    for ( uint32_t stack = 0; stack < stacks; stack++ )
+    {
+        for ( uint32_t slice = 0; slice < slices; slice++ )
+        {
+            const uint32_t a = index( slice, stack ), b = index( slice + 1, stack );
+            const uint32_t c = index( slice + 1, stack + 1 ), d = index( slice, stack + 1 );
+            if ( stack != 0 ) mesh.indices.insert( mesh.indices.end(), { a, b, d } );
+            if ( stack != stacks - 1 ) mesh.indices.insert( mesh.indices.end(), { b, c, d } );
+        }
+    }
+
+    //Counter clockwise seen from outside
+    for ( size_t i = 0; i < mesh.indices.size(); i += 3 )
+    {
+        const glm::vec3& a = mesh.vertices[ mesh.indices[ i ] ].position;
+        const glm::vec3& b = mesh.vertices[ mesh.indices[ i + 1 ] ].position;
+        const glm::vec3& c = mesh.vertices[ mesh.indices[ i + 2 ] ].position;
+        if ( glm::dot( glm::cross( b - a, c - a ), a + b + c ) < 0.f )
+        {
+            std::swap( mesh.indices[ i + 1 ], mesh.indices[ i + 2 ] );
+        }
+    }
+
+    MirrorLikeLoadModel( mesh );
+    return mesh;
+}
+
+//Axis aligned box from -halfExtent to halfExtent, four vertices and two triangles per face so no face shares a vertex
+inline TestMesh MakeCube( const glm::vec3& halfExtent = glm::vec3{ 1.f } )
+{
+    TestMesh mesh;
+    const glm::vec3 normals[ 6 ] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+    for ( const glm::vec3& normal : normals )
+    {
+        //Two axes of the face with u x v = normal, so u, v order is counter clockwise seen from outside
+        const glm::vec3 u = std::abs( normal.x ) > 0.f ? glm::vec3{ 0, 1, 0 } : glm::vec3{ 1, 0, 0 };
+        const glm::vec3 v = glm::cross( normal, u );
+        const uint32_t first = static_cast< uint32_t >( mesh.vertices.size() );
+        for ( const glm::vec2 corner : { glm::vec2{ -1, -1 }, glm::vec2{ 1, -1 }, glm::vec2{ 1, 1 }, glm::vec2{ -1, 1 } } )
+        {
+            Model::Vertex vertex{};
+            vertex.position = ( normal + u * corner.x + v * corner.y ) * halfExtent;
+            vertex.normal = normal;
+            mesh.vertices.push_back( vertex );
+        }
+        mesh.indices.insert( mesh.indices.end(), { first, first + 1, first + 2, first, first + 2, first + 3 } );
+    }
+
+    MirrorLikeLoadModel( mesh );
+    return mesh;
+}
+
+//Six times the enclosed volume, negative when the winding faces inward
+inline float SignedVolume( const TestMesh& mesh )
+{
+    float volume = 0.f;
+    for ( size_t i = 0; i + 2 < mesh.indices.size(); i += 3 )
+    {
+        volume += glm::dot( mesh.vertices[ mesh.indices[ i ] ].position,
+            glm::cross( mesh.vertices[ mesh.indices[ i + 1 ] ].position, mesh.vertices[ mesh.indices[ i + 2 ] ].position ) );
+    }
+    return volume;
+}
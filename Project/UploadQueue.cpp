@@ -0,0 +1,276 @@
+#include "UploadQueue.h"
+#include "EngineDevice.h"
+#include "Buffer.h"
+#include <stdexcept>
+#include <cstring>
+
+//vkCmdCopyBuffer has no alignment rules, this just keeps every upload on its own cache lines
+static constexpr VkDeviceSize STAGING_ALIGNMENT = 16;
+
+UploadQueue::UploadQueue( EngineDevice& device, VkDeviceSize ringSize )
+    : m_Device{ device },
+    m_RingSize{ ringSize }
+{
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = m_Device.FindPhysicalQueueFamilies().graphicsFamily;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+    if ( vkCreateCommandPool( m_Device.Device(), &poolInfo, nullptr, &m_CommandPool ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create upload command pool!" );
+    }
+
+    m_RingBuffer = std::make_unique<Buffer>( m_Device, 1, static_cast< uint32_t >( m_RingSize ),
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT );
+    m_RingBuffer->map();
+}
+
+UploadQueue::~UploadQueue()
+{
+    WaitIdle();
+
+    auto destroyBatch = [ this ]( std::unique_ptr<Batch>& batch )
+        {
+            vkDestroyFence( m_Device.Device(), batch->fence, nullptr );
+            vkFreeCommandBuffers( m_Device.Device(), m_CommandPool, 1, &batch->commandBuffer );
+        };
+
+    for ( auto& batch : m_FreeBatches )
+    {
+        destroyBatch( batch );
+    }
+    m_FreeBatches.clear();
+    m_RingBuffer.reset();
+
+    vkDestroyCommandPool( m_Device.Device(), m_CommandPool, nullptr );
+}
+
+UploadTicket UploadQueue::Upload( VkBuffer dstBuffer, const void* data, VkDeviceSize size, VkDeviceSize dstOffset )
+{
+    std::lock_guard<std::mutex> lock{ m_Mutex };
+
+    VkBuffer srcBuffer;
+    VkDeviceSize srcOffset = 0;
+    if ( size > m_RingSize )
+    {
+        //Too big for the ring, give it a staging buffer that lives until the batch is done
+        auto overflow = std::make_unique<Buffer>( m_Device, 1, static_cast< uint32_t >( size ),
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT );
+        overflow->map();
+        overflow->writeToBuffer( const_cast< void* >( data ), size );
+        srcBuffer = overflow->getBuffer();
+
+        GetCurrentBatch().overflowBuffers.push_back( std::move( overflow ) );
+    }
+    else
+    {
+        srcOffset = AllocateStaging( size );
+        m_RingBuffer->writeToBuffer( const_cast< void* >( data ), size, srcOffset );
+        srcBuffer = m_RingBuffer->getBuffer();
+    }
+
+    Batch& batch = GetCurrentBatch();
+
+    VkBufferCopy copyRegion{};
+    copyRegion.srcOffset = srcOffset;
+    copyRegion.dstOffset = dstOffset;
+    copyRegion.size = size;
+    vkCmdCopyBuffer( batch.commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion );
+
+    return UploadTicket{ batch.id };
+}
+
+UploadTicket UploadQueue::Copy( VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size )
+{
+    std::lock_guard<std::mutex> lock{ m_Mutex };
+
+    Batch& batch = GetCurrentBatch();
+
+    VkBufferCopy copyRegion{};
+    copyRegion.size = size;
+    vkCmdCopyBuffer( batch.commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion );
+
+    return UploadTicket{ batch.id };
+}
+
+UploadTicket UploadQueue::Submit()
+{
+    std::lock_guard<std::mutex> lock{ m_Mutex };
+    return SubmitLocked();
+}
+
+bool UploadQueue::IsComplete( UploadTicket ticket )
+{
+    std::lock_guard<std::mutex> lock{ m_Mutex };
+    RetireCompletedBatches( false );
+    return ticket.batchId <= m_CompletedBatchId;
+}
+
+void UploadQueue::Wait( UploadTicket ticket )
+{
+    std::lock_guard<std::mutex> lock{ m_Mutex };
+    WaitForBatch( ticket.batchId );
+}
+
+void UploadQueue::WaitIdle()
+{
+    std::lock_guard<std::mutex> lock{ m_Mutex };
+    WaitForBatch( m_NextBatchId - 1 );
+}
+
+UploadQueue::Batch& UploadQueue::GetCurrentBatch()
+{
+    if ( m_CurrentBatch )
+    {
+        return *m_CurrentBatch;
+    }
+
+    RetireCompletedBatches( false );
+
+    if ( !m_FreeBatches.empty() )
+    {
+        m_CurrentBatch = std::move( m_FreeBatches.back() );
+        m_FreeBatches.pop_back();
+        vkResetCommandBuffer( m_CurrentBatch->commandBuffer, 0 );
+    }
+    else
+    {
+        m_CurrentBatch = std::make_unique<Batch>();
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = m_CommandPool;
+        allocInfo.commandBufferCount = 1;
+        if ( vkAllocateCommandBuffers( m_Device.Device(), &allocInfo, &m_CurrentBatch->commandBuffer ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to allocate upload command buffer!" );
+        }
+
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        if ( vkCreateFence( m_Device.Device(), &fenceInfo, nullptr, &m_CurrentBatch->fence ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to create upload fence!" );
+        }
+    }
+
+    m_CurrentBatch->id = m_NextBatchId++;
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer( m_CurrentBatch->commandBuffer, &beginInfo );
+
+    return *m_CurrentBatch;
+}
+
+UploadTicket UploadQueue::SubmitLocked()
+{
+    if ( !m_CurrentBatch )
+    {
+        return UploadTicket{ m_NextBatchId - 1 };
+    }
+
+    Batch& batch = *m_CurrentBatch;
+
+    //Make the copies visible to everything that reads vertex, index or uniform data in later submissions
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+        VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier( batch.commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+        0, 1, &barrier, 0, nullptr, 0, nullptr );
+
+    vkEndCommandBuffer( batch.commandBuffer );
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &batch.commandBuffer;
+
+    vkResetFences( m_Device.Device(), 1, &batch.fence );
+    if ( vkQueueSubmit( m_Device.GraphicsQueue(), 1, &submitInfo, batch.fence ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to submit uploads!" );
+    }
+
+    batch.ringEnd = m_RingWrite;
+    UploadTicket ticket{ batch.id };
+    m_InFlightBatches.push_back( std::move( m_CurrentBatch ) );
+    return ticket;
+}
+
+void UploadQueue::RetireCompletedBatches( bool waitForOldest )
+{
+    //Batches go to one queue, so they finish in submission order
+    while ( !m_InFlightBatches.empty() )
+    {
+        Batch& batch = *m_InFlightBatches.front();
+        if ( waitForOldest )
+        {
+            vkWaitForFences( m_Device.Device(), 1, &batch.fence, VK_TRUE, UINT64_MAX );
+            waitForOldest = false;
+        }
+        else if ( vkGetFenceStatus( m_Device.Device(), batch.fence ) != VK_SUCCESS )
+        {
+            return;
+        }
+
+        m_RingReleased = batch.ringEnd;
+        m_CompletedBatchId = batch.id;
+        batch.overflowBuffers.clear();
+
+        m_FreeBatches.push_back( std::move( m_InFlightBatches.front() ) );
+        m_InFlightBatches.pop_front();
+    }
+}
+
+void UploadQueue::WaitForBatch( uint64_t batchId )
+{
+    if ( m_CurrentBatch && m_CurrentBatch->id <= batchId )
+    {
+        SubmitLocked();
+    }
+
+    while ( m_CompletedBatchId < batchId && !m_InFlightBatches.empty() )
+    {
+        RetireCompletedBatches( true );
+    }
+}
+
+VkDeviceSize UploadQueue::AllocateStaging( VkDeviceSize size )
+{
+    uint64_t start = ( m_RingWrite + STAGING_ALIGNMENT - 1 ) / STAGING_ALIGNMENT * STAGING_ALIGNMENT;
+
+    //Never split an upload over the end of the ring, skip to the start instead
+    if ( start % m_RingSize + size > m_RingSize )
+    {
+        start += m_RingSize - start % m_RingSize;
+    }
+
+    while ( start + size - m_RingReleased > m_RingSize )
+    {
+        //The open batch might be the one holding the space, it has to go out before it can be waited on
+        if ( m_InFlightBatches.empty() )
+        {
+            if ( !m_CurrentBatch )
+            {
+                //Nothing in flight and nothing recorded, all of the ring is free
+                m_RingReleased = start;
+                break;
+            }
+
+            SubmitLocked();
+        }
+        RetireCompletedBatches( true );
+    }
+
+    m_RingWrite = start + size;
+    return start % m_RingSize;
+}
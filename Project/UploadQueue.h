@@ -0,0 +1,74 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+class EngineDevice;
+class Buffer;
+
+//Identifies the batch an upload was recorded into, poll it with UploadQueue::IsComplete
+struct UploadTicket
+{
+    uint64_t batchId = 0;
+};
+
+//Batches host -> device copies through one persistent ring of staging memory.
+//Uploads are recorded into an open command buffer and only go to the gpu on Submit, as one submission with a fence.
+class UploadQueue
+{
+public:
+    static constexpr VkDeviceSize DEFAULT_RING_SIZE = 32ull * 1024 * 1024;
+
+    explicit UploadQueue( EngineDevice& device, VkDeviceSize ringSize = DEFAULT_RING_SIZE );
+    ~UploadQueue();
+
+    UploadQueue( const UploadQueue& ) = delete;
+    UploadQueue& operator=( const UploadQueue& ) = delete;
+
+    //Copies data into the staging ring right away, the gpu copy happens with the next Submit
+    UploadTicket Upload( VkBuffer dstBuffer, const void* data, VkDeviceSize size, VkDeviceSize dstOffset = 0 );
+    UploadTicket Copy( VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size );
+
+    //Sends the open batch, does nothing when nothing was recorded
+    UploadTicket Submit();
+
+    bool IsComplete( UploadTicket ticket );
+    void Wait( UploadTicket ticket );
+    void WaitIdle();
+
+    bool HasPendingUploads() const { return m_CurrentBatch != nullptr; }
+
+private:
+    struct Batch
+    {
+        uint64_t id = 0;
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+        uint64_t ringEnd = 0;                                   //Ring space up to here is free once the fence signals
+        std::vector<std::unique_ptr<Buffer>> overflowBuffers;  //Staging for uploads bigger than the whole ring
+    };
+
+    Batch& GetCurrentBatch();
+    UploadTicket SubmitLocked();
+    void RetireCompletedBatches( bool waitForOldest );
+    void WaitForBatch( uint64_t batchId );
+    //Offset in the ring buffer, waits on in flight batches when the ring is full
+    VkDeviceSize AllocateStaging( VkDeviceSize size );
+
+    EngineDevice& m_Device;
+    VkCommandPool m_CommandPool = VK_NULL_HANDLE;
+
+    std::unique_ptr<Buffer> m_RingBuffer;
+    const VkDeviceSize m_RingSize;
+    uint64_t m_RingWrite = 0;       //Both grow forever, the ring position is the value modulo m_RingSize
+    uint64_t m_RingReleased = 0;
+
+    std::mutex m_Mutex;
+    std::unique_ptr<Batch> m_CurrentBatch;
+    std::deque<std::unique_ptr<Batch>> m_InFlightBatches;
+    std::vector<std::unique_ptr<Batch>> m_FreeBatches;
+    uint64_t m_NextBatchId = 1;
+    uint64_t m_CompletedBatchId = 0;
+};
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <vulkan/vulkan.h>
+
+//Which vertex struct a model's vertex buffer holds, pipelines are built once per layout
+enum class VertexLayout : uint32_t
+{
+    Full,       //Model::Vertex, fp32 everything
+    Compact,    //Model::CompactVertex, quantized
+    Count
+};
+
+static constexpr uint32_t VERTEX_LAYOUT_COUNT = static_cast< uint32_t >( VertexLayout::Count );
+
+inline const char* GetVertexLayoutName( VertexLayout layout )
+{
+    return layout == VertexLayout::Compact ? "compact" : "full";
+}
+
+inline VertexLayout ParseVertexLayout( const std::string& name )
+{
+    if ( name == "full" ) return VertexLayout::Full;
+    if ( name == "compact" ) return VertexLayout::Compact;
+    throw std::runtime_error( "Unknown vertex layout: " + name );
+}
+
+//One attribute of vertex binding 0
+struct VertexAttribute
+{
+    uint32_t location;
+    VkFormat format;
+    uint32_t offset;
+};
+
+//Generates the binding and attribute descriptions of a vertex struct from its ATTRIBUTES table,
+//so a new layout only lists its attributes once
+template<typename VertexType>
+struct VertexLayoutDescriptions
+{
+    static std::vector<VkVertexInputBindingDescription> GetBindingDescriptions()
+    {
+        std::vector<VkVertexInputBindingDescription> bindingDescriptions( 1 );
+        bindingDescriptions[ 0 ].binding = 0;
+        bindingDescriptions[ 0 ].stride = sizeof( VertexType );
+        bindingDescriptions[ 0 ].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+        return bindingDescriptions;
+    }
+
+    static std::vector<VkVertexInputAttributeDescription> GetAttributeDescriptions()
+    {
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+        for ( const VertexAttribute& attribute : VertexType::ATTRIBUTES )
+        {
+            attributeDescriptions.push_back( { attribute.location, 0, attribute.format, attribute.offset } );
+        }
+        return attributeDescriptions;
+    }
+};
@@ -5,19 +5,30 @@
 #include <GLFW/glfw3native.h>
 #include <glm/glm.hpp>
 
-Window::Window( const int w, const int h, std::string& name ) : m_Width{ w }, m_Height{ h }, m_WindowName{ name }
+Window::Window( const int w, const int h, std::string& name, bool headless ) 
+	: m_Width{ w }, m_Height{ h }, m_Headless{ headless }, m_WindowName{ name }
 {
-	InitWindow();
+	if ( !m_Headless )
+	{
+		InitWindow();
+	}
 }
 
 Window::~Window()
 {
+	if ( m_Headless ) return;
+
 	glfwDestroyWindow( m_Window );
 	glfwTerminate();
 }
 
 void Window::CreateWindowSurface( VkInstance instance, VkSurfaceKHR* surface )
 {
+	if ( m_Headless )
+	{
+		throw std::runtime_error( "Headless windows have no surface!" );
+	}
+
 	if ( glfwCreateWindowSurface( instance, m_Window, nullptr, surface ) != VK_SUCCESS )
 	{
 		throw std::runtime_error( "Failed to create window surface!" );
@@ -35,8 +46,11 @@ void Window::UpdateFPS()
 		m_FPSString = "FPS: " + std::to_string( static_cast< int >( m_FPS ) );
 		m_FrameCount = 0;
 		m_LastTime = currentTime;
-		std::string newTitle = m_WindowName + " - FPS: " + std::to_string( static_cast< int >( m_FPS ) );
-		glfwSetWindowTitle( m_Window, newTitle.c_str() );
+		if ( !m_Headless )
+		{
+			std::string newTitle = m_WindowName + " - FPS: " + std::to_string( static_cast< int >( m_FPS ) );
+			glfwSetWindowTitle( m_Window, newTitle.c_str() );
+		}
 	}
 }
 
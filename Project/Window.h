@@ -9,7 +9,8 @@
 class Window
 {
 public:
-	Window( const int w, const int h, std::string& name );
+	//A headless window never touches glfw, it only keeps the size of the offscreen target
+	Window( const int w, const int h, std::string& name, bool headless = false );
 	~Window();
 
 	Window( const Window& ) = delete;
@@ -17,7 +18,8 @@ public:
 	Window& operator=( const Window& ) = delete;
 	Window& operator=( Window&& ) = delete;
 
-	bool ShouldClose() { return glfwWindowShouldClose( m_Window ); }
+	bool ShouldClose() { return !m_Headless && glfwWindowShouldClose( m_Window ); }
+	bool IsHeadless() const { return m_Headless; }
 	bool WasWindowResized() { return m_FrameBufferResized; }
 
 	void ResetWindowResizedFlag() { m_FrameBufferResized = false; }
@@ -39,9 +41,10 @@ private:
 	int m_Width;
 	int m_Height;
 	bool m_FrameBufferResized = false;
+	bool m_Headless = false;
 
 	std::string m_WindowName;
-	GLFWwindow* m_Window;
+	GLFWwindow* m_Window = nullptr;
 
 	std::chrono::time_point<std::chrono::high_resolution_clock> m_LastTime;
 	int m_FrameCount = 0;
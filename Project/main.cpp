@@ -4,12 +4,11 @@
 #include <iostream>
 #include <stdexcept>
 
-int main() 
+int main( int argc, char** argv ) 
 {
-    AppBase app{};
-
     try 
     {
+        AppBase app{ AppSettings::Parse( argc, argv ) };
         app.Run();
     }
     catch ( const std::exception& e ) 